@@ -0,0 +1,317 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "BatchPayout.h"
+#include "CurrencyAdapter.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+// Outputs reserved for change, it is split into denominations as well
+const size_t CHANGE_OUTPUT_RESERVE = 10;
+// Part of the wallet's size limit left as a margin for the size approximation
+const size_t SIZE_MARGIN_PERCENT = 10;
+
+}
+
+BatchPayout::BatchPayout(QObject* _parent) : QObject(_parent), m_fee(0), m_mixin(0), m_extraAmount(0),
+  m_extraTransferCount(0), m_currentBatch(-1), m_running(false), m_cancelRequested(false) {
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletSendTransactionCompletedSignal, this, &BatchPayout::sendTransactionCompleted,
+    Qt::QueuedConnection);
+}
+
+BatchPayout::~BatchPayout() {
+}
+
+bool BatchPayout::parseCsv(const QString& _fileName, QVector<PayoutRecipient>& _recipients, QString& _errorText) {
+  QFile file(_fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    _errorText = tr("Cannot open file %1").arg(_fileName);
+    return false;
+  }
+
+  _recipients.clear();
+  QTextStream stream(&file);
+  int lineNumber = 0;
+  while (!stream.atEnd()) {
+    QString line = stream.readLine().trimmed();
+    ++lineNumber;
+    if (line.isEmpty() || line.startsWith('#')) {
+      continue;
+    }
+
+    QStringList fields = line.split(QRegExp("[,;\\t]"));
+    for (QString& field : fields) {
+      field = field.trimmed().remove('"');
+    }
+
+    if (fields.size() < 2) {
+      _errorText = tr("Line %1: expected address and amount").arg(lineNumber);
+      return false;
+    }
+
+    PayoutRecipient recipient;
+    recipient.address = fields[0];
+    recipient.amount = CurrencyAdapter::instance().parseAmount(fields[1]);
+    recipient.label = fields.size() > 2 ? fields[2] : QString();
+
+    if (!CurrencyAdapter::instance().validateAddress(recipient.address)) {
+      // Allow a header line
+      if (_recipients.isEmpty() && recipient.amount == 0) {
+        continue;
+      }
+
+      _errorText = tr("Line %1: invalid address").arg(lineNumber);
+      return false;
+    }
+
+    if (recipient.amount == 0) {
+      _errorText = tr("Line %1: invalid amount").arg(lineNumber);
+      return false;
+    }
+
+    _recipients.append(recipient);
+  }
+
+  if (_recipients.isEmpty()) {
+    _errorText = tr("No recipients found");
+    return false;
+  }
+
+  return true;
+}
+
+bool BatchPayout::prepare(const QVector<PayoutRecipient>& _recipients, const std::vector<CryptoNote::WalletLegacyTransfer>& _extraTransfers,
+  quint64 _fee, quint64 _mixin, const QString& _paymentId, QString& _errorText) {
+  if (m_running) {
+    _errorText = tr("Batch payout is already in progress");
+    return false;
+  }
+
+  m_batches.clear();
+  m_fee = _fee;
+  m_mixin = _mixin;
+  m_paymentId = _paymentId;
+  m_extraAmount = 0;
+  m_extraTransferCount = _extraTransfers.size();
+
+  size_t extraOutputs = 0;
+  for (const CryptoNote::WalletLegacyTransfer& transfer : _extraTransfers) {
+    m_extraAmount += transfer.amount;
+    extraOutputs += estimateOutputCount(transfer.amount);
+  }
+
+  quint64 outputsTotal = 0;
+  std::vector<CryptoNote::TransactionOutputInformation> outputs = WalletAdapter::instance().getUnlockedOutputs();
+  for (const CryptoNote::TransactionOutputInformation& output : outputs) {
+    outputsTotal += output.amount;
+  }
+
+  if (outputs.empty()) {
+    _errorText = tr("No unlocked outputs available");
+    return false;
+  }
+
+  const quint64 averageOutputAmount = std::max<quint64>(outputsTotal / outputs.size(), 1);
+  const size_t transactionSize = maxTransactionSize();
+  const CryptoNote::Currency& currency = CurrencyAdapter::instance().getCurrency();
+
+  PayoutBatch batch;
+  auto resetBatch = [&]() {
+    batch.transfers = _extraTransfers;
+    batch.recipients.clear();
+    batch.amount = m_extraAmount;
+    batch.estimatedOutputCount = extraOutputs + CHANGE_OUTPUT_RESERVE;
+    batch.estimatedInputCount = 0;
+    batch.status = PayoutBatch::PENDING;
+    batch.transactionId = CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID;
+    batch.errorText.clear();
+  };
+
+  resetBatch();
+  size_t recipientsInBatch = 0;
+  for (const PayoutRecipient& recipient : _recipients) {
+    size_t outputCount = batch.estimatedOutputCount + estimateOutputCount(recipient.amount);
+    size_t inputCount = estimateInputCount(batch.amount + recipient.amount + m_fee, averageOutputAmount);
+    size_t maxInputCount = currency.getApproximateMaximumInputCount(transactionSize, outputCount, m_mixin);
+
+    if (recipientsInBatch > 0 && inputCount > maxInputCount) {
+      m_batches.append(batch);
+      resetBatch();
+      recipientsInBatch = 0;
+      outputCount = batch.estimatedOutputCount + estimateOutputCount(recipient.amount);
+      inputCount = estimateInputCount(batch.amount + recipient.amount + m_fee, averageOutputAmount);
+    }
+
+    CryptoNote::WalletLegacyTransfer transfer;
+    transfer.address = recipient.address.toStdString();
+    transfer.amount = recipient.amount;
+    batch.transfers.push_back(transfer);
+    batch.recipients.append(recipient.label.isEmpty() ? recipient.address : recipient.label);
+    batch.amount += recipient.amount;
+    batch.estimatedOutputCount = outputCount;
+    batch.estimatedInputCount = inputCount;
+    ++recipientsInBatch;
+  }
+
+  if (recipientsInBatch > 0) {
+    m_batches.append(batch);
+  }
+
+  PayoutEstimate total = estimate();
+  if (total.totalAmount + total.totalFee + total.totalExtra > WalletAdapter::instance().getActualBalance()) {
+    _errorText = tr("Available balance is insufficient to pay all recipients");
+    return false;
+  }
+
+  return true;
+}
+
+PayoutEstimate BatchPayout::estimate() const {
+  PayoutEstimate result = {0, m_batches.size(), 0, 0, 0};
+  for (const PayoutBatch& batch : m_batches) {
+    result.recipientCount += static_cast<int>(batch.transfers.size() - m_extraTransferCount);
+    result.totalAmount += batch.amount - m_extraAmount;
+    result.totalFee += m_fee;
+    result.totalExtra += m_extraAmount;
+  }
+
+  return result;
+}
+
+const QVector<PayoutBatch>& BatchPayout::batches() const {
+  return m_batches;
+}
+
+void BatchPayout::start() {
+  if (m_running || m_batches.isEmpty()) {
+    return;
+  }
+
+  m_running = true;
+  m_cancelRequested = false;
+  m_currentBatch = -1;
+  sendNextBatch();
+}
+
+void BatchPayout::cancel() {
+  m_cancelRequested = true;
+}
+
+bool BatchPayout::isRunning() const {
+  return m_running;
+}
+
+bool BatchPayout::isPayoutTransaction(CryptoNote::TransactionId _id) const {
+  if (_id == CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID) {
+    return false;
+  }
+
+  for (const PayoutBatch& batch : m_batches) {
+    if (batch.transactionId == _id) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BatchPayout::sendNextBatch() {
+  ++m_currentBatch;
+  if (m_currentBatch >= m_batches.size()) {
+    finish();
+    return;
+  }
+
+  PayoutBatch& batch = m_batches[m_currentBatch];
+  if (m_cancelRequested) {
+    for (int i = m_currentBatch; i < m_batches.size(); ++i) {
+      m_batches[i].status = PayoutBatch::CANCELLED;
+      Q_EMIT batchStatusChangedSignal(i, m_batches[i].status, tr("Cancelled"));
+    }
+
+    finish();
+    return;
+  }
+
+  batch.status = PayoutBatch::SENDING;
+  Q_EMIT batchStatusChangedSignal(m_currentBatch, batch.status, tr("Sending transaction %1 of %2").arg(m_currentBatch + 1).arg(m_batches.size()));
+  batch.transactionId = WalletAdapter::instance().sendTransaction(batch.transfers, m_fee, m_paymentId, m_mixin);
+  if (batch.transactionId == CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID) {
+    batch.status = PayoutBatch::FAILED;
+    batch.errorText = tr("The wallet rejected the transaction");
+    Q_EMIT batchStatusChangedSignal(m_currentBatch, batch.status, batch.errorText);
+    sendNextBatch();
+  }
+}
+
+void BatchPayout::sendTransactionCompleted(CryptoNote::TransactionId _id, int _error, const QString& _errorText) {
+  if (!m_running || m_currentBatch < 0 || m_currentBatch >= m_batches.size()) {
+    return;
+  }
+
+  PayoutBatch& batch = m_batches[m_currentBatch];
+  if (batch.status != PayoutBatch::SENDING || batch.transactionId != _id) {
+    return;
+  }
+
+  if (_error) {
+    batch.status = PayoutBatch::FAILED;
+    batch.errorText = _errorText;
+    Q_EMIT batchStatusChangedSignal(m_currentBatch, batch.status, _errorText);
+  } else {
+    batch.status = PayoutBatch::SENT;
+    Q_EMIT batchStatusChangedSignal(m_currentBatch, batch.status, tr("Transaction %1 of %2 sent").arg(m_currentBatch + 1).arg(m_batches.size()));
+  }
+
+  sendNextBatch();
+}
+
+void BatchPayout::finish() {
+  m_running = false;
+  int sent = 0;
+  int failed = 0;
+  for (const PayoutBatch& batch : m_batches) {
+    if (batch.status == PayoutBatch::SENT) {
+      ++sent;
+    } else {
+      ++failed;
+    }
+  }
+
+  Q_EMIT payoutFinishedSignal(sent, failed);
+}
+
+size_t BatchPayout::maxTransactionSize() const {
+  const CryptoNote::Currency& currency = CurrencyAdapter::instance().getCurrency();
+  size_t limit = currency.blockGrantedFullRewardZone() * 2 - currency.minerTxBlobReservedSize();
+  return limit - limit * SIZE_MARGIN_PERCENT / 100;
+}
+
+size_t BatchPayout::estimateInputCount(quint64 _amount, quint64 _averageOutputAmount) const {
+  return static_cast<size_t>((_amount + _averageOutputAmount - 1) / _averageOutputAmount) + 1;
+}
+
+size_t BatchPayout::estimateOutputCount(quint64 _amount) {
+  // Amounts are decomposed into one output per non-zero decimal digit
+  size_t count = 0;
+  while (_amount > 0) {
+    if (_amount % 10 != 0) {
+      ++count;
+    }
+
+    _amount /= 10;
+  }
+
+  return std::max<size_t>(count, 1);
+}
+
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <vector>
+
+#include <IWalletLegacy.h>
+
+namespace WalletGui {
+
+struct PayoutRecipient {
+  QString address;
+  quint64 amount;
+  QString label;
+};
+
+struct PayoutBatch {
+  enum Status { PENDING, SENDING, SENT, FAILED, CANCELLED };
+
+  std::vector<CryptoNote::WalletLegacyTransfer> transfers;
+  // recipient labels, or addresses where the CSV has none, for the report
+  QStringList recipients;
+  quint64 amount;
+  size_t estimatedOutputCount;
+  size_t estimatedInputCount;
+  Status status;
+  CryptoNote::TransactionId transactionId;
+  QString errorText;
+};
+
+struct PayoutEstimate {
+  int recipientCount;
+  int transactionCount;
+  quint64 totalAmount;
+  quint64 totalFee;
+  quint64 totalExtra;
+};
+
+// Batches are sent one at a time: WalletAdapter holds its send lock from
+// sendTransaction() until the wallet reports the relay, so the next
+// transaction can only be built once the previous one is out.
+class BatchPayout : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(BatchPayout)
+
+public:
+  BatchPayout(QObject* _parent);
+  ~BatchPayout();
+
+  static bool parseCsv(const QString& _fileName, QVector<PayoutRecipient>& _recipients, QString& _errorText);
+
+  // Splits recipients into transactions that fit the wallet's size limit.
+  // _extraTransfers (e.g. remote node fee) are appended to every transaction.
+  bool prepare(const QVector<PayoutRecipient>& _recipients, const std::vector<CryptoNote::WalletLegacyTransfer>& _extraTransfers,
+    quint64 _fee, quint64 _mixin, const QString& _paymentId, QString& _errorText);
+  PayoutEstimate estimate() const;
+  const QVector<PayoutBatch>& batches() const;
+
+  void start();
+  void cancel();
+  bool isRunning() const;
+  // The payout reports its own transactions, completions arriving after it
+  // finished included
+  bool isPayoutTransaction(CryptoNote::TransactionId _id) const;
+
+private:
+  QVector<PayoutBatch> m_batches;
+  quint64 m_fee;
+  quint64 m_mixin;
+  quint64 m_extraAmount;
+  size_t m_extraTransferCount;
+  QString m_paymentId;
+  int m_currentBatch;
+  bool m_running;
+  bool m_cancelRequested;
+
+  void sendNextBatch();
+  void finish();
+  size_t maxTransactionSize() const;
+  size_t estimateInputCount(quint64 _amount, quint64 _averageOutputAmount) const;
+  static size_t estimateOutputCount(quint64 _amount);
+
+  Q_SLOT void sendTransactionCompleted(CryptoNote::TransactionId _id, int _error, const QString& _errorText);
+
+Q_SIGNALS:
+  void batchStatusChangedSignal(int _index, int _status, const QString& _text);
+  void payoutFinishedSignal(int _sent, int _failed);
+};
+
+}
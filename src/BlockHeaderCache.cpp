@@ -0,0 +1,274 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <cstring>
+
+#include "BlockHeaderCache.h"
+
+namespace WalletGui {
+
+namespace {
+
+// File header: magic, base height, record count. Records are fixed size.
+const char CACHE_MAGIC[8] = {'K', 'R', 'B', 'H', 'D', 'R', '0', '1'};
+const qint64 FILE_HEADER_SIZE = 16;
+const qint64 BASE_HEIGHT_OFFSET = 8;
+const qint64 COUNT_OFFSET = 12;
+
+const qint64 RECORD_SIZE = 64;
+const qint64 HASH_OFFSET = 0;
+const qint64 TIMESTAMP_OFFSET = 32;
+const qint64 DIFFICULTY_OFFSET = 40;
+const qint64 MAJOR_VERSION_OFFSET = 48;
+const qint64 FLAGS_OFFSET = 49;
+const quint8 FLAG_PRESENT = 1;
+
+// About a month of blocks per growth step
+const quint32 CAPACITY_STEP = 16384;
+
+template<typename T> T readValue(const uchar* _data) {
+  T value;
+  std::memcpy(&value, _data, sizeof(T));
+  return value;
+}
+
+template<typename T> void writeValue(uchar* _data, T _value) {
+  std::memcpy(_data, &_value, sizeof(T));
+}
+
+}
+
+BlockHeaderCache::BlockHeaderCache() : m_map(nullptr), m_capacity(0) {
+}
+
+BlockHeaderCache::~BlockHeaderCache() {
+  close();
+}
+
+bool BlockHeaderCache::open(const QString& _fileName) {
+  close();
+  m_file.setFileName(_fileName);
+  if (!m_file.open(QIODevice::ReadWrite)) {
+    return false;
+  }
+
+  qint64 size = m_file.size();
+  bool valid = size >= FILE_HEADER_SIZE && (size - FILE_HEADER_SIZE) % RECORD_SIZE == 0;
+  if (valid) {
+    char magic[sizeof(CACHE_MAGIC)];
+    valid = m_file.read(magic, sizeof(magic)) == sizeof(magic) && std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0;
+  }
+
+  if (!valid) {
+    // Unknown or damaged file, start over
+    QByteArray header(FILE_HEADER_SIZE, '\0');
+    std::memcpy(header.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    if (!m_file.resize(0) || !m_file.seek(0) || m_file.write(header) != FILE_HEADER_SIZE) {
+      m_file.close();
+      return false;
+    }
+
+    m_file.flush();
+    size = FILE_HEADER_SIZE;
+  }
+
+  if (!mapFile(static_cast<quint32>((size - FILE_HEADER_SIZE) / RECORD_SIZE))) {
+    m_file.close();
+    return false;
+  }
+
+  if (count() > m_capacity) {
+    setCount(0);
+  }
+
+  return true;
+}
+
+void BlockHeaderCache::close() {
+  if (m_map != nullptr) {
+    m_file.unmap(m_map);
+    m_map = nullptr;
+  }
+
+  m_capacity = 0;
+  if (m_file.isOpen()) {
+    m_file.close();
+  }
+}
+
+bool BlockHeaderCache::isOpen() const {
+  return m_map != nullptr;
+}
+
+void BlockHeaderCache::store(const CryptoNote::BlockHeaderInfo& _header) {
+  if (!isOpen()) {
+    return;
+  }
+
+  const quint32 height = _header.index;
+  // Starting over is cheaper than keeping a long run of empty records
+  if (count() == 0 || height >= baseHeight() + count() + CAPACITY_STEP) {
+    writeValue<quint32>(m_map + BASE_HEIGHT_OFFSET, height);
+    setCount(0);
+  }
+
+  const quint32 base = baseHeight();
+  if (height < base) {
+    return;
+  }
+
+  CachedBlockHeader cached;
+  quint32 end = height - base + 1;
+  if (get(height, cached) && cached.hash != _header.hash) {
+    end = height - base;
+  } else if (height > base && get(height - 1, cached) && cached.hash != _header.prevHash) {
+    end = height - 1 - base;
+  }
+
+  // Everything above the stored header is from another chain or not known yet
+  if (end < count()) {
+    setCount(end);
+  }
+
+  const quint32 index = height - base;
+  if (!reserve(index + 1)) {
+    return;
+  }
+
+  for (quint32 i = count(); i < index; ++i) {
+    std::memset(record(i), 0, RECORD_SIZE);
+  }
+
+  writeRecord(index, _header);
+  setCount(index + 1);
+}
+
+bool BlockHeaderCache::fill(const CryptoNote::BlockHeaderInfo& _header) {
+  CachedBlockHeader cached;
+  const quint32 height = _header.index;
+  if (!isOpen() || height < baseHeight() || height - baseHeight() >= count() || get(height, cached)) {
+    return false;
+  }
+
+  // A header from another chain than the cached one is not mixed in
+  if (height > baseHeight() && get(height - 1, cached) && cached.hash != _header.prevHash) {
+    return false;
+  }
+
+  writeRecord(height - baseHeight(), _header);
+  return true;
+}
+
+std::vector<uint32_t> BlockHeaderCache::missingHeights(quint32 _limit) const {
+  std::vector<uint32_t> heights;
+  if (!isOpen()) {
+    return heights;
+  }
+
+  for (quint32 index = count(); index > 0 && heights.size() < _limit; --index) {
+    if ((readValue<quint8>(record(index - 1) + FLAGS_OFFSET) & FLAG_PRESENT) == 0) {
+      heights.push_back(baseHeight() + index - 1);
+    }
+  }
+
+  return heights;
+}
+
+bool BlockHeaderCache::get(quint32 _height, CachedBlockHeader& _header) const {
+  if (!isOpen() || _height < baseHeight() || _height - baseHeight() >= count()) {
+    return false;
+  }
+
+  const uchar* data = record(_height - baseHeight());
+  if ((readValue<quint8>(data + FLAGS_OFFSET) & FLAG_PRESENT) == 0) {
+    return false;
+  }
+
+  std::memcpy(&_header.hash, data + HASH_OFFSET, sizeof(Crypto::Hash));
+  _header.timestamp = readValue<quint64>(data + TIMESTAMP_OFFSET);
+  _header.difficulty = readValue<quint64>(data + DIFFICULTY_OFFSET);
+  _header.majorVersion = readValue<quint8>(data + MAJOR_VERSION_OFFSET);
+  return true;
+}
+
+bool BlockHeaderCache::topHeight(quint32& _height) const {
+  if (!isOpen() || count() == 0) {
+    return false;
+  }
+
+  _height = baseHeight() + count() - 1;
+  return true;
+}
+
+QDateTime BlockHeaderCache::estimateBlockTime(quint32 _height, quint64 _blockTarget) const {
+  quint32 top;
+  if (!topHeight(top)) {
+    return QDateTime();
+  }
+
+  // Nearest cached header at or above the requested height
+  quint32 nearest = std::min(std::max(_height, baseHeight()), top);
+  CachedBlockHeader header;
+  while (!get(nearest, header)) {
+    if (nearest == top) {
+      return QDateTime();
+    }
+
+    ++nearest;
+  }
+
+  const qint64 blocks = static_cast<qint64>(_height) - static_cast<qint64>(nearest);
+  return QDateTime::fromTime_t(header.timestamp, Qt::UTC).addSecs(blocks * static_cast<qint64>(_blockTarget));
+}
+
+quint32 BlockHeaderCache::baseHeight() const {
+  return readValue<quint32>(m_map + BASE_HEIGHT_OFFSET);
+}
+
+quint32 BlockHeaderCache::count() const {
+  return readValue<quint32>(m_map + COUNT_OFFSET);
+}
+
+void BlockHeaderCache::setCount(quint32 _count) {
+  writeValue<quint32>(m_map + COUNT_OFFSET, _count);
+}
+
+uchar* BlockHeaderCache::record(quint32 _index) const {
+  return m_map + FILE_HEADER_SIZE + static_cast<qint64>(_index) * RECORD_SIZE;
+}
+
+bool BlockHeaderCache::reserve(quint32 _count) {
+  if (_count <= m_capacity) {
+    return true;
+  }
+
+  const quint32 capacity = (_count / CAPACITY_STEP + 1) * CAPACITY_STEP;
+  m_file.unmap(m_map);
+  m_map = nullptr;
+  if (!m_file.resize(FILE_HEADER_SIZE + static_cast<qint64>(capacity) * RECORD_SIZE) || !mapFile(capacity)) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+bool BlockHeaderCache::mapFile(quint32 _capacity) {
+  m_map = m_file.map(0, FILE_HEADER_SIZE + static_cast<qint64>(_capacity) * RECORD_SIZE);
+  m_capacity = m_map != nullptr ? _capacity : 0;
+  return m_map != nullptr;
+}
+
+void BlockHeaderCache::writeRecord(quint32 _index, const CryptoNote::BlockHeaderInfo& _header) {
+  uchar* data = record(_index);
+  std::memset(data, 0, RECORD_SIZE);
+  std::memcpy(data + HASH_OFFSET, &_header.hash, sizeof(Crypto::Hash));
+  writeValue<quint64>(data + TIMESTAMP_OFFSET, _header.timestamp);
+  writeValue<quint64>(data + DIFFICULTY_OFFSET, _header.difficulty);
+  writeValue<quint8>(data + MAJOR_VERSION_OFFSET, _header.majorVersion);
+  writeValue<quint8>(data + FLAGS_OFFSET, FLAG_PRESENT);
+}
+
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QDateTime>
+#include <QFile>
+
+#include <vector>
+
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "INode.h"
+
+namespace WalletGui {
+
+struct CachedBlockHeader {
+  Crypto::Hash hash;
+  quint64 timestamp;
+  quint64 difficulty;
+  quint8 majorVersion;
+};
+
+// Headers of the blocks seen by an RPC mode wallet, kept in a memory mapped
+// file so status and block times are known right after a restart without
+// asking the node. Records start at the first height ever stored; heights
+// skipped while syncing stay empty until they are backfilled with fill().
+// Not thread safe, used from the GUI thread.
+class BlockHeaderCache {
+public:
+  BlockHeaderCache();
+  ~BlockHeaderCache();
+
+  bool open(const QString& _fileName);
+  void close();
+  bool isOpen() const;
+
+  // A different hash at a cached height, or a different previous hash, is a
+  // reorganization: all headers from the forked height on are dropped
+  void store(const CryptoNote::BlockHeaderInfo& _header);
+  // Writes an empty record below the top without touching the ones above,
+  // false if the height is not a gap or the header does not link to the
+  // cached block before it
+  bool fill(const CryptoNote::BlockHeaderInfo& _header);
+  // Empty records, newest first, at most _limit of them
+  std::vector<uint32_t> missingHeights(quint32 _limit) const;
+  bool get(quint32 _height, CachedBlockHeader& _header) const;
+  bool topHeight(quint32& _height) const;
+
+  // Exact for cached heights, otherwise extrapolated from the nearest cached
+  // header with _blockTarget seconds per block; invalid if the cache is empty
+  QDateTime estimateBlockTime(quint32 _height, quint64 _blockTarget) const;
+
+private:
+  QFile m_file;
+  uchar* m_map;
+  quint32 m_capacity;
+
+  quint32 baseHeight() const;
+  quint32 count() const;
+  void setCount(quint32 _count);
+  uchar* record(quint32 _index) const;
+  bool reserve(quint32 _count);
+  bool mapFile(quint32 _capacity);
+  void writeRecord(quint32 _index, const CryptoNote::BlockHeaderInfo& _header);
+};
+
+}
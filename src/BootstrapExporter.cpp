@@ -0,0 +1,125 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QDataStream>
+#include <QSaveFile>
+
+#include <algorithm>
+
+#include "BootstrapExporter.h"
+#include "BootstrapImporter.h"
+#include "CryptoNoteWrapper.h"
+#include "LoggerAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const quint32 BATCH_SIZE = 512;
+const int LOG_EVERY_BATCHES = 20;
+
+void writeBlob(QDataStream& _stream, const CryptoNote::BinaryArray& _blob) {
+  _stream << static_cast<quint32>(_blob.size());
+  _stream.writeRawData(reinterpret_cast<const char*>(_blob.data()), static_cast<int>(_blob.size()));
+}
+
+void writeRawBlock(QDataStream& _stream, const RawBlock& _rawBlock) {
+  writeBlob(_stream, _rawBlock.block);
+  _stream << static_cast<quint32>(_rawBlock.transactions.size());
+  for (const CryptoNote::BinaryArray& transaction : _rawBlock.transactions) {
+    writeBlob(_stream, transaction);
+  }
+}
+
+}
+
+BootstrapExporter::BootstrapExporter(Node* _node) : QObject(), m_node(_node), m_cancelled(false) {
+  m_thread.setObjectName("BootstrapExporter");
+  moveToThread(&m_thread);
+}
+
+BootstrapExporter::~BootstrapExporter() {
+  cancel();
+  m_thread.quit();
+  m_thread.wait();
+}
+
+void BootstrapExporter::start(const QString& _file) {
+  m_cancelled = false;
+  m_thread.start();
+  QMetaObject::invokeMethod(this, "exportBlocks", Qt::QueuedConnection, Q_ARG(QString, _file));
+}
+
+void BootstrapExporter::cancel() {
+  m_cancelled = true;
+}
+
+bool BootstrapExporter::isRunning() const {
+  return m_thread.isRunning();
+}
+
+void BootstrapExporter::exportBlocks(const QString& _file) {
+  // Written to a temporary file, a failed or cancelled export leaves nothing behind
+  QSaveFile file(_file);
+  if (!file.open(QIODevice::WriteOnly)) {
+    Q_EMIT exportFinishedSignal(false, tr("Cannot create %1").arg(_file));
+    m_thread.quit();
+    return;
+  }
+
+  // The genesis block is where every chain starts, it is left out
+  const quint32 total = static_cast<quint32>(m_node->getLastLocalBlockHeight());
+  QDataStream stream(&file);
+  stream.setByteOrder(QDataStream::LittleEndian);
+  stream.writeRawData(BOOTSTRAP_MAGIC, sizeof(BOOTSTRAP_MAGIC) - 1);
+  stream << total;
+  LoggerAdapter::instance().log(QString("Exporting %1 blocks to %2").arg(total).arg(_file).toStdString());
+
+  quint32 current = 0;
+  int batches = 0;
+  QString error;
+  std::vector<RawBlock> rawBlocks;
+  while (current < total && !m_cancelled) {
+    const quint32 count = std::min(BATCH_SIZE, total - current);
+    if (!m_node->exportBlocks(current + 1, count, rawBlocks) || rawBlocks.size() != count) {
+      error = tr("Block %1 could not be read from the node").arg(current + 1 + rawBlocks.size());
+      break;
+    }
+
+    for (const RawBlock& rawBlock : rawBlocks) {
+      writeRawBlock(stream, rawBlock);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+      error = tr("Cannot write %1").arg(_file);
+      break;
+    }
+
+    current += count;
+    Q_EMIT exportProgressSignal(current, total);
+    if (++batches % LOG_EVERY_BATCHES == 0) {
+      LoggerAdapter::instance().log(QString("Exported %1 of %2 blocks").arg(current).arg(total).toStdString());
+    }
+  }
+
+  if (error.isEmpty() && m_cancelled) {
+    error = tr("Export cancelled");
+  }
+
+  if (error.isEmpty() && !file.commit()) {
+    error = tr("Cannot write %1").arg(_file);
+  }
+
+  if (!error.isEmpty()) {
+    file.cancelWriting();
+    LoggerAdapter::instance().log(error.toStdString());
+  } else {
+    LoggerAdapter::instance().log(QString("Bootstrap export finished, %1 blocks").arg(total).toStdString());
+  }
+
+  Q_EMIT exportFinishedSignal(error.isEmpty(), error);
+  m_thread.quit();
+}
+
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+
+#include <atomic>
+
+namespace WalletGui {
+
+class Node;
+
+// Writes the chain of the builtin node to a block file in the format
+// BootstrapImporter reads, for bootstrapping another wallet's builtin node.
+class BootstrapExporter : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(BootstrapExporter)
+
+public:
+  explicit BootstrapExporter(Node* _node);
+  ~BootstrapExporter();
+
+  void start(const QString& _file);
+  void cancel();
+  bool isRunning() const;
+
+private:
+  QThread m_thread;
+  Node* m_node;
+  std::atomic<bool> m_cancelled;
+
+  Q_INVOKABLE void exportBlocks(const QString& _file);
+
+Q_SIGNALS:
+  void exportProgressSignal(quint32 _current, quint32 _total);
+  void exportFinishedSignal(bool _ok, const QString& _message);
+};
+
+}
@@ -0,0 +1,220 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QDataStream>
+#include <QFile>
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+
+#include "BootstrapImporter.h"
+#include "CryptoNoteWrapper.h"
+#include "LoggerAdapter.h"
+#include "ParallelFor.h"
+
+namespace WalletGui {
+
+namespace {
+
+const size_t BATCH_SIZE = 512;
+const quint32 MAX_BLOB_SIZE = 2 * 1024 * 1024;
+const quint32 MAX_BLOCK_TRANSACTIONS = 10000;
+const int LOG_EVERY_BATCHES = 20;
+
+bool readBlob(QDataStream& _stream, CryptoNote::BinaryArray& _blob) {
+  quint32 size = 0;
+  _stream >> size;
+  if (_stream.status() != QDataStream::Ok || size > MAX_BLOB_SIZE) {
+    return false;
+  }
+
+  _blob.resize(size);
+  return size == 0 || _stream.readRawData(reinterpret_cast<char*>(_blob.data()), size) == static_cast<int>(size);
+}
+
+bool readRawBlock(QDataStream& _stream, RawBlock& _rawBlock) {
+  if (!readBlob(_stream, _rawBlock.block)) {
+    return false;
+  }
+
+  quint32 count = 0;
+  _stream >> count;
+  if (_stream.status() != QDataStream::Ok || count > MAX_BLOCK_TRANSACTIONS) {
+    return false;
+  }
+
+  _rawBlock.transactions.resize(count);
+  for (CryptoNote::BinaryArray& transaction : _rawBlock.transactions) {
+    if (!readBlob(_stream, transaction)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Everything the core would do to a block before it needs the chain: parsing,
+// hashing and matching the transactions to the block. The core takes the
+// result as it is and does not parse the blobs again.
+bool decodeBlock(const RawBlock& _rawBlock, ImportedBlock& _block) {
+  if (!CryptoNote::fromBinaryArray(_block.block, _rawBlock.block)) {
+    return false;
+  }
+
+  const CryptoNote::Block& block = _block.block;
+  if (block.baseTransaction.inputs.size() != 1 || block.baseTransaction.inputs[0].type() != typeid(CryptoNote::BaseInput)) {
+    return false;
+  }
+
+  _block.height = boost::get<CryptoNote::BaseInput>(block.baseTransaction.inputs[0]).blockIndex;
+  _block.id = CryptoNote::get_block_hash(block);
+  if (_rawBlock.transactions.size() != block.transactionHashes.size()) {
+    return false;
+  }
+
+  std::unordered_set<Crypto::Hash> hashes(block.transactionHashes.begin(), block.transactionHashes.end());
+  _block.transactions.resize(_rawBlock.transactions.size());
+  _block.transactionHashes.resize(_rawBlock.transactions.size());
+  _block.transactionSizes.resize(_rawBlock.transactions.size());
+  for (size_t i = 0; i < _rawBlock.transactions.size(); ++i) {
+    if (!CryptoNote::fromBinaryArray(_block.transactions[i], _rawBlock.transactions[i])) {
+      return false;
+    }
+
+    _block.transactionHashes[i] = CryptoNote::getObjectHash(_block.transactions[i]);
+    _block.transactionSizes[i] = _rawBlock.transactions[i].size();
+    if (hashes.erase(_block.transactionHashes[i]) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
+
+BootstrapImporter::BootstrapImporter(Node* _node) : QObject(), m_node(_node), m_cancelled(false) {
+  m_thread.setObjectName("BootstrapImporter");
+  moveToThread(&m_thread);
+}
+
+BootstrapImporter::~BootstrapImporter() {
+  cancel();
+  m_thread.quit();
+  m_thread.wait();
+}
+
+void BootstrapImporter::start(const QString& _file) {
+  m_cancelled = false;
+  m_thread.start();
+  QMetaObject::invokeMethod(this, "import", Qt::QueuedConnection, Q_ARG(QString, _file));
+}
+
+void BootstrapImporter::cancel() {
+  m_cancelled = true;
+}
+
+bool BootstrapImporter::isRunning() const {
+  return m_thread.isRunning();
+}
+
+void BootstrapImporter::import(const QString& _file) {
+  QFile file(_file);
+  if (!file.open(QIODevice::ReadOnly)) {
+    Q_EMIT importFinishedSignal(false, tr("Cannot open %1").arg(_file));
+    m_thread.quit();
+    return;
+  }
+
+  QDataStream stream(&file);
+  stream.setByteOrder(QDataStream::LittleEndian);
+  char magic[sizeof(BOOTSTRAP_MAGIC) - 1];
+  quint32 total = 0;
+  if (stream.readRawData(magic, sizeof(magic)) != static_cast<int>(sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), BOOTSTRAP_MAGIC)) {
+    Q_EMIT importFinishedSignal(false, tr("%1 is not a bootstrap file").arg(_file));
+    m_thread.quit();
+    return;
+  }
+
+  stream >> total;
+  // The core verifies the blocks as it does synchronized ones, proof of work
+  // only above the last checkpoint, where the import gets slower
+  const uint32_t lastCheckpoint = m_node->getLastCheckpointHeight();
+  uint64_t localHeight = m_node->getLastLocalBlockHeight();
+  LoggerAdapter::instance().log(QString("Importing up to %1 blocks from %2, fully verified above %3").
+    arg(total).arg(_file).arg(lastCheckpoint).toStdString());
+
+  quint32 current = 0;
+  int batches = 0;
+  QString error;
+  std::vector<RawBlock> rawBlocks;
+  std::vector<ImportedBlock> blocks;
+  while (current < total && !m_cancelled) {
+    const size_t count = std::min<size_t>(BATCH_SIZE, total - current);
+    rawBlocks.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      if (!readRawBlock(stream, rawBlocks[i])) {
+        error = tr("Bootstrap file is truncated or damaged at block %1").arg(current + i);
+        break;
+      }
+    }
+
+    if (!error.isEmpty()) {
+      break;
+    }
+
+    // Decoding is independent per block and runs on all cores, the core commits in order
+    blocks.assign(count, ImportedBlock());
+    if (!parallelFor(count, [&](size_t _index) { return decodeBlock(rawBlocks[_index], blocks[_index]); }, &m_cancelled)) {
+      if (!m_cancelled) {
+        error = tr("Invalid block in bootstrap file between %1 and %2").arg(current).arg(current + count);
+      }
+
+      break;
+    }
+
+    // Blocks the chain already has are skipped, the import can be resumed. The
+    // network keeps syncing meanwhile, so the height is read again every batch.
+    localHeight = std::max<uint64_t>(localHeight, m_node->getLastLocalBlockHeight());
+    size_t first = 0;
+    while (first < count && blocks[first].height <= localHeight) {
+      ++first;
+    }
+
+    if (first < count) {
+      std::vector<ImportedBlock> newBlocks(std::make_move_iterator(blocks.begin() + first), std::make_move_iterator(blocks.end()));
+      const size_t imported = m_node->importBlocks(newBlocks);
+      if (imported < newBlocks.size()) {
+        error = tr("Block %1 was rejected by the node").arg(newBlocks[imported].height);
+        break;
+      }
+
+      localHeight = std::max<uint64_t>(localHeight, newBlocks.back().height);
+    }
+
+    current += count;
+    Q_EMIT importProgressSignal(current, total);
+    if (++batches % LOG_EVERY_BATCHES == 0) {
+      LoggerAdapter::instance().log(QString("Imported %1 of %2 blocks").arg(current).arg(total).toStdString());
+    }
+  }
+
+  if (error.isEmpty() && m_cancelled) {
+    error = tr("Import cancelled");
+  }
+
+  if (!error.isEmpty()) {
+    LoggerAdapter::instance().log(error.toStdString());
+  } else {
+    LoggerAdapter::instance().log(QString("Bootstrap import finished at height %1").arg(localHeight).toStdString());
+  }
+
+  Q_EMIT importFinishedSignal(error.isEmpty(), error);
+  m_thread.quit();
+}
+
+}
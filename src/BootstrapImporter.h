@@ -0,0 +1,48 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+
+#include <atomic>
+
+namespace WalletGui {
+
+class Node;
+
+const char BOOTSTRAP_MAGIC[] = "KRBBOOT1";
+
+// Imports a block file written by BootstrapExporter into the builtin node. The
+// file starts with BOOTSTRAP_MAGIC and the block count (uint32), followed by
+// every block as uint32 size + block blob, uint32 transaction count and uint32
+// size + blob of each transaction, little endian. Blocks are read and decoded
+// in parallel batches, then committed in order by the core, which verifies
+// them as synchronized blocks: fully above the last checkpoint.
+class BootstrapImporter : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(BootstrapImporter)
+
+public:
+  explicit BootstrapImporter(Node* _node);
+  ~BootstrapImporter();
+
+  void start(const QString& _file);
+  void cancel();
+  bool isRunning() const;
+
+private:
+  QThread m_thread;
+  Node* m_node;
+  std::atomic<bool> m_cancelled;
+
+  Q_INVOKABLE void import(const QString& _file);
+
+Q_SIGNALS:
+  void importProgressSignal(quint32 _current, quint32 _total);
+  void importFinishedSignal(bool _ok, const QString& _message);
+};
+
+}
@@ -35,7 +35,17 @@ CommandLineParser::CommandLineParser(QObject* _parent) : QObject(_parent), m_par
   m_dataDirOption("data-dir", tr("Specify data directory"), tr("directory"), QString::fromLocal8Bit(Tools::getDefaultDataDirectory().c_str())),
   m_rollBackOption("rollback", tr("Rollback to height"), tr("height"), QString::number(std::numeric_limits<uint32_t>::max())),
   m_allowReorgOption("allow-reorg", tr("Allow deep reorganization to make it possible to self-heal chain split")),
-  m_minimized("minimized", tr("Run application in minimized mode")) {
+  m_minimized("minimized", tr("Run application in minimized mode")),
+  m_recordNodeOption("record-node", tr("Record the rpc node traffic to file, the builtin node has none"), tr("file")),
+  m_replayNodeOption("replay-node", tr("Serve the wallet from a recorded node session instead of the network"), tr("file")),
+  m_replayLatencyOption("replay-latency", tr("Delay of every replayed node response"), tr("ms"), "0"),
+  m_replayThroughputOption("replay-throughput", tr("Bandwidth limit of replayed node responses, 0 is unlimited"), tr("KiB/s"), "0"),
+  m_syncBenchmarkOption("sync-benchmark", tr("Report sync speed, peak memory and event loop latency when the wallet is synchronized, then quit")),
+  m_importBootstrapOption("import-bootstrap", tr("Import an exported block file into the builtin node before it syncs"), tr("file")),
+  m_miningBenchmarkOption("mining-benchmark", tr("Measure the mining hashrate at every thread count, store the best setting and quit")),
+  m_miningSelfTestOption("mining-self-test", tr("Compare the interleaved mining hash with the scalar one for every way count, then quit")),
+  m_failoverCheckOption("failover-check", tr("Check the remote node failover against two local nodes replaying a recorded node session, then quit"),
+    tr("file")) {
   m_parser.setApplicationDescription(tr("Karbowanec wallet"));
   m_parser.addHelpOption();
   m_parser.addVersionOption();
@@ -59,6 +69,15 @@ CommandLineParser::CommandLineParser(QObject* _parent) : QObject(_parent), m_par
   m_parser.addOption(m_rollBackOption);
   m_parser.addOption(m_allowReorgOption);
   m_parser.addOption(m_minimized);
+  m_parser.addOption(m_recordNodeOption);
+  m_parser.addOption(m_replayNodeOption);
+  m_parser.addOption(m_replayLatencyOption);
+  m_parser.addOption(m_replayThroughputOption);
+  m_parser.addOption(m_syncBenchmarkOption);
+  m_parser.addOption(m_importBootstrapOption);
+  m_parser.addOption(m_miningBenchmarkOption);
+  m_parser.addOption(m_miningSelfTestOption);
+  m_parser.addOption(m_failoverCheckOption);
 }
 
 CommandLineParser::~CommandLineParser() {
@@ -141,6 +160,18 @@ bool CommandLineParser::hasRestrictedRpcOption() const {
   return m_parser.isSet(m_restrictedRpcOption);
 }
 
+bool CommandLineParser::hasSyncBenchmarkOption() const {
+  return m_parser.isSet(m_syncBenchmarkOption);
+}
+
+bool CommandLineParser::hasMiningBenchmarkOption() const {
+  return m_parser.isSet(m_miningBenchmarkOption);
+}
+
+bool CommandLineParser::hasMiningSelfTestOption() const {
+  return m_parser.isSet(m_miningSelfTestOption);
+}
+
 quint16 CommandLineParser::getP2pExternalPort() const {
   return m_parser.value(m_p2pExternalOption).toUShort();
 }
@@ -172,4 +203,28 @@ quint32 CommandLineParser::rollBack() const {
   return m_parser.value(m_rollBackOption).toULong();
 }
 
+QString CommandLineParser::getRecordNodeFile() const {
+  return m_parser.value(m_recordNodeOption);
+}
+
+QString CommandLineParser::getReplayNodeFile() const {
+  return m_parser.value(m_replayNodeOption);
+}
+
+QString CommandLineParser::getFailoverCheckFile() const {
+  return m_parser.value(m_failoverCheckOption);
+}
+
+QString CommandLineParser::getBootstrapFile() const {
+  return m_parser.value(m_importBootstrapOption);
+}
+
+quint32 CommandLineParser::getReplayLatency() const {
+  return m_parser.value(m_replayLatencyOption).toULong();
+}
+
+quint32 CommandLineParser::getReplayThroughput() const {
+  return m_parser.value(m_replayThroughputOption).toULong();
+}
+
 }
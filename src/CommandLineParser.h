@@ -31,6 +31,9 @@ public:
   bool hasAllowReorgOption() const;
   bool hasRpcOption() const;
   bool hasRestrictedRpcOption() const;
+  bool hasSyncBenchmarkOption() const;
+  bool hasMiningBenchmarkOption() const;
+  bool hasMiningSelfTestOption() const;
   QString getErrorText() const;
   QString getHelpText() const;
   QString getP2pBindIp() const;
@@ -44,6 +47,12 @@ public:
   QStringList getSeedNodes() const;
   QString getDataDir() const;
   quint32 rollBack() const;
+  QString getRecordNodeFile() const;
+  QString getReplayNodeFile() const;
+  QString getFailoverCheckFile() const;
+  QString getBootstrapFile() const;
+  quint32 getReplayLatency() const;
+  quint32 getReplayThroughput() const;
 
 private:
   QCommandLineParser m_parser;
@@ -69,6 +78,15 @@ private:
   QCommandLineOption m_rollBackOption;
   QCommandLineOption m_allowReorgOption;
   QCommandLineOption m_minimized;
+  QCommandLineOption m_recordNodeOption;
+  QCommandLineOption m_replayNodeOption;
+  QCommandLineOption m_replayLatencyOption;
+  QCommandLineOption m_replayThroughputOption;
+  QCommandLineOption m_syncBenchmarkOption;
+  QCommandLineOption m_importBootstrapOption;
+  QCommandLineOption m_miningBenchmarkOption;
+  QCommandLineOption m_miningSelfTestOption;
+  QCommandLineOption m_failoverCheckOption;
 };
 
 }
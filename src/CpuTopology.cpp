@@ -0,0 +1,350 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+
+#include <algorithm>
+#include <thread>
+
+#if defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_TOPOLOGY_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include "CpuTopology.h"
+
+namespace WalletGui {
+
+namespace {
+
+// x86-64 and arm64 large page size, allocations are rounded up to it
+const size_t LARGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+size_t roundUp(size_t _size, size_t _step) {
+  return (_size + _step - 1) / _step * _step;
+}
+
+#if defined(Q_OS_WIN)
+// Large pages need the "Lock pages in memory" right, which the account has to
+// be granted; it is only enabled here
+bool enableLockMemoryPrivilege() {
+  static const bool enabled = []() {
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+      return false;
+    }
+
+    TOKEN_PRIVILEGES privileges;
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool result = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+      AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return result;
+  }();
+
+  return enabled;
+}
+#endif
+
+#if defined(Q_OS_LINUX)
+int readSysInt(const QString& _path, int _default) {
+  QFile file(_path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return _default;
+  }
+
+  bool ok = false;
+  int value = file.readAll().trimmed().toInt(&ok);
+  return ok ? value : _default;
+}
+#endif
+
+#if defined(CPU_TOPOLOGY_X86)
+void cpuid(unsigned _leaf, unsigned _subleaf, unsigned _registers[4]) {
+#if defined(_MSC_VER)
+  int registers[4];
+  __cpuidex(registers, _leaf, _subleaf);
+  for (int i = 0; i < 4; ++i) {
+    _registers[i] = static_cast<unsigned>(registers[i]);
+  }
+#else
+  __cpuid_count(_leaf, _subleaf, _registers[0], _registers[1], _registers[2], _registers[3]);
+#endif
+}
+#endif
+
+}
+
+const CpuTopology& CpuTopology::instance() {
+  static CpuTopology inst;
+  return inst;
+}
+
+CpuTopology::CpuTopology() {
+#if defined(Q_OS_LINUX)
+  QDir cpuDir("/sys/devices/system/cpu");
+  QMap<QPair<int, int>, int> cores;
+  for (const QString& entry : cpuDir.entryList(QStringList() << "cpu[0-9]*", QDir::Dirs)) {
+    bool ok = false;
+    const int id = entry.mid(3).toInt(&ok);
+    if (!ok || !QFile::exists(cpuDir.absoluteFilePath(entry + "/topology"))) {
+      continue;
+    }
+
+    const int package = readSysInt(cpuDir.absoluteFilePath(entry + "/topology/physical_package_id"), 0);
+    const int coreId = readSysInt(cpuDir.absoluteFilePath(entry + "/topology/core_id"), id);
+    const QPair<int, int> coreKey(package, coreId);
+    if (!cores.contains(coreKey)) {
+      cores.insert(coreKey, cores.size());
+    }
+
+    // Without NUMA support in the kernel there is no nodeN link, the package stands in
+    int node = package;
+    QStringList nodes = QDir(cpuDir.absoluteFilePath(entry)).entryList(QStringList() << "node[0-9]*", QDir::Dirs | QDir::System);
+    if (!nodes.isEmpty()) {
+      node = nodes.first().mid(4).toInt();
+    }
+
+    m_cpus.append(LogicalCpu{id, cores.value(coreKey), node});
+  }
+#elif defined(Q_OS_WIN)
+  DWORD length = 0;
+  GetLogicalProcessorInformation(nullptr, &length);
+  QVector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+  if (!infos.isEmpty() && GetLogicalProcessorInformation(infos.data(), &length)) {
+    QMap<int, int> coreOf;
+    QMap<int, int> nodeOf;
+    int core = 0;
+    for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& info : infos) {
+      for (int cpu = 0; cpu < static_cast<int>(sizeof(ULONG_PTR) * 8); ++cpu) {
+        if ((info.ProcessorMask & (static_cast<ULONG_PTR>(1) << cpu)) == 0) {
+          continue;
+        }
+
+        if (info.Relationship == RelationProcessorCore) {
+          coreOf.insert(cpu, core);
+        } else if (info.Relationship == RelationNumaNode) {
+          nodeOf.insert(cpu, info.NumaNode.NodeNumber);
+        }
+      }
+
+      if (info.Relationship == RelationProcessorCore) {
+        ++core;
+      }
+    }
+
+    for (auto it = coreOf.begin(); it != coreOf.end(); ++it) {
+      m_cpus.append(LogicalCpu{it.key(), it.value(), nodeOf.value(it.key(), 0)});
+    }
+  }
+#endif
+
+  if (m_cpus.isEmpty()) {
+    const int count = std::max<int>(std::thread::hardware_concurrency(), 1);
+    for (int i = 0; i < count; ++i) {
+      m_cpus.append(LogicalCpu{i, i, 0});
+    }
+  }
+
+  std::sort(m_cpus.begin(), m_cpus.end(), [](const LogicalCpu& _left, const LogicalCpu& _right) { return _left.id < _right.id; });
+}
+
+bool CpuTopology::isAvailable() const {
+#if defined(Q_OS_LINUX) || defined(Q_OS_WIN)
+  return true;
+#else
+  return false;
+#endif
+}
+
+int CpuTopology::nodeCount() const {
+  QSet<int> nodes;
+  for (const LogicalCpu& cpu : m_cpus) {
+    nodes.insert(cpu.node);
+  }
+
+  return nodes.size();
+}
+
+int CpuTopology::coreCount() const {
+  QSet<int> cores;
+  for (const LogicalCpu& cpu : m_cpus) {
+    cores.insert(cpu.core);
+  }
+
+  return cores.size();
+}
+
+const QVector<LogicalCpu>& CpuTopology::cpus() const {
+  return m_cpus;
+}
+
+QVector<int> CpuTopology::miningCpus(bool _skipSmt) const {
+  QMap<int, QVector<int>> byNode;
+  QSet<int> usedCores;
+  int count = 0;
+  for (const LogicalCpu& cpu : m_cpus) {
+    if (_skipSmt && usedCores.contains(cpu.core)) {
+      continue;
+    }
+
+    usedCores.insert(cpu.core);
+    byNode[cpu.node].append(cpu.id);
+    ++count;
+  }
+
+  QVector<int> result;
+  for (int i = 0; result.size() < count; ++i) {
+    for (const QVector<int>& nodeCpus : byNode) {
+      if (i < nodeCpus.size()) {
+        result.append(nodeCpus[i]);
+      }
+    }
+  }
+
+  return result;
+}
+
+QString CpuTopology::describe() const {
+  QString text = QCoreApplication::translate("CpuTopology", "%1 NUMA node(s), %2 core(s), %3 logical processor(s)").arg(nodeCount()).arg(coreCount()).arg(m_cpus.size());
+  const CpuFeatures cpuFeatures = features();
+  if (cpuFeatures.aes) {
+    text += ", AES-NI";
+  }
+
+  return text;
+}
+
+CpuFeatures CpuTopology::features() {
+  CpuFeatures result{false};
+#if defined(CPU_TOPOLOGY_X86)
+  unsigned registers[4];
+  cpuid(0, 0, registers);
+  const unsigned maxLeaf = registers[0];
+  if (maxLeaf < 1) {
+    return result;
+  }
+
+  cpuid(1, 0, registers);
+  result.aes = (registers[2] & (1u << 25)) != 0;
+#endif
+  return result;
+}
+
+bool CpuTopology::pinCurrentThread(int _cpu) {
+#if defined(Q_OS_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(_cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(Q_OS_WIN)
+  if (_cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+    return false;
+  }
+
+  return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << _cpu) != 0;
+#else
+  Q_UNUSED(_cpu);
+  return false;
+#endif
+}
+
+void* CpuTopology::allocateLocalMemory(size_t _size, bool& _largePages) {
+  _largePages = false;
+#if defined(Q_OS_LINUX)
+  const size_t size = roundUp(_size, LARGE_PAGE_SIZE);
+  void* memory = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+  // Pages reserved by the administrator first, they are never split
+  memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  _largePages = memory != MAP_FAILED;
+#endif
+  if (memory == MAP_FAILED) {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      return nullptr;
+    }
+
+#if defined(MADV_HUGEPAGE)
+    _largePages = madvise(memory, size, MADV_HUGEPAGE) == 0;
+#endif
+  }
+
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+  // Bound before the first touch, so pages faulted in after the thread
+  // migrated still come from its node. MPOL_PREFERRED falls back to other
+  // nodes when this one is full.
+  const int MPOL_PREFERRED = 1;
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 && node < sizeof(unsigned long) * 8) {
+    unsigned long nodeMask = 1UL << node;
+    syscall(SYS_mbind, memory, size, MPOL_PREFERRED, &nodeMask, sizeof(nodeMask) * 8, 0);
+  }
+#endif
+
+  return memory;
+#elif defined(Q_OS_WIN)
+  PROCESSOR_NUMBER processor;
+  USHORT node = 0;
+  GetCurrentProcessorNumberEx(&processor);
+  if (!GetNumaProcessorNodeEx(&processor, &node)) {
+    node = 0;
+  }
+
+  const SIZE_T largePageSize = GetLargePageMinimum();
+  void* memory = nullptr;
+  if (largePageSize > 0 && enableLockMemoryPrivilege()) {
+    memory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, roundUp(_size, largePageSize), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+      PAGE_READWRITE, node);
+    _largePages = memory != nullptr;
+  }
+
+  if (memory == nullptr) {
+    memory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, _size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+  }
+
+  return memory;
+#else
+  void* memory = mmap(nullptr, roundUp(_size, LARGE_PAGE_SIZE), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  return memory != MAP_FAILED ? memory : nullptr;
+#endif
+}
+
+void CpuTopology::freeLocalMemory(void* _memory, size_t _size) {
+  if (_memory == nullptr) {
+    return;
+  }
+
+#if defined(Q_OS_WIN)
+  Q_UNUSED(_size);
+  VirtualFree(_memory, 0, MEM_RELEASE);
+#else
+  munmap(_memory, roundUp(_size, LARGE_PAGE_SIZE));
+#endif
+}
+
+}
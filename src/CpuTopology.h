@@ -0,0 +1,57 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include <cstddef>
+
+namespace WalletGui {
+
+struct LogicalCpu {
+  int id;
+  int core;    // physical core, SMT siblings share it
+  int node;    // NUMA node, the package where there is no NUMA information
+};
+
+// Instruction set extensions the hashing code can make use of
+struct CpuFeatures {
+  bool aes;
+};
+
+// Logical processors of the machine and pinning of the calling thread. Where
+// the platform offers no topology or affinity API everything degrades to a
+// flat list and pinning is a no-op.
+class CpuTopology {
+public:
+  static const CpuTopology& instance();
+
+  bool isAvailable() const;
+  int nodeCount() const;
+  int coreCount() const;
+  const QVector<LogicalCpu>& cpus() const;
+
+  // Logical processors to pin mining threads to, in order. Spread over NUMA
+  // nodes so few threads still use every memory controller; with _skipSmt only
+  // the first logical processor of each core.
+  QVector<int> miningCpus(bool _skipSmt) const;
+  QString describe() const;
+
+  static bool pinCurrentThread(int _cpu);
+  // Memory for the working set of the calling thread, bound to the NUMA node it
+  // runs on and backed by large pages where the system grants them, otherwise
+  // regular pages; _largePages tells which. Page aligned, null if out of memory.
+  static void* allocateLocalMemory(size_t _size, bool& _largePages);
+  static void freeLocalMemory(void* _memory, size_t _size);
+  static CpuFeatures features();
+
+private:
+  QVector<LogicalCpu> m_cpus;
+
+  CpuTopology();
+};
+
+}
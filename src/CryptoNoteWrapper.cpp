@@ -3,8 +3,18 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
 #include <limits>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <QJsonArray>
+#include <QJsonObject>
 #include "CryptoNoteWrapper.h"
 #include "Checkpoints/Checkpoints.h"
 #include "Checkpoints/CheckpointsData.h"
@@ -20,6 +30,7 @@
 #include "CryptoNoteCore/Miner.h"
 #include "CryptoNoteCore/MinerConfig.h"
 #include "CryptoNoteCore/TransactionExtra.h"
+#include "CryptoNoteCore/VerificationContext.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Rpc/RpcServer.h"
 #include "Rpc/JsonRpc.h"
@@ -30,6 +41,9 @@
 #include "Logging/LoggerManager.h"
 #include "LoggerAdapter.h"
 #include "CurrencyAdapter.h"
+#include "DaemonRpcClient.h"
+#include "DecoyCache.h"
+#include "DnsCheckpoints.h"
 #include "Settings.h"
 
 #ifndef AUTO_VAL_INIT
@@ -78,6 +92,13 @@ std::string extractPaymentId(const std::string& extra) {
   return res;
 }
 
+// Decoys older than this are not used, the node may have pruned them from its choice
+const uint32_t DECOY_CACHE_MAX_AGE = 20;
+// Entries kept per amount, enough for a few sends with the default mixin
+const size_t DECOY_CACHE_TARGET_SIZE = 64;
+// Longest wait for a call run on the builtin node's dispatcher, a bootstrap batch included
+const std::chrono::seconds DISPATCHER_CALL_TIMEOUT(60);
+
 inline std::string interpret_rpc_response(bool ok, const std::string& status) {
   std::string err;
   if (ok) {
@@ -97,6 +118,107 @@ inline std::string interpret_rpc_response(bool ok, const std::string& status) {
 Node::~Node() {
 }
 
+// NodeRpcProxy that serves random outputs for sends from a prefetched DecoyCache
+class CachingNodeRpcProxy : public CryptoNote::NodeRpcProxy {
+public:
+  CachingNodeRpcProxy(const std::string& nodeHost, unsigned short nodePort, const std::string& path, bool& enableSSL) :
+    CryptoNote::NodeRpcProxy(nodeHost, nodePort, path, enableSSL),
+    m_decoys(DECOY_CACHE_MAX_AGE, DECOY_CACHE_TARGET_SIZE),
+    m_refillInProgress(false),
+    m_callbacksStopped(false),
+    m_callbackThread(&CachingNodeRpcProxy::callbackLoop, this)
+  {
+  }
+
+  ~CachingNodeRpcProxy() override {
+    // stop the worker before the cache goes away, refill callbacks use it
+    shutdown();
+    {
+      std::lock_guard<std::mutex> lock(m_callbackMutex);
+      m_callbacksStopped = true;
+    }
+
+    m_callbackCondition.notify_one();
+    m_callbackThread.join();
+  }
+
+  void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint16_t outsCount,
+    std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override {
+    m_decoys.watch(amounts);
+    if (m_decoys.take(amounts, outsCount, result)) {
+      // WalletLegacy expects the answer later and from another thread, as
+      // the proxy's worker gives it, never from within this call
+      postCallback(callback);
+    } else {
+      CryptoNote::NodeRpcProxy::getRandomOutsByAmounts(std::move(amounts), outsCount, result, callback);
+    }
+
+    refillDecoys();
+  }
+
+  void prefetchRandomOuts(const std::vector<uint64_t>& amounts) {
+    m_decoys.watch(amounts);
+    refillDecoys();
+  }
+
+  void expireDecoys(uint32_t height) {
+    m_decoys.expire(height);
+    refillDecoys();
+  }
+
+private:
+  DecoyCache m_decoys;
+  std::atomic<bool> m_refillInProgress;
+  std::mutex m_callbackMutex;
+  std::condition_variable m_callbackCondition;
+  std::deque<Callback> m_callbacks;
+  bool m_callbacksStopped;
+  std::thread m_callbackThread;
+
+  void postCallback(const Callback& callback) {
+    {
+      std::lock_guard<std::mutex> lock(m_callbackMutex);
+      m_callbacks.push_back(callback);
+    }
+
+    m_callbackCondition.notify_one();
+  }
+
+  // Answers served from the cache are delivered in order; the ones still
+  // queued on shutdown are delivered before the thread ends
+  void callbackLoop() {
+    std::unique_lock<std::mutex> lock(m_callbackMutex);
+    for (;;) {
+      m_callbackCondition.wait(lock, [this]() { return m_callbacksStopped || !m_callbacks.empty(); });
+      if (m_callbacks.empty()) {
+        return;
+      }
+
+      Callback callback = std::move(m_callbacks.front());
+      m_callbacks.pop_front();
+      lock.unlock();
+      callback(std::error_code());
+      lock.lock();
+    }
+  }
+
+  void refillDecoys() {
+    std::vector<uint64_t> amounts = m_decoys.amountsToRefill();
+    if (amounts.empty() || m_refillInProgress.exchange(true)) {
+      return;
+    }
+
+    auto outs = std::make_shared<std::vector<CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>>();
+    CryptoNote::NodeRpcProxy::getRandomOutsByAmounts(std::move(amounts), static_cast<uint16_t>(m_decoys.targetSize()), *outs,
+      [this, outs](std::error_code ec) {
+        if (!ec) {
+          m_decoys.put(getLastLocalBlockHeight(), *outs);
+        }
+        m_refillInProgress = false;
+      });
+  }
+};
+
 class RpcNode : public CryptoNote::INodeObserver, public CryptoNote::INodeRpcProxyObserver, public Node {
 public:
   Logging::LoggerManager& m_logManager;
@@ -107,7 +229,8 @@ public:
     m_dispatcher(),
     m_logManager(logManager),
     m_logger(m_logManager, "RpcNode"),
-    m_node(nodeHost, nodePort, "/", enableSSL)
+    m_node(nodeHost, nodePort, "/", enableSSL),
+    m_rpcClient(QString::fromStdString(nodeHost), nodePort, enableSSL)
   {
     m_node.addObserver(dynamic_cast<INodeObserver*>(this));
     m_node.addObserver(dynamic_cast<INodeRpcProxyObserver*>(this));
@@ -209,43 +332,134 @@ public:
   }
 
   bool getBlockTemplate(CryptoNote::Block& b, const CryptoNote::AccountKeys& acc, const CryptoNote::BinaryArray& ex_nonce, CryptoNote::difficulty_type& diffic, uint32_t& height) override {
-    // not implemented
-    return false;
+    QJsonObject params;
+    params.insert("reserve_size", static_cast<int>(ex_nonce.size()));
+    params.insert("wallet_address", QString::fromStdString(m_currency.accountAddressAsString(acc.address)));
+    QJsonObject result;
+    QString error;
+    if (!m_rpcClient.call("getblocktemplate", params, result, error) || result.value("status").toString() != "OK") {
+      m_logger(Logging::ERROR) << "getblocktemplate failed: " << (error.isEmpty() ? result.value("status").toString() : error).toStdString();
+      return false;
+    }
+
+    CryptoNote::BinaryArray blob;
+    if (!Common::fromHex(result.value("blocktemplate_blob").toString().toStdString(), blob)) {
+      m_logger(Logging::ERROR) << "getblocktemplate returned a malformed blob";
+      return false;
+    }
+
+    // The daemon leaves the requested room in the coinbase extra, the nonce goes there
+    const size_t reservedOffset = static_cast<size_t>(result.value("reserved_offset").toVariant().toULongLong());
+    if (!ex_nonce.empty()) {
+      if (reservedOffset == 0 || reservedOffset + ex_nonce.size() > blob.size()) {
+        m_logger(Logging::ERROR) << "getblocktemplate returned no room for the extra nonce";
+        return false;
+      }
+
+      std::copy(ex_nonce.begin(), ex_nonce.end(), blob.begin() + reservedOffset);
+    }
+
+    if (!CryptoNote::fromBinaryArray(b, blob)) {
+      m_logger(Logging::ERROR) << "Failed to parse the block template";
+      return false;
+    }
+
+    diffic = static_cast<CryptoNote::difficulty_type>(result.value("difficulty").toVariant().toULongLong());
+    height = static_cast<uint32_t>(result.value("height").toVariant().toULongLong());
+    return true;
   }
 
   bool handleBlockFound(CryptoNote::Block& b) override {
-    // not implemented
-    return false;
+    QJsonArray params;
+    params.append(QString::fromStdString(Common::toHex(CryptoNote::toBinaryArray(b))));
+    QJsonObject result;
+    QString error;
+    if (!m_rpcClient.call("submitblock", params, result, error) || result.value("status").toString() != "OK") {
+      m_logger(Logging::ERROR) << "submitblock failed: " << (error.isEmpty() ? result.value("status").toString() : error).toStdString();
+      return false;
+    }
+
+    return true;
   }
   
   bool getBlockLongHash(Crypto::cn_context &context, const CryptoNote::Block& block, Crypto::Hash& res) override {
-    // unsupported
+    // From version 5 on the PoW mixes in blocks picked from the whole chain,
+    // only a node holding it can compute that
+    if (block.majorVersion >= CryptoNote::BLOCK_MAJOR_VERSION_5) {
+      m_logger(Logging::ERROR) << "Blocks of version " << static_cast<int>(block.majorVersion) << " can only be mined with the builtin node";
+      return false;
+    }
+
+    return CryptoNote::get_block_longhash(context, block, res);
+  }
+
+  bool getReserveProofSpent(const std::string& address, const std::string& message, const std::string& proof,
+    const std::vector<std::pair<Crypto::KeyImage, uint64_t>>& outputs, uint64_t& spent) override {
+    // the daemon's check_reserve_proof sums the spent outputs of the proof it verified
+    QJsonObject params;
+    params.insert("address", QString::fromStdString(address));
+    params.insert("message", QString::fromStdString(message));
+    params.insert("signature", QString::fromStdString(proof));
+    QJsonObject result;
+    QString error;
+    if (!m_rpcClient.call("check_reserve_proof", params, result, error) || !result.value("good").toBool()) {
+      m_logger(Logging::DEBUGGING) << "check_reserve_proof failed: " << (error.isEmpty() ? result.value("status").toString() : error).toStdString();
+      return false;
+    }
+
+    spent = result.value("spent").toVariant().toULongLong();
+    return true;
+  }
+
+  void setCheckpoints(const std::map<uint32_t, std::string>& checkpoints) override {
+    // checkpoints are up to the daemon
+  }
+
+  bool isRpcServerRunning() override {
     return false;
   }
 
-  uint64_t getAlreadyGeneratedCoins() override {
-    return m_node.getAlreadyGeneratedCoins();
+  uint32_t getLastCheckpointHeight() override {
+    return 0;
   }
 
-  std::vector<CryptoNote::p2pConnection> getConnections() override {
-    std::vector<CryptoNote::p2pConnection> connections;
+  size_t importBlocks(const std::vector<ImportedBlock>& blocks) override {
+    // there is no local core to import into
+    return 0;
+  }
 
-    auto getConnectionsCompleted = std::promise<std::error_code>();
-    auto getConnectionsWaitFuture = getConnectionsCompleted.get_future();
+  bool exportBlocks(uint32_t startHeight, uint32_t count, std::vector<RawBlock>& blocks) override {
+    return false;
+  }
 
-    m_node.getConnections(std::ref(connections),
-      [&getConnectionsCompleted](std::error_code ec) {
-      auto detachedPromise = std::move(getConnectionsCompleted);
-      detachedPromise.set_value(ec);
-    });
+  uint64_t getAlreadyGeneratedCoins() override {
+    return m_node.getAlreadyGeneratedCoins();
+  }
 
-    std::error_code ec = getConnectionsWaitFuture.get();
+  void prefetchRandomOuts(const std::vector<uint64_t>& amounts) override {
+    m_node.prefetchRandomOuts(amounts);
+  }
 
-    if (ec) {
-     m_logger(Logging::INFO) << "Failed to get connections: " << ec << ", " << ec.message();
-    }
+  void getConnections(std::vector<CryptoNote::p2pConnection>& _connections, const std::function<void(std::error_code)>& _callback) override {
+    m_node.getConnections(_connections, _callback);
+  }
 
-    return connections;
+  void getCounters(const std::function<void(const NodeCounters&)>& _callback) override {
+    // The proxy keeps them from its last getinfo, no request is made
+    NodeCounters counters;
+    counters.difficulty = getDifficulty();
+    counters.nextReward = getNextReward();
+    counters.txCount = getTxCount();
+    counters.txPoolSize = getTxPoolSize();
+    counters.altBlocksCount = getAltBlocksCount();
+    counters.connectionsCount = getConnectionsCount();
+    counters.outgoingConnectionsCount = getOutgoingConnectionsCount();
+    counters.incomingConnectionsCount = getIncomingConnectionsCount();
+    counters.whitePeerlistSize = getWhitePeerlistSize();
+    counters.greyPeerlistSize = getGreyPeerlistSize();
+    counters.alreadyGeneratedCoins = getAlreadyGeneratedCoins();
+    counters.minimalFee = getMinimalFee();
+    _callback(counters);
   }
 
   NodeType getNodeType() const override {
@@ -267,7 +481,8 @@ public:
 private:
   INodeCallback& m_callback;
   const CryptoNote::Currency& m_currency;
-  CryptoNote::NodeRpcProxy m_node;
+  CachingNodeRpcProxy m_node;
+  DaemonRpcClient m_rpcClient;
   System::Dispatcher m_dispatcher;
   Logging::LoggerRef m_logger;
 
@@ -276,6 +491,7 @@ private:
   }
 
   void localBlockchainUpdated(uint32_t height) override {
+    m_node.expireDecoys(height);
     m_callback.localBlockchainUpdated(*this, height);
   }
 
@@ -309,7 +525,11 @@ public:
     m_protocolHandler(currency, m_dispatcher, m_core, nullptr, logManager),
     m_core(currency, &m_protocolHandler, logManager, m_dispatcher, true, false, false),
     m_nodeServer(m_dispatcher, m_protocolHandler, logManager),
-    m_node(m_core, m_protocolHandler)
+    m_node(m_core, m_protocolHandler),
+    m_checkpointsEnabled(false),
+    m_allowReorg(false),
+    m_stopping(false),
+    m_rpcServerRunning(false)
   {
 
       if (Settings::instance().withoutCheckpoints()) {
@@ -321,12 +541,11 @@ public:
         if (allowReorg) {
           m_logger(Logging::WARNING) << "Deep reorganization is allowed!";
         }
-        CryptoNote::Checkpoints checkpoints(logManager, allowReorg);
-        checkpoints.load_checkpoints_from_dns();
-        for (const CryptoNote::CheckpointData& checkpoint : CryptoNote::CHECKPOINTS) {
-          checkpoints.add_checkpoint(checkpoint.height, checkpoint.blockId);
-        }
-        m_core.set_checkpoints(std::move(checkpoints));
+        // DNS checkpoints are looked up by NodeAdapter meanwhile, start with the last good set
+        m_checkpointsEnabled = true;
+        m_allowReorg = allowReorg;
+        m_extraCheckpoints = DnsCheckpoints::loadCache(Settings::instance().getDataDir().absoluteFilePath(CHECKPOINTS_CACHE_FILE));
+        m_core.set_checkpoints(makeCheckpoints());
       }
 
       m_core.set_cryptonote_protocol(&m_protocolHandler);
@@ -356,11 +575,20 @@ public:
         return;
       }
 
-      if (Settings::instance().hasRunRpc()) {
+      // In hybrid mode the wallet reaches the builtin node through its rpc server
+      if (Settings::instance().hasRunRpc() || Settings::instance().getConnection() == "hybrid") {
         m_logger(Logging::INFO) << "Starting core rpc server...";
         m_rpcServer = new CryptoNote::RpcServer(m_rpcServerConfig, m_dispatcher, m_logManager, m_core, m_nodeServer, m_protocolHandler);
-        m_rpcServer->start();
-        m_logger(Logging::INFO) << "Core rpc server started ok";
+        // A busy port, e.g. a daemon already running, leaves the node without rpc server
+        try {
+          m_rpcServer->start();
+          m_rpcServerRunning = true;
+          m_logger(Logging::INFO) << "Core rpc server started ok";
+        } catch (std::exception& _err) {
+          m_logger(Logging::ERROR) << "Failed to start core rpc server: " << _err.what();
+          delete m_rpcServer;
+          m_rpcServer = nullptr;
+        }
       }
 
     } catch (std::runtime_error& _err) {
@@ -375,7 +603,8 @@ public:
 
     m_nodeServer.run();
     m_nodeServer.deinit();
-    if (Settings::instance().hasRunRpc() && m_rpcServer != nullptr) {
+    if (m_rpcServer != nullptr) {
+      m_rpcServerRunning = false;
       m_rpcServer->stop();
     }
     m_core.deinit();
@@ -383,6 +612,7 @@ public:
   }
 
   void deinit() override {
+    m_stopping = true;
     m_nodeServer.sendStopSignal();
   }
 
@@ -482,29 +712,169 @@ public:
     return m_core.getBlockLongHash(context, block, res);
   }
 
-  uint64_t getAlreadyGeneratedCoins() override {
-    return m_node.getAlreadyGeneratedCoins();
-  }
+  bool getReserveProofSpent(const std::string& address, const std::string& message, const std::string& proof,
+    const std::vector<std::pair<Crypto::KeyImage, uint64_t>>& outputs, uint64_t& spent) override {
+    return callOnDispatcher<uint64_t>([this, outputs]() -> uint64_t {
+      uint64_t amount = 0;
+      for (const auto& output : outputs) {
+        if (m_core.is_key_image_spent(output.first)) {
+          amount += output.second;
+        }
+      }
 
-  std::vector<CryptoNote::p2pConnection> getConnections() override {
-    std::vector<CryptoNote::p2pConnection> connections;
+      return amount;
+    }, spent);
+  }
 
-    auto getConnectionsCompleted = std::promise<std::error_code>();
-    auto getConnectionsWaitFuture = getConnectionsCompleted.get_future();
+  void setCheckpoints(const std::map<uint32_t, std::string>& checkpoints) override {
+    if (!m_checkpointsEnabled) {
+      return;
+    }
 
-    m_node.getConnections(std::ref(connections),
-      [&getConnectionsCompleted](std::error_code ec) {
-      auto detachedPromise = std::move(getConnectionsCompleted);
-      detachedPromise.set_value(ec);
+    // The core is only touched from its dispatcher thread
+    m_dispatcher.remoteSpawn([this, checkpoints]() {
+      // A checkpoint dropped from DNS is gone from the core as well
+      m_extraCheckpoints = checkpoints;
+      m_core.set_checkpoints(makeCheckpoints());
+      m_logger(Logging::INFO) << "Checkpoints updated, " << m_extraCheckpoints.size() << " from DNS";
     });
+  }
+
+  bool isRpcServerRunning() override {
+    return m_rpcServerRunning;
+  }
+
+  uint32_t getLastCheckpointHeight() override {
+    uint32_t height = 0;
+    callOnDispatcher<uint32_t>([this]() -> uint32_t {
+      const std::map<uint32_t, std::string> points = checkpointPoints();
+      return points.empty() ? 0 : points.rbegin()->first;
+    }, height);
+
+    return height;
+  }
+
+  size_t importBlocks(const std::vector<ImportedBlock>& blocks) override {
+    // Committed in order on the dispatcher thread, the way the protocol handler
+    // commits synchronized blocks: transactions first, then the block. Blocks
+    // the chain already has, e.g. from the network meanwhile, are skipped. A
+    // block has to extend the chain and match a checkpoint at its height; the
+    // core skips proof of work inside the checkpoint zone and checks it above.
+    size_t imported = 0;
+    callOnDispatcher<size_t>([this, blocks]() -> size_t {
+      const std::map<uint32_t, std::string> points = checkpointPoints();
+      size_t count = 0;
+      for (const ImportedBlock& importedBlock : blocks) {
+        if (importedBlock.height < m_core.get_current_blockchain_height()) {
+          ++count;
+          continue;
+        }
+
+        if (importedBlock.block.previousBlockHash != m_core.get_tail_id()) {
+          break;
+        }
 
-    std::error_code ec = getConnectionsWaitFuture.get();
+        auto checkpoint = points.find(importedBlock.height);
+        if (checkpoint != points.end() && checkpoint->second != Common::podToHex(importedBlock.id)) {
+          break;
+        }
+
+        bool accepted = true;
+        for (size_t i = 0; i < importedBlock.transactions.size() && accepted; ++i) {
+          CryptoNote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
+          accepted = m_core.handleIncomingTransaction(importedBlock.transactions[i], importedBlock.transactionHashes[i],
+            importedBlock.transactionSizes[i], tvc, true, importedBlock.height) && !tvc.m_verifivation_failed;
+        }
+
+        CryptoNote::block_verification_context bvc = AUTO_VAL_INIT(bvc);
+        if (accepted) {
+          m_core.handle_incoming_block(importedBlock.block, bvc, false, false);
+        }
+
+        if (!accepted || bvc.m_verifivation_failed || !bvc.m_added_to_main_chain) {
+          break;
+        }
+
+        ++count;
+      }
+
+      return count;
+    }, imported);
+
+    return imported;
+  }
+
+  bool exportBlocks(uint32_t startHeight, uint32_t count, std::vector<RawBlock>& blocks) override {
+    std::pair<bool, std::vector<RawBlock>> result;
+    if (!callOnDispatcher<std::pair<bool, std::vector<RawBlock>>>([this, startHeight, count]() -> std::pair<bool, std::vector<RawBlock>> {
+      std::pair<bool, std::vector<RawBlock>> exported(true, std::vector<RawBlock>());
+      const uint32_t height = m_core.getCurrentBlockchainHeight();
+      for (uint32_t index = startHeight; index < height && exported.second.size() < count; ++index) {
+        CryptoNote::Block block;
+        if (!m_core.getBlockByHash(m_core.getBlockIdByHeight(index), block)) {
+          exported.first = false;
+          break;
+        }
+
+        std::list<CryptoNote::Transaction> transactions;
+        std::list<Crypto::Hash> missed;
+        m_core.getTransactions(block.transactionHashes, transactions, missed);
+        if (!missed.empty()) {
+          exported.first = false;
+          break;
+        }
+
+        RawBlock rawBlock;
+        rawBlock.block = CryptoNote::toBinaryArray(block);
+        for (const CryptoNote::Transaction& transaction : transactions) {
+          rawBlock.transactions.push_back(CryptoNote::toBinaryArray(transaction));
+        }
 
-    if (ec) {
-      m_logger(Logging::INFO) << "Failed to get connections: " << ec << ", " << ec.message();
+        exported.second.push_back(std::move(rawBlock));
+      }
+
+      return exported;
+    }, result) || !result.first) {
+      return false;
+    }
+
+    blocks = std::move(result.second);
+    return true;
+  }
+
+  uint64_t getAlreadyGeneratedCoins() override {
+    return m_node.getAlreadyGeneratedCoins();
+  }
+
+  void prefetchRandomOuts(const std::vector<uint64_t>& amounts) override {
+    // random outputs are picked from the local core, nothing to prefetch
+  }
+
+  void getConnections(std::vector<CryptoNote::p2pConnection>& _connections, const std::function<void(std::error_code)>& _callback) override {
+    m_node.getConnections(_connections, _callback);
+  }
+
+  void getCounters(const std::function<void(const NodeCounters&)>& _callback) override {
+    if (m_stopping) {
+      return;
     }
 
-    return connections;
+    m_dispatcher.remoteSpawn([this, _callback]() {
+      NodeCounters counters;
+      counters.difficulty = getDifficulty();
+      counters.nextReward = getNextReward();
+      counters.txCount = getTxCount();
+      counters.txPoolSize = getTxPoolSize();
+      counters.altBlocksCount = getAltBlocksCount();
+      counters.connectionsCount = getConnectionsCount();
+      counters.outgoingConnectionsCount = getOutgoingConnectionsCount();
+      counters.incomingConnectionsCount = getIncomingConnectionsCount();
+      counters.whitePeerlistSize = getWhitePeerlistSize();
+      counters.greyPeerlistSize = getGreyPeerlistSize();
+      counters.alreadyGeneratedCoins = getAlreadyGeneratedCoins();
+      counters.minimalFee = getMinimalFee();
+      _callback(counters);
+    });
   }
 
   NodeType getNodeType() const override {
@@ -537,6 +907,63 @@ private:
   std::future<bool> m_nodeServerFuture;
   Logging::LoggerRef m_logger;
   CryptoNote::RpcServer* m_rpcServer;
+  bool m_checkpointsEnabled;
+  bool m_allowReorg;
+  std::map<uint32_t, std::string> m_extraCheckpoints;
+  std::atomic<bool> m_stopping;
+  std::atomic<bool> m_rpcServerRunning;
+
+  // Runs a call on the dispatcher thread, the only one the core may be touched
+  // from. It captures by value and waits a bounded time, so a stopping or stuck
+  // dispatcher fails the call instead of hanging the caller, and a call given up
+  // on never touches the caller's stack.
+  template<typename T>
+  bool callOnDispatcher(const std::function<T()>& call, T& result) {
+    if (m_stopping) {
+      return false;
+    }
+
+    std::shared_ptr<std::promise<T>> promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+    m_dispatcher.remoteSpawn([promise, call]() {
+      promise->set_value(call());
+    });
+
+    if (future.wait_for(DISPATCHER_CALL_TIMEOUT) != std::future_status::ready) {
+      m_logger(Logging::WARNING) << "The core did not answer in time";
+      return false;
+    }
+
+    result = future.get();
+    return true;
+  }
+
+  // Compiled-in checkpoints win over DNS ones at the same height
+  std::map<uint32_t, std::string> checkpointPoints() const {
+    std::map<uint32_t, std::string> points;
+    if (!m_checkpointsEnabled) {
+      return points;
+    }
+
+    for (const CryptoNote::CheckpointData& checkpoint : CryptoNote::CHECKPOINTS) {
+      points.emplace(checkpoint.height, checkpoint.blockId);
+    }
+
+    for (const auto& checkpoint : m_extraCheckpoints) {
+      points.emplace(checkpoint.first, checkpoint.second);
+    }
+
+    return points;
+  }
+
+  CryptoNote::Checkpoints makeCheckpoints() {
+    CryptoNote::Checkpoints checkpoints(m_logManager, m_allowReorg);
+    for (const auto& checkpoint : checkpointPoints()) {
+      checkpoints.add_checkpoint(checkpoint.first, checkpoint.second);
+    }
+
+    return checkpoints;
+  }
 
   void peerCountUpdated(size_t count) override {
     m_callback.peerCountUpdated(*this, count);
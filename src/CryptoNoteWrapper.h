@@ -6,6 +6,7 @@
 #pragma once
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <system_error>
@@ -35,6 +36,38 @@ enum class NodeType {
   UNKNOWN, IN_PROCESS, RPC
 };
 
+// A block and its transactions as stored in a bootstrap file
+struct RawBlock {
+  CryptoNote::BinaryArray block;
+  std::vector<CryptoNote::BinaryArray> transactions;
+};
+
+// A bootstrap block as decoded by the importer, the core takes it as it is
+struct ImportedBlock {
+  uint32_t height;
+  Crypto::Hash id;
+  CryptoNote::Block block;
+  std::vector<CryptoNote::Transaction> transactions;
+  std::vector<Crypto::Hash> transactionHashes;
+  std::vector<size_t> transactionSizes;
+};
+
+// Node statistics beyond heights and peers, collected in one pass
+struct NodeCounters {
+  uint64_t difficulty;
+  uint64_t nextReward;
+  uint64_t txCount;
+  uint64_t txPoolSize;
+  uint64_t altBlocksCount;
+  uint64_t connectionsCount;
+  uint64_t outgoingConnectionsCount;
+  uint64_t incomingConnectionsCount;
+  uint64_t whitePeerlistSize;
+  uint64_t greyPeerlistSize;
+  uint64_t alreadyGeneratedCoins;
+  uint64_t minimalFee;
+};
+
 class Node {
 public:
   virtual ~Node() = 0;
@@ -62,11 +95,33 @@ public:
   virtual uint64_t feeAmount() const = 0;
   virtual uint8_t getCurrentBlockMajorVersion() = 0;
   virtual uint64_t getAlreadyGeneratedCoins() = 0;
+  virtual void prefetchRandomOuts(const std::vector<uint64_t>& amounts) = 0;
   virtual CryptoNote::BlockHeaderInfo getLastLocalBlockHeaderInfo() = 0;
-  virtual std::vector<CryptoNote::p2pConnection> getConnections() = 0;
+  // The callback runs on a node thread, _connections must stay alive until then
+  virtual void getConnections(std::vector<CryptoNote::p2pConnection>& _connections, const std::function<void(std::error_code)>& _callback) = 0;
+  // The callback runs on a node thread. The builtin node collects the counters on
+  // its dispatcher, a pass still queued when the node stops is dropped with it.
+  virtual void getCounters(const std::function<void(const NodeCounters&)>& _callback) = 0;
   virtual bool getBlockTemplate(CryptoNote::Block& b, const CryptoNote::AccountKeys& acc, const CryptoNote::BinaryArray& ex_nonce, CryptoNote::difficulty_type& diffic, uint32_t& height) = 0;
   virtual bool handleBlockFound(CryptoNote::Block& b) = 0;
   virtual bool getBlockLongHash(Crypto::cn_context &context, const CryptoNote::Block& block, Crypto::Hash& res) = 0;
+  // Amount of a reserve proof's outputs, key image and amount each, that the chain has
+  // spent since. The builtin core looks the key images up, a daemon checks the whole proof.
+  virtual bool getReserveProofSpent(const std::string& address, const std::string& message, const std::string& proof,
+    const std::vector<std::pair<Crypto::KeyImage, uint64_t>>& outputs, uint64_t& spent) = 0;
+  // Replaces the previously set ones in the running core, the compiled-in
+  // checkpoints are always kept
+  virtual void setCheckpoints(const std::map<uint32_t, std::string>& checkpoints) = 0;
+  // Whether the builtin node's own rpc server is listening, false for a node reached over rpc
+  virtual bool isRpcServerRunning() = 0;
+  // Highest checkpoint the builtin core has, 0 without checkpoints
+  virtual uint32_t getLastCheckpointHeight() = 0;
+  // Bootstrap import into the builtin core, blocks in chain order. Blocks at or
+  // below the tail count as added. Returns how many of them were added before
+  // the first one that does not extend the chain, fails a checkpoint or is rejected.
+  virtual size_t importBlocks(const std::vector<ImportedBlock>& blocks) = 0;
+  // Bootstrap export from the builtin core, up to count blocks from startHeight
+  virtual bool exportBlocks(uint32_t startHeight, uint32_t count, std::vector<RawBlock>& blocks) = 0;
 
   virtual NodeType getNodeType() const = 0;
 
@@ -0,0 +1,60 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QUrl>
+
+#include "DaemonRpcClient.h"
+
+namespace WalletGui {
+
+DaemonRpcClient::DaemonRpcClient(const QString& _host, quint16 _port, bool _ssl) : m_host(_host), m_port(_port), m_ssl(_ssl) {
+}
+
+bool DaemonRpcClient::call(const QString& _method, const QJsonValue& _params, QJsonObject& _result, QString& _error, int _timeout) const {
+  QUrl url;
+  url.setScheme(m_ssl ? "https" : "http");
+  url.setHost(m_host);
+  url.setPort(m_port);
+  url.setPath("/json_rpc");
+  QNetworkRequest request(url);
+  request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+
+  QJsonObject body;
+  body.insert("jsonrpc", "2.0");
+  body.insert("id", "0");
+  body.insert("method", _method);
+  body.insert("params", _params);
+
+  QNetworkAccessManager manager;
+  QEventLoop loop;
+  QScopedPointer<QNetworkReply> reply(manager.post(request, QJsonDocument(body).toJson(QJsonDocument::Compact)));
+  QObject::connect(reply.data(), &QNetworkReply::finished, &loop, &QEventLoop::quit);
+  QTimer::singleShot(_timeout, reply.data(), &QNetworkReply::abort);
+  if (!reply->isFinished()) {
+    loop.exec();
+  }
+
+  if (reply->error() != QNetworkReply::NoError) {
+    _error = reply->errorString();
+    return false;
+  }
+
+  QJsonObject answer = QJsonDocument::fromJson(reply->readAll()).object();
+  if (answer.contains("error")) {
+    _error = answer.value("error").toObject().value("message").toString();
+    return false;
+  }
+
+  _result = answer.value("result").toObject();
+  return true;
+}
+
+}
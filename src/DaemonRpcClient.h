@@ -0,0 +1,30 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+
+namespace WalletGui {
+
+// Blocking JSON-RPC 2.0 calls to a daemon's /json_rpc. Usable from any thread,
+// including plain std::threads: every call runs its own network manager and
+// event loop, so it is meant for rare calls like mining templates.
+class DaemonRpcClient {
+public:
+  DaemonRpcClient(const QString& _host, quint16 _port, bool _ssl);
+
+  // False on a transport error, a timeout or an error object in the answer;
+  // _error then says which
+  bool call(const QString& _method, const QJsonValue& _params, QJsonObject& _result, QString& _error, int _timeout = 10000) const;
+
+private:
+  QString m_host;
+  quint16 m_port;
+  bool m_ssl;
+};
+
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+
+#include "DecoyCache.h"
+
+namespace WalletGui {
+
+DecoyCache::DecoyCache(uint32_t _maxAge, size_t _targetSize) : m_maxAge(_maxAge), m_targetSize(_targetSize),
+  m_hits(0), m_misses(0) {
+}
+
+bool DecoyCache::take(const std::vector<uint64_t>& _amounts, uint16_t _count, std::vector<OutsForAmount>& _result) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // The same amount may be requested several times, one per input
+  std::map<uint64_t, size_t> required;
+  for (uint64_t amount : _amounts) {
+    required[amount] += _count;
+  }
+
+  for (const auto& kv : required) {
+    auto it = m_entries.find(kv.first);
+    if (it == m_entries.end() || it->second.size() < kv.second) {
+      ++m_misses;
+      return false;
+    }
+  }
+
+  _result.clear();
+  _result.reserve(_amounts.size());
+  for (uint64_t amount : _amounts) {
+    std::vector<Entry>& entries = m_entries[amount];
+    OutsForAmount outs;
+    outs.amount = amount;
+    outs.outs.reserve(_count);
+    for (uint16_t i = 0; i < _count; ++i) {
+      outs.outs.push_back(entries.back().out);
+      entries.pop_back();
+    }
+
+    std::sort(outs.outs.begin(), outs.outs.end(), [](const OutEntry& a, const OutEntry& b) {
+      return a.global_amount_index < b.global_amount_index;
+    });
+    _result.push_back(std::move(outs));
+  }
+
+  ++m_hits;
+  return true;
+}
+
+void DecoyCache::put(uint32_t _height, const std::vector<OutsForAmount>& _outs) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const OutsForAmount& outs : _outs) {
+    std::vector<Entry>& entries = m_entries[outs.amount];
+    for (const OutEntry& out : outs.outs) {
+      bool duplicate = std::any_of(entries.begin(), entries.end(), [&out](const Entry& e) {
+        return e.out.global_amount_index == out.global_amount_index;
+      });
+      if (!duplicate) {
+        entries.push_back(Entry{_height, out});
+      }
+    }
+  }
+}
+
+void DecoyCache::expire(uint32_t _height) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    std::vector<Entry>& entries = it->second;
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [this, _height](const Entry& e) {
+      return e.height > _height || _height - e.height > m_maxAge;
+    }), entries.end());
+
+    if (entries.empty()) {
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void DecoyCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_watchedAmounts.clear();
+}
+
+void DecoyCache::watch(const std::vector<uint64_t>& _amounts) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_watchedAmounts.insert(_amounts.begin(), _amounts.end());
+}
+
+std::vector<uint64_t> DecoyCache::amountsToRefill() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<uint64_t> amounts;
+  for (uint64_t amount : m_watchedAmounts) {
+    auto it = m_entries.find(amount);
+    if (it == m_entries.end() || it->second.size() < m_targetSize / 2) {
+      amounts.push_back(amount);
+    }
+  }
+
+  return amounts;
+}
+
+size_t DecoyCache::targetSize() const {
+  return m_targetSize;
+}
+
+uint64_t DecoyCache::hits() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_hits;
+}
+
+uint64_t DecoyCache::misses() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_misses;
+}
+
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "Rpc/CoreRpcServerCommandsDefinitions.h"
+
+namespace WalletGui {
+
+// Random outputs (mixins) fetched from the node ahead of time, keyed by amount.
+// Every entry is handed out once and is dropped when it gets too old.
+class DecoyCache {
+public:
+  typedef CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount OutsForAmount;
+  typedef CryptoNote::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry OutEntry;
+
+  DecoyCache(uint32_t _maxAge, size_t _targetSize);
+
+  // Takes _count entries for every requested amount, either all or nothing
+  bool take(const std::vector<uint64_t>& _amounts, uint16_t _count, std::vector<OutsForAmount>& _result);
+  void put(uint32_t _height, const std::vector<OutsForAmount>& _outs);
+  void expire(uint32_t _height);
+  void clear();
+
+  // Amounts seen in requests or announced by the wallet are kept filled
+  void watch(const std::vector<uint64_t>& _amounts);
+  std::vector<uint64_t> amountsToRefill() const;
+  size_t targetSize() const;
+
+  uint64_t hits() const;
+  uint64_t misses() const;
+
+private:
+  struct Entry {
+    uint32_t height;
+    OutEntry out;
+  };
+
+  mutable std::mutex m_mutex;
+  std::map<uint64_t, std::vector<Entry>> m_entries;
+  std::set<uint64_t> m_watchedAmounts;
+  const uint32_t m_maxAge;
+  const size_t m_targetSize;
+  uint64_t m_hits;
+  uint64_t m_misses;
+};
+
+}
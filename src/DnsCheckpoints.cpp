@@ -0,0 +1,140 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QDnsLookup>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include "DnsCheckpoints.h"
+#include "LoggerAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const char DNS_CHECKPOINTS_HOST[] = "checkpoints.karbo.org";
+
+bool parseCheckpoint(const QString& _record, uint32_t& _height, std::string& _hash) {
+  const int separator = _record.indexOf(':');
+  if (separator <= 0) {
+    return false;
+  }
+
+  bool ok;
+  _height = _record.left(separator).trimmed().toUInt(&ok);
+  const QString hash = _record.mid(separator + 1).trimmed().left(64);
+  if (!ok || hash.size() != 64 || QByteArray::fromHex(hash.toLatin1()).size() != 32) {
+    return false;
+  }
+
+  _hash = hash.toLower().toStdString();
+  return true;
+}
+
+}
+
+DnsCheckpoints::DnsCheckpoints(const QString& _cacheFileName, QObject* _parent) : QObject(_parent),
+  m_cacheFileName(_cacheFileName), m_lookup(nullptr) {
+  m_timeoutTimer.setSingleShot(true);
+  connect(&m_timeoutTimer, &QTimer::timeout, this, &DnsCheckpoints::lookupTimedOut);
+}
+
+DnsCheckpoints::~DnsCheckpoints() {
+}
+
+void DnsCheckpoints::start(int _timeout) {
+  if (m_lookup != nullptr) {
+    return;
+  }
+
+  m_lookup = new QDnsLookup(QDnsLookup::TXT, DNS_CHECKPOINTS_HOST, this);
+  connect(m_lookup, &QDnsLookup::finished, this, &DnsCheckpoints::lookupFinished);
+  m_timeoutTimer.start(_timeout);
+  m_lookup->lookup();
+}
+
+const CheckpointMap& DnsCheckpoints::checkpoints() const {
+  return m_checkpoints;
+}
+
+CheckpointMap DnsCheckpoints::loadCache(const QString& _fileName) {
+  CheckpointMap result;
+  QFile file(_fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return result;
+  }
+
+  QTextStream stream(&file);
+  while (!stream.atEnd()) {
+    uint32_t height;
+    std::string hash;
+    if (parseCheckpoint(stream.readLine(), height, hash)) {
+      result[height] = hash;
+    }
+  }
+
+  return result;
+}
+
+void DnsCheckpoints::lookupFinished() {
+  m_timeoutTimer.stop();
+  m_lookup->deleteLater();
+  if (m_lookup->error() != QDnsLookup::NoError) {
+    LoggerAdapter::instance().log("Failed to load DNS checkpoints: " + m_lookup->errorString().toStdString());
+    m_lookup = nullptr;
+    return;
+  }
+
+  m_checkpoints.clear();
+  for (const QDnsTextRecord& record : m_lookup->textRecords()) {
+    for (const QByteArray& value : record.values()) {
+      uint32_t height;
+      std::string hash;
+      if (parseCheckpoint(QString::fromLatin1(value), height, hash)) {
+        m_checkpoints[height] = hash;
+      }
+    }
+  }
+
+  m_lookup = nullptr;
+  if (m_checkpoints.empty()) {
+    return;
+  }
+
+  LoggerAdapter::instance().log(QString("Loaded %1 DNS checkpoints").arg(m_checkpoints.size()).toStdString());
+  saveCache();
+  Q_EMIT checkpointsLoadedSignal();
+}
+
+void DnsCheckpoints::lookupTimedOut() {
+  if (m_lookup == nullptr) {
+    return;
+  }
+
+  LoggerAdapter::instance().log("DNS checkpoints lookup timed out");
+  m_lookup->disconnect(this);
+  m_lookup->abort();
+  m_lookup->deleteLater();
+  m_lookup = nullptr;
+}
+
+void DnsCheckpoints::saveCache() const {
+  // The latest answer replaces the file, points DNS no longer publishes
+  // (withdrawn or wrong ones) must not outlive it
+  QSaveFile file(m_cacheFileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return;
+  }
+
+  QTextStream stream(&file);
+  for (const auto& checkpoint : m_checkpoints) {
+    stream << checkpoint.first << ':' << QString::fromStdString(checkpoint.second) << '\n';
+  }
+
+  stream.flush();
+  file.commit();
+}
+
+}
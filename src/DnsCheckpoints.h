@@ -0,0 +1,52 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+class QDnsLookup;
+
+namespace WalletGui {
+
+typedef std::map<uint32_t, std::string> CheckpointMap;
+
+const char CHECKPOINTS_CACHE_FILE[] = "checkpoints.cache";
+
+// Checkpoints published in DNS TXT records as "height:hash". Lookups are
+// asynchronous with a hard timeout; the last good set is kept in a file so
+// the node can start with it right away.
+class DnsCheckpoints : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(DnsCheckpoints)
+
+public:
+  DnsCheckpoints(const QString& _cacheFileName, QObject* _parent = nullptr);
+  ~DnsCheckpoints();
+
+  void start(int _timeout);
+  const CheckpointMap& checkpoints() const;
+
+  static CheckpointMap loadCache(const QString& _fileName);
+
+private:
+  QString m_cacheFileName;
+  QDnsLookup* m_lookup;
+  QTimer m_timeoutTimer;
+  CheckpointMap m_checkpoints;
+
+  void lookupFinished();
+  void lookupTimedOut();
+  void saveCache() const;
+
+Q_SIGNALS:
+  void checkpointsLoadedSignal();
+};
+
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTextStream>
+#include <QTimer>
+#include <QUrl>
+
+#include <memory>
+
+#include "FailoverCheck.h"
+#include "LoggerAdapter.h"
+#include "RemoteNodePool.h"
+#include "ReplayNode.h"
+
+namespace WalletGui {
+
+namespace {
+
+const char LOCAL_NODE_HOST[] = "127.0.0.1";
+// Longer than the pool's own forward timeout, a failover gets the time it needs
+const int REQUEST_TIMEOUT = 30000;
+
+void report(const QString& _text) {
+  LoggerAdapter::instance().log(_text.toStdString());
+  QTextStream(stdout) << _text << endl;
+}
+
+// Sends a recorded request through the pool, true if it was answered with the recorded status
+bool replay(QNetworkAccessManager& _network, quint16 _port, const RecordedExchange& _exchange, QString& _errorText) {
+  QNetworkRequest request(QUrl(QString("http://%1:%2%3").arg(LOCAL_NODE_HOST).arg(_port).arg(QString::fromUtf8(_exchange.path))));
+  request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+  QNetworkReply* reply = _exchange.request.isEmpty() ? _network.get(request) : _network.post(request, _exchange.request);
+
+  QTimer timeoutTimer;
+  timeoutTimer.setSingleShot(true);
+  QEventLoop waitLoop;
+  QObject::connect(reply, &QNetworkReply::finished, &waitLoop, &QEventLoop::quit);
+  QObject::connect(&timeoutTimer, &QTimer::timeout, &waitLoop, &QEventLoop::quit);
+  timeoutTimer.start(REQUEST_TIMEOUT);
+  waitLoop.exec();
+
+  const bool finished = reply->isFinished();
+  if (!finished) {
+    reply->abort();
+  }
+
+  const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  reply->deleteLater();
+  if (!finished) {
+    _errorText = "no answer";
+    return false;
+  }
+
+  if (status != _exchange.status) {
+    _errorText = QString("status %1, recorded %2").arg(status).arg(_exchange.status);
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+bool FailoverCheck::run(const QString& _recordingFile) {
+  QVector<RecordedExchange> exchanges;
+  if (!NodeRecorder::load(_recordingFile, exchanges) || exchanges.size() < 2) {
+    report(QString("Failover check: cannot load a node session with at least two requests from %1").arg(_recordingFile));
+    return false;
+  }
+
+  // The pool and the stand-in nodes run on their own threads, this one only sends requests
+  std::unique_ptr<ReplayNodeServer> first(new ReplayNodeServer(0, 0));
+  std::unique_ptr<ReplayNodeServer> second(new ReplayNodeServer(0, 0));
+  if (!first->load(_recordingFile) || !second->load(_recordingFile) || !first->start() || !second->start()) {
+    report("Failover check: cannot start the stand-in nodes");
+    return false;
+  }
+
+  const NodeSetting firstNode = {LOCAL_NODE_HOST, first->port(), "/", false};
+  const NodeSetting secondNode = {LOCAL_NODE_HOST, second->port(), "/", false};
+  std::unique_ptr<RemoteNodePool> pool(new RemoteNodePool(QVector<NodeSetting>() << firstNode << secondNode, 0));
+  if (!pool->start()) {
+    report("Failover check: cannot start the node pool");
+    return false;
+  }
+
+  QNetworkAccessManager network;
+  const int stopAt = exchanges.size() / 2;
+  int failed = 0;
+  for (int i = 0; i < exchanges.size(); ++i) {
+    if (i == stopAt) {
+      first->stop();
+    }
+
+    QString errorText;
+    if (!replay(network, pool->port(), exchanges[i], errorText)) {
+      ++failed;
+      report(QString("Failover check: request %1 to %2 %3 the first node stopped: %4").arg(i + 1).arg(QString::fromUtf8(exchanges[i].path)).
+        arg(i < stopAt ? "before" : "after").arg(errorText));
+    }
+  }
+
+  bool movedOn = false;
+  for (const RemoteNodeScore& score : pool->scores()) {
+    if (score.active && score.node.port == secondNode.port) {
+      movedOn = true;
+    }
+  }
+
+  pool->stop();
+  second->stop();
+
+  const bool ok = failed == 0 && movedOn;
+  report(QString("Failover check: %1, %2 of %3 requests answered, %4").arg(ok ? "passed" : "FAILED").arg(exchanges.size() - failed).
+    arg(exchanges.size()).arg(movedOn ? "moved on to the remaining node" : "still using the stopped node"));
+  return ok;
+}
+
+}
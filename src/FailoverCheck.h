@@ -0,0 +1,21 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QString>
+
+namespace WalletGui {
+
+// Self-check of the remote node pool. Two local stand-in nodes replay the same
+// recorded node session, the recorded requests are sent through a pool of both
+// and the node in use is stopped halfway. Every request has to be answered as
+// recorded and the pool has to move on to the remaining node. The report goes
+// to the log and stdout.
+class FailoverCheck {
+public:
+  static bool run(const QString& _recordingFile);
+};
+
+}
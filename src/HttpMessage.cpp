@@ -0,0 +1,71 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QList>
+
+#include "HttpMessage.h"
+
+namespace WalletGui {
+
+namespace {
+
+QByteArray statusText(int _status) {
+  switch (_status) {
+  case 200: return "OK";
+  case 400: return "Bad Request";
+  case 401: return "Unauthorized";
+  case 404: return "Not Found";
+  case 413: return "Payload Too Large";
+  case 502: return "Bad Gateway";
+  case 503: return "Service Unavailable";
+  default: return "Error";
+  }
+}
+
+}
+
+bool parseHttpRequest(QByteArray& _buffer, HttpRequest& _request) {
+  int headerEnd = _buffer.indexOf("\r\n\r\n");
+  if (headerEnd < 0) {
+    return false;
+  }
+
+  QList<QByteArray> lines = _buffer.left(headerEnd).split('\n');
+  QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+  if (requestLine.size() < 2) {
+    _buffer.clear();
+    return false;
+  }
+
+  _request.method = requestLine[0];
+  _request.path = requestLine[1];
+  _request.headers.clear();
+  for (const QByteArray& line : lines) {
+    int colon = line.indexOf(':');
+    if (colon > 0) {
+      _request.headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+    }
+  }
+
+  const int contentLength = _request.headers.value("content-length", "0").toInt();
+  if (_buffer.size() < headerEnd + 4 + contentLength) {
+    return false;
+  }
+
+  _request.body = _buffer.mid(headerEnd + 4, contentLength);
+  _buffer.remove(0, headerEnd + 4 + contentLength);
+  return true;
+}
+
+QByteArray makeHttpResponse(int _status, const QByteArray& _body, const QByteArray& _contentType, const QByteArray& _extraHeaders) {
+  QByteArray response = "HTTP/1.1 " + QByteArray::number(_status) + " " + statusText(_status) + "\r\n";
+  response += "Content-Type: " + _contentType + "\r\n";
+  response += "Content-Length: " + QByteArray::number(_body.size()) + "\r\n";
+  response += _extraHeaders;
+  response += "\r\n";
+  response += _body;
+  return response;
+}
+
+}
@@ -0,0 +1,25 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+
+namespace WalletGui {
+
+// Minimal HTTP/1.1 support for the loopback servers of the wallet
+struct HttpRequest {
+  QByteArray method;
+  QByteArray path;
+  QHash<QByteArray, QByteArray> headers; // names in lower case
+  QByteArray body;
+};
+
+// Takes the first complete request off _buffer, false if more data is needed.
+// Unparseable data is dropped.
+bool parseHttpRequest(QByteArray& _buffer, HttpRequest& _request);
+QByteArray makeHttpResponse(int _status, const QByteArray& _body, const QByteArray& _contentType, const QByteArray& _extraHeaders = QByteArray());
+
+}
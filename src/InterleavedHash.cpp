@@ -0,0 +1,293 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QtGlobal>
+
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if (defined(__x86_64__) && defined(__AES__)) || defined(_M_X64)
+#define INTERLEAVED_HASH_AESNI
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+extern "C"
+{
+#include "crypto/keccak.h"
+}
+
+#include "InterleavedHash.h"
+#include "CpuTopology.h"
+
+namespace WalletGui {
+
+namespace {
+
+const size_t MEMORY = 1 << 21;
+const size_t ITERATIONS = 1 << 20;
+const uint64_t ADDRESS_MASK = 0x1FFFF0;
+const size_t STATE_SIZE = 200;
+// the part of the Keccak state that seeds and collects the scratchpad
+const size_t TEXT_OFFSET = 64;
+const size_t TEXT_BLOCKS = 8;
+
+#if defined(INTERLEAVED_HASH_AESNI)
+
+void (*const EXTRA_HASHES[4])(const void*, size_t, char*) = {
+  Crypto::hash_extra_blake, Crypto::hash_extra_groestl, Crypto::hash_extra_jh, Crypto::hash_extra_skein
+};
+
+inline uint64_t mul128(uint64_t _a, uint64_t _b, uint64_t* _high) {
+#if defined(_MSC_VER)
+  return _umul128(_a, _b, _high);
+#else
+  unsigned __int128 r = static_cast<unsigned __int128>(_a) * _b;
+  *_high = static_cast<uint64_t>(r >> 64);
+  return static_cast<uint64_t>(r);
+#endif
+}
+
+inline __m128i shiftXor(__m128i _value) {
+  __m128i shifted = _mm_slli_si128(_value, 4);
+  _value = _mm_xor_si128(_value, shifted);
+  shifted = _mm_slli_si128(shifted, 4);
+  _value = _mm_xor_si128(_value, shifted);
+  shifted = _mm_slli_si128(shifted, 4);
+  return _mm_xor_si128(_value, shifted);
+}
+
+template<int RCON>
+inline void expandKeyStep(__m128i& _low, __m128i& _high) {
+  _low = _mm_xor_si128(shiftXor(_low), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(_high, RCON), 0xFF));
+  _high = _mm_xor_si128(shiftXor(_high), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(_low, 0x00), 0xAA));
+}
+
+// The first ten round keys of the AES-256 schedule of a 32 byte key
+void expandKey(const uint8_t* _key, __m128i* _roundKeys) {
+  __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_key));
+  __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_key + 16));
+  _roundKeys[0] = low;
+  _roundKeys[1] = high;
+  expandKeyStep<0x01>(low, high);
+  _roundKeys[2] = low;
+  _roundKeys[3] = high;
+  expandKeyStep<0x02>(low, high);
+  _roundKeys[4] = low;
+  _roundKeys[5] = high;
+  expandKeyStep<0x04>(low, high);
+  _roundKeys[6] = low;
+  _roundKeys[7] = high;
+  expandKeyStep<0x08>(low, high);
+  _roundKeys[8] = low;
+  _roundKeys[9] = high;
+}
+
+inline void aesRounds(__m128i* _blocks, const __m128i* _roundKeys) {
+  for (size_t i = 0; i < TEXT_BLOCKS; ++i) {
+    for (size_t r = 0; r < 10; ++r) {
+      _blocks[i] = _mm_aesenc_si128(_blocks[i], _roundKeys[r]);
+    }
+  }
+}
+
+// Fills the scratchpad from the Keccak state
+void explode(const uint64_t* _state, uint8_t* _scratchpad) {
+  __m128i roundKeys[10];
+  expandKey(reinterpret_cast<const uint8_t*>(_state), roundKeys);
+  __m128i text[TEXT_BLOCKS];
+  for (size_t i = 0; i < TEXT_BLOCKS; ++i) {
+    text[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(reinterpret_cast<const uint8_t*>(_state) + TEXT_OFFSET) + i);
+  }
+
+  for (size_t offset = 0; offset < MEMORY; offset += sizeof(text)) {
+    aesRounds(text, roundKeys);
+    for (size_t i = 0; i < TEXT_BLOCKS; ++i) {
+      _mm_store_si128(reinterpret_cast<__m128i*>(_scratchpad + offset) + i, text[i]);
+    }
+  }
+}
+
+// Folds the scratchpad back into the Keccak state and hashes it
+void implode(uint64_t* _state, const uint8_t* _scratchpad, Crypto::Hash& _hash) {
+  __m128i roundKeys[10];
+  expandKey(reinterpret_cast<const uint8_t*>(_state) + 32, roundKeys);
+  __m128i* stateText = reinterpret_cast<__m128i*>(reinterpret_cast<uint8_t*>(_state) + TEXT_OFFSET);
+  __m128i text[TEXT_BLOCKS];
+  for (size_t i = 0; i < TEXT_BLOCKS; ++i) {
+    text[i] = _mm_loadu_si128(stateText + i);
+  }
+
+  for (size_t offset = 0; offset < MEMORY; offset += sizeof(text)) {
+    for (size_t i = 0; i < TEXT_BLOCKS; ++i) {
+      text[i] = _mm_xor_si128(text[i], _mm_load_si128(reinterpret_cast<const __m128i*>(_scratchpad + offset) + i));
+    }
+
+    aesRounds(text, roundKeys);
+  }
+
+  for (size_t i = 0; i < TEXT_BLOCKS; ++i) {
+    _mm_storeu_si128(stateText + i, text[i]);
+  }
+
+  keccakf(_state, 24);
+  EXTRA_HASHES[_state[0] & 3](_state, STATE_SIZE, reinterpret_cast<char*>(&_hash));
+}
+
+// WAYS is a constant so the compiler keeps the per-way state in registers and
+// unrolls the inner loops; each pass issues the loads of every way before any
+// of them is needed.
+template<size_t WAYS>
+void hashWays(const uint8_t* _blobs, size_t _size, uint8_t* _scratchpads, Crypto::Hash* _hashes) {
+  uint64_t state[WAYS][STATE_SIZE / sizeof(uint64_t)];
+  uint8_t* scratchpad[WAYS];
+  uint64_t al[WAYS];
+  uint64_t ah[WAYS];
+  uint64_t address[WAYS];
+  __m128i b[WAYS];
+  for (size_t w = 0; w < WAYS; ++w) {
+    keccak1600(_blobs + w * _size, static_cast<int>(_size), reinterpret_cast<uint8_t*>(state[w]));
+    scratchpad[w] = _scratchpads + w * MEMORY;
+    explode(state[w], scratchpad[w]);
+    al[w] = state[w][0] ^ state[w][4];
+    ah[w] = state[w][1] ^ state[w][5];
+    b[w] = _mm_set_epi64x(state[w][3] ^ state[w][7], state[w][2] ^ state[w][6]);
+    address[w] = al[w];
+  }
+
+  for (size_t i = 0; i < ITERATIONS / 2; ++i) {
+    for (size_t w = 0; w < WAYS; ++w) {
+      __m128i* slot = reinterpret_cast<__m128i*>(scratchpad[w] + (address[w] & ADDRESS_MASK));
+      __m128i c = _mm_aesenc_si128(_mm_load_si128(slot), _mm_set_epi64x(ah[w], al[w]));
+      _mm_store_si128(slot, _mm_xor_si128(b[w], c));
+      b[w] = c;
+      address[w] = static_cast<uint64_t>(_mm_cvtsi128_si64(c));
+    }
+
+    for (size_t w = 0; w < WAYS; ++w) {
+      uint64_t* slot = reinterpret_cast<uint64_t*>(scratchpad[w] + (address[w] & ADDRESS_MASK));
+      const uint64_t cl = slot[0];
+      const uint64_t ch = slot[1];
+      uint64_t high;
+      const uint64_t low = mul128(address[w], cl, &high);
+      al[w] += high;
+      ah[w] += low;
+      slot[0] = al[w];
+      slot[1] = ah[w];
+      al[w] ^= cl;
+      ah[w] ^= ch;
+      address[w] = al[w];
+    }
+  }
+
+  for (size_t w = 0; w < WAYS; ++w) {
+    implode(state[w], scratchpad[w], _hashes[w]);
+  }
+}
+
+#endif
+
+}
+
+InterleavedHash::InterleavedHash(size_t _ways) : m_ways(_ways), m_scratchpads(nullptr), m_largePages(false) {
+  // Every random access of the loop hits another 2 MiB scratchpad page with
+  // regular pages, large pages take the TLB misses out of it
+  m_scratchpads = static_cast<uint8_t*>(CpuTopology::allocateLocalMemory(_ways * MEMORY, m_largePages));
+  if (m_scratchpads == nullptr) {
+    throw std::bad_alloc();
+  }
+}
+
+InterleavedHash::~InterleavedHash() {
+  CpuTopology::freeLocalMemory(m_scratchpads, m_ways * MEMORY);
+}
+
+size_t InterleavedHash::ways() const {
+  return m_ways;
+}
+
+bool InterleavedHash::largePages() const {
+  return m_largePages;
+}
+
+void InterleavedHash::hash(const uint8_t* _blobs, size_t _size, Crypto::Hash* _hashes) {
+#if defined(INTERLEAVED_HASH_AESNI)
+  switch (m_ways) {
+  case 1:
+    hashWays<1>(_blobs, _size, m_scratchpads, _hashes);
+    break;
+  case 2:
+    hashWays<2>(_blobs, _size, m_scratchpads, _hashes);
+    break;
+  case 3:
+    hashWays<3>(_blobs, _size, m_scratchpads, _hashes);
+    break;
+  case 4:
+    hashWays<4>(_blobs, _size, m_scratchpads, _hashes);
+    break;
+  }
+#else
+  Q_UNUSED(_blobs);
+  Q_UNUSED(_size);
+  Q_UNUSED(_hashes);
+#endif
+}
+
+bool InterleavedHash::isAvailable() {
+#if defined(INTERLEAVED_HASH_AESNI)
+  return CpuTopology::features().aes;
+#else
+  return false;
+#endif
+}
+
+bool InterleavedHash::testWays(size_t _ways) {
+  if (!isAvailable() || _ways < 1 || _ways > MAX_WAYS) {
+    return false;
+  }
+
+  // from a block header up to blobs longer than one Keccak block
+  const size_t size = 76 + (_ways - 1) * 62;
+  std::vector<uint8_t> blobs(_ways * size);
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    blobs[i] = static_cast<uint8_t>(i * 131 + _ways);
+  }
+
+  std::vector<Crypto::Hash> hashes(_ways);
+  InterleavedHash(_ways).hash(blobs.data(), size, hashes.data());
+  Crypto::cn_context context;
+  for (size_t w = 0; w < _ways; ++w) {
+    Crypto::Hash expected;
+    Crypto::cn_slow_hash(context, blobs.data() + w * size, size, expected);
+    if (std::memcmp(&expected, &hashes[w], sizeof(expected)) != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool InterleavedHash::selfTest() {
+  static const bool passed = []() -> bool {
+    for (size_t ways = 1; ways <= MAX_WAYS; ++ways) {
+      if (!testWays(ways)) {
+        return false;
+      }
+    }
+
+    return true;
+  }();
+
+  return passed;
+}
+
+size_t InterleavedHash::maxWays() {
+  return selfTest() ? MAX_WAYS : 1;
+}
+
+}
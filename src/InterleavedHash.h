@@ -0,0 +1,50 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "crypto/hash.h"
+
+namespace WalletGui {
+
+// CryptoNight as hashed for blocks before version 5, for up to MAX_WAYS blobs
+// at once. Every way has its own scratchpad; the memory hard loops of the ways
+// run interleaved, so the random reads of one way overlap with the AES and
+// multiply work of the others. Needs AES-NI on x86-64, where it is missing or
+// the self test against Crypto::cn_slow_hash fails only one way is offered and
+// callers keep the library hash. The scratchpads come from
+// CpuTopology::allocateLocalMemory, construct it on the thread that hashes.
+class InterleavedHash {
+public:
+  static const size_t MAX_WAYS = 4;
+
+  explicit InterleavedHash(size_t _ways);
+  ~InterleavedHash();
+
+  size_t ways() const;
+  // Whether the scratchpads are on large pages
+  bool largePages() const;
+  // _blobs holds ways() blobs of _size bytes back to back, one hash for each
+  void hash(const uint8_t* _blobs, size_t _size, Crypto::Hash* _hashes);
+
+  // Compiled in and the processor has AES-NI
+  static bool isAvailable();
+  // Hashes _ways distinct blobs at once and compares each hash with the
+  // library's scalar hash
+  static bool testWays(size_t _ways);
+  // testWays with every way count; runs once, the result is kept
+  static bool selfTest();
+  // Largest way count the machine passed the self test with, 1 otherwise
+  static size_t maxWays();
+
+private:
+  size_t m_ways;
+  uint8_t* m_scratchpads;
+  bool m_largePages;
+};
+
+}
@@ -0,0 +1,277 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <cstring>
+
+#include "MessageSigner.h"
+#include "CurrencyAdapter.h"
+#include "ParallelFor.h"
+
+#include "Common/Base58.h"
+#include "crypto/crypto.h"
+
+namespace WalletGui {
+
+namespace {
+
+const char SIGNATURE_HEADER[] = "SigV1";
+const size_t SIGNATURE_HEADER_SIZE = sizeof(SIGNATURE_HEADER) - 1;
+const int PROGRESS_UPDATE_INTERVAL = 100;
+
+bool decodeSignature(const std::string& _signature, Crypto::Signature& _decoded) {
+  if (_signature.size() < SIGNATURE_HEADER_SIZE || _signature.compare(0, SIGNATURE_HEADER_SIZE, SIGNATURE_HEADER) != 0) {
+    return false;
+  }
+
+  std::string decoded;
+  if (!Tools::Base58::decode(_signature.substr(SIGNATURE_HEADER_SIZE), decoded) || decoded.size() != sizeof(Crypto::Signature)) {
+    return false;
+  }
+
+  std::memcpy(&_decoded, decoded.data(), sizeof(Crypto::Signature));
+  return true;
+}
+
+Crypto::Hash messageHash(const QString& _message) {
+  const std::string message = _message.toStdString();
+  Crypto::Hash hash;
+  Crypto::cn_fast_hash(message.data(), message.size(), hash);
+  return hash;
+}
+
+}
+
+QString MessageSigner::sign(const CryptoNote::AccountKeys& _keys, const QString& _message) {
+  Crypto::Signature signature;
+  Crypto::generate_signature(messageHash(_message), _keys.address.spendPublicKey, _keys.spendSecretKey, signature);
+  return QString::fromStdString(SIGNATURE_HEADER + Tools::Base58::encode(std::string(reinterpret_cast<const char*>(&signature), sizeof(signature))));
+}
+
+bool MessageSigner::verify(const QString& _message, const CryptoNote::AccountPublicAddress& _address, const QString& _signature) {
+  Crypto::Signature signature;
+  if (!decodeSignature(_signature.trimmed().toStdString(), signature)) {
+    return false;
+  }
+
+  return Crypto::check_signature(messageHash(_message), _address.spendPublicKey, signature);
+}
+
+QStringList MessageSigner::signBatch(const CryptoNote::AccountKeys& _keys, const QStringList& _messages) {
+  std::vector<QString> signatures(_messages.size());
+  parallelFor(_messages.size(), [&](size_t i) {
+    signatures[i] = sign(_keys, _messages[static_cast<int>(i)]);
+    return true;
+  });
+
+  QStringList result;
+  result.reserve(_messages.size());
+  for (const QString& signature : signatures) {
+    result.append(signature);
+  }
+
+  return result;
+}
+
+QVector<MessageCheckResult> MessageSigner::verifyBatch(const QVector<SignedMessage>& _messages, size_t _threadCount,
+  Progress* _progress) {
+  QVector<MessageCheckResult> results(_messages.size(), MessageCheckResult::INVALID_SIGNATURE);
+  if (_progress != nullptr) {
+    _progress->total = _messages.size();
+  }
+
+  MessageCheckResult* data = results.data();
+  parallelFor(_messages.size(), [&](size_t i) {
+    const SignedMessage& item = _messages[static_cast<int>(i)];
+    CryptoNote::AccountPublicAddress address;
+    if (!CurrencyAdapter::instance().getCurrency().parseAccountAddressString(item.address.trimmed().toStdString(), address)) {
+      data[i] = MessageCheckResult::INVALID_ADDRESS;
+      return true;
+    }
+
+    Crypto::Signature signature;
+    if (!decodeSignature(item.signature.trimmed().toStdString(), signature)) {
+      data[i] = MessageCheckResult::INVALID_FORMAT;
+      return true;
+    }
+
+    data[i] = Crypto::check_signature(messageHash(item.message), address.spendPublicKey, signature) ?
+      MessageCheckResult::VALID : MessageCheckResult::INVALID_SIGNATURE;
+    return true;
+  }, _progress != nullptr ? &_progress->cancelled : nullptr, _progress != nullptr ? &_progress->done : nullptr, _threadCount);
+
+  return results;
+}
+
+bool MessageSigner::loadBatch(const QString& _fileName, QVector<SignedMessage>& _messages, QString& _errorText) {
+  QFile file(_fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    _errorText = tr("Cannot open file %1").arg(_fileName);
+    return false;
+  }
+
+  _messages.clear();
+  QTextStream stream(&file);
+  stream.setCodec("UTF-8");
+  int lineNumber = 0;
+  while (!stream.atEnd()) {
+    QString line = stream.readLine();
+    ++lineNumber;
+    if (line.trimmed().isEmpty()) {
+      continue;
+    }
+
+    // Address and signature never contain the separator, the message may
+    const QChar separator = line.contains('\t') ? QChar('\t') : QChar(',');
+    int signatureStart = line.lastIndexOf(separator);
+    int addressStart = signatureStart > 0 ? line.lastIndexOf(separator, signatureStart - 1) : -1;
+    if (addressStart < 0) {
+      _errorText = tr("Line %1: expected message, address and signature").arg(lineNumber);
+      return false;
+    }
+
+    SignedMessage item;
+    item.message = line.left(addressStart);
+    item.address = line.mid(addressStart + 1, signatureStart - addressStart - 1).trimmed();
+    item.signature = line.mid(signatureStart + 1).trimmed();
+    _messages.append(item);
+  }
+
+  if (_messages.isEmpty()) {
+    _errorText = tr("No signed messages found");
+    return false;
+  }
+
+  return true;
+}
+
+QString MessageSigner::resultText(MessageCheckResult _result) {
+  switch (_result) {
+  case MessageCheckResult::VALID:
+    return tr("Signature is valid");
+  case MessageCheckResult::INVALID_SIGNATURE:
+    return tr("Signature is invalid");
+  case MessageCheckResult::INVALID_ADDRESS:
+    return tr("Address is invalid");
+  case MessageCheckResult::INVALID_FORMAT:
+    return tr("Signature has invalid format");
+  }
+
+  return QString();
+}
+
+SignatureBenchmark MessageSigner::benchmark(size_t _signatureCount, Progress* _progress) {
+  const std::atomic<bool>* cancelled = _progress != nullptr ? &_progress->cancelled : nullptr;
+  std::atomic<size_t>* done = _progress != nullptr ? &_progress->done : nullptr;
+  SignatureBenchmark result;
+  result.threadCount = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+  result.singleThreadRate = 0;
+  result.allThreadsRate = 0;
+  if (_progress != nullptr) {
+    // signing, then verifying on one thread and on all of them
+    _progress->total = 3 * _signatureCount;
+  }
+
+  CryptoNote::AccountKeys keys;
+  Crypto::generate_keys(keys.address.spendPublicKey, keys.spendSecretKey);
+  Crypto::generate_keys(keys.address.viewPublicKey, keys.viewSecretKey);
+
+  std::vector<Crypto::Hash> hashes(_signatureCount);
+  std::vector<Crypto::Signature> signatures(_signatureCount);
+  if (!parallelFor(_signatureCount, [&](size_t i) {
+    hashes[i] = messageHash(QString("benchmark message %1").arg(i));
+    Crypto::generate_signature(hashes[i], keys.address.spendPublicKey, keys.spendSecretKey, signatures[i]);
+    return true;
+  }, cancelled, done)) {
+    return result;
+  }
+
+  auto measure = [&](size_t _threadCount) {
+    QElapsedTimer timer;
+    timer.start();
+    if (!parallelFor(_signatureCount, [&](size_t i) {
+      return Crypto::check_signature(hashes[i], keys.address.spendPublicKey, signatures[i]);
+    }, cancelled, done, _threadCount)) {
+      return 0.0;
+    }
+
+    return _signatureCount * 1e9 / std::max<qint64>(timer.nsecsElapsed(), 1);
+  };
+
+  result.singleThreadRate = measure(1);
+  result.allThreadsRate = measure(result.threadCount);
+  return result;
+}
+
+MessageSignerJob::MessageSignerJob(QObject* _parent) : QObject(_parent), m_running(false), m_jobId(0) {
+  m_progress.done = 0;
+  m_progress.total = 0;
+  m_progress.cancelled = false;
+  m_progressTimer.setInterval(PROGRESS_UPDATE_INTERVAL);
+  connect(&m_progressTimer, &QTimer::timeout, this, &MessageSignerJob::updateProgress);
+}
+
+MessageSignerJob::~MessageSignerJob() {
+  cancel();
+}
+
+quint64 MessageSignerJob::verify(const QVector<SignedMessage>& _messages) {
+  startJob([this, _messages](quint64 _jobId) {
+    QElapsedTimer timer;
+    timer.start();
+    QVector<MessageCheckResult> results = MessageSigner::verifyBatch(_messages, 0, &m_progress);
+    Q_EMIT batchVerifiedSignal(_jobId, results, std::max<qint64>(timer.elapsed(), 1), m_progress.cancelled);
+  });
+
+  return m_jobId;
+}
+
+quint64 MessageSignerJob::benchmark(size_t _signatureCount) {
+  startJob([this, _signatureCount](quint64 _jobId) {
+    SignatureBenchmark result = MessageSigner::benchmark(_signatureCount, &m_progress);
+    Q_EMIT benchmarkFinishedSignal(_jobId, result, m_progress.cancelled);
+  });
+
+  return m_jobId;
+}
+
+void MessageSignerJob::cancel() {
+  m_progress.cancelled = true;
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+
+  m_progressTimer.stop();
+}
+
+bool MessageSignerJob::isRunning() const {
+  return m_running;
+}
+
+void MessageSignerJob::startJob(std::function<void(quint64)>&& _job) {
+  cancel();
+  m_progress.done = 0;
+  m_progress.total = 0;
+  m_progress.cancelled = false;
+  m_running = true;
+  const quint64 jobId = ++m_jobId;
+  m_thread = std::thread([this, jobId](std::function<void(quint64)> _job) {
+    _job(jobId);
+    m_running = false;
+  }, std::move(_job));
+
+  m_progressTimer.start();
+}
+
+void MessageSignerJob::updateProgress() {
+  Q_EMIT progressSignal(m_jobId, static_cast<int>(m_progress.done), static_cast<int>(m_progress.total));
+  if (!m_running) {
+    m_progressTimer.stop();
+  }
+}
+
+}
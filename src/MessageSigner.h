@@ -0,0 +1,97 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QCoreApplication>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+
+namespace WalletGui {
+
+struct SignedMessage {
+  QString message;
+  QString address;
+  QString signature;
+};
+
+enum class MessageCheckResult {
+  VALID, INVALID_SIGNATURE, INVALID_ADDRESS, INVALID_FORMAT
+};
+
+struct SignatureBenchmark {
+  size_t threadCount;
+  double singleThreadRate;
+  double allThreadsRate;
+};
+
+// "SigV1" message signatures as produced by WalletLegacy::sign_message.
+// Batches are signed and verified on all cores.
+class MessageSigner {
+  Q_DECLARE_TR_FUNCTIONS(MessageSigner)
+
+public:
+  struct Progress {
+    std::atomic<size_t> done;
+    std::atomic<size_t> total;
+    std::atomic<bool> cancelled;
+  };
+
+  static QString sign(const CryptoNote::AccountKeys& _keys, const QString& _message);
+  static bool verify(const QString& _message, const CryptoNote::AccountPublicAddress& _address, const QString& _signature);
+
+  static QStringList signBatch(const CryptoNote::AccountKeys& _keys, const QStringList& _messages);
+  static QVector<MessageCheckResult> verifyBatch(const QVector<SignedMessage>& _messages, size_t _threadCount = 0,
+    Progress* _progress = nullptr);
+
+  // One triple per line, message may contain the separator: message,address,signature
+  // or the same separated by tabs
+  static bool loadBatch(const QString& _fileName, QVector<SignedMessage>& _messages, QString& _errorText);
+  static QString resultText(MessageCheckResult _result);
+
+  // Verifications per second on one thread and on all cores
+  static SignatureBenchmark benchmark(size_t _signatureCount, Progress* _progress = nullptr);
+};
+
+// Runs batch verification and the benchmark off the GUI thread, one job at a
+// time. Starting a job or destroying the object cancels the running one.
+class MessageSignerJob : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(MessageSignerJob)
+
+public:
+  explicit MessageSignerJob(QObject* _parent = nullptr);
+  ~MessageSignerJob();
+
+  quint64 verify(const QVector<SignedMessage>& _messages);
+  quint64 benchmark(size_t _signatureCount);
+  void cancel();
+  bool isRunning() const;
+
+private:
+  std::thread m_thread;
+  std::atomic<bool> m_running;
+  MessageSigner::Progress m_progress;
+  quint64 m_jobId;
+  QTimer m_progressTimer;
+
+  void startJob(std::function<void(quint64)>&& _job);
+  void updateProgress();
+
+Q_SIGNALS:
+  void progressSignal(quint64 _jobId, int _done, int _total);
+  void batchVerifiedSignal(quint64 _jobId, const QVector<WalletGui::MessageCheckResult>& _results, qint64 _elapsed, bool _cancelled);
+  void benchmarkFinishedSignal(quint64 _jobId, const WalletGui::SignatureBenchmark& _result, bool _cancelled);
+};
+
+}
@@ -18,7 +18,10 @@
 
 #include "Miner.h"
 
+#include <algorithm>
+#include <cstring>
 #include <future>
+#include <limits>
 #include <numeric>
 #include <sstream>
 #include <thread>
@@ -45,6 +48,8 @@
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionExtra.h"
 
+#include "CpuTopology.h"
+#include "InterleavedHash.h"
 #include "CurrencyAdapter.h"
 #include "Wallet/WalletRpcServerCommandsDefinitions.h"
 
@@ -65,126 +70,334 @@ namespace WalletGui
     QObject(_parent),
     m_logger(log, "Miner"),
     m_stop_mining(true),
-    m_template(boost::value_initialized<Block>()),
+    m_template(),
     m_template_no(0),
     m_diffic(0),
     m_pausers_count(0),
     m_threads_total(0),
+    m_threads_active(0),
     m_starter_nonce(0),
     m_last_hr_merge_time(0),
-    m_hashes(0),
+    m_sign_cost_us(0),
+    m_pow_cost_us(0),
     m_do_mining(false),
     m_current_hash_rate(0),
     m_hash_rate(0),
-    m_update_block_template_interval(240),
-    m_update_merge_hr_interval(2) {
+    m_last_hash_rates(),
+    m_last_hash_rates_pos(0),
+    m_last_hash_rates_count(0),
+    m_stale_since(0),
+    m_last_stale_ms(0),
+    m_stale_thread_ms(0),
+    m_stale_templates(0),
+    m_hash_ways(1),
+    m_template_requested_again(false) {
+    m_template_retry_timer.setSingleShot(true);
+    m_template_retry_timer.setInterval(TEMPLATE_RETRY_DELAY);
+    connect(&m_template_retry_timer, &QTimer::timeout, this, [this]() {
+      if (is_mining()) {
+        request_block_template();
+      }
+    });
+    connect(this, &Miner::blockTemplateFetchedSignal, this, &Miner::block_template_fetched, Qt::QueuedConnection);
   }
   //-----------------------------------------------------------------------------------------------------
   Miner::~Miner() {
     stop();
   }
   //-----------------------------------------------------------------------------------------------------
-  bool Miner::set_block_template(const Block& bl, const difficulty_type& di) {
-    std::lock_guard<decltype(m_template_lock)> lk(m_template_lock);
+  bool Miner::make_template(const Block& bl, const difficulty_type& di, Node* node, miner_template& tmpl) {
+    tmpl.block = bl;
+    tmpl.difficulty = di;
+    tmpl.nonce_offset = 0;
+    tmpl.blob_pow = false;
+    tmpl.node = node;
+    if (tmpl.node == nullptr) {
+      return false;
+    }
 
-    m_template = bl;
+    // from version 5 on the PoW mixes in blocks from the whole chain, a daemon
+    // hands out such templates but the wallet cannot hash them
+    if (tmpl.block.majorVersion >= CryptoNote::BLOCK_MAJOR_VERSION_5 && tmpl.node->getNodeType() != NodeType::IN_PROCESS) {
+      m_logger(Logging::ERROR) << "Blocks of version " << static_cast<int>(tmpl.block.majorVersion) << " can only be mined with the embedded node";
+      Q_EMIT minerMessageSignal(QString("Blocks of version %1 can only be mined with the embedded node").arg(tmpl.block.majorVersion));
+      return false;
+    }
 
-    if (m_template.majorVersion == BLOCK_MAJOR_VERSION_2 || m_template.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    if (tmpl.block.majorVersion == BLOCK_MAJOR_VERSION_2 || tmpl.block.majorVersion == BLOCK_MAJOR_VERSION_3) {
       CryptoNote::TransactionExtraMergeMiningTag mm_tag;
       mm_tag.depth = 0;
-      if (!CryptoNote::get_aux_block_header_hash(m_template, mm_tag.merkleRoot)) {
+      if (!CryptoNote::get_aux_block_header_hash(tmpl.block, mm_tag.merkleRoot)) {
         return false;
       }
 
-      m_template.parentBlock.baseTransaction.extra.clear();
-      if (!CryptoNote::appendMergeMiningTagToExtra(m_template.parentBlock.baseTransaction.extra, mm_tag)) {
+      tmpl.block.parentBlock.baseTransaction.extra.clear();
+      if (!CryptoNote::appendMergeMiningTagToExtra(tmpl.block.parentBlock.baseTransaction.extra, mm_tag)) {
         return false;
       }
     }
 
-    m_diffic = di;
-    ++m_template_no;
-    m_starter_nonce = Random::randomValue<uint32_t>();
+    // Blocks are signed per nonce. The signing key does not depend on the nonce and the
+    // nonce is the only part of the hashing blob that does, so both are prepared once here.
+    // Before version 5 the PoW is computed from the same blob.
+    Block probe = tmpl.block;
+    BinaryArray other_blob;
+    probe.nonce = 0;
+    if (!get_block_hashing_blob(probe, tmpl.hashing_blob)) {
+      return false;
+    }
+
+    probe.nonce = std::numeric_limits<uint32_t>::max();
+    if (!get_block_hashing_blob(probe, other_blob) || other_blob.size() != tmpl.hashing_blob.size()) {
+      return false;
+    }
+
+    auto first = std::mismatch(tmpl.hashing_blob.begin(), tmpl.hashing_blob.end(), other_blob.begin());
+    tmpl.nonce_offset = first.first - tmpl.hashing_blob.begin();
+    if (tmpl.nonce_offset + sizeof(uint32_t) > tmpl.hashing_blob.size() ||
+        !std::equal(tmpl.hashing_blob.begin() + tmpl.nonce_offset + sizeof(uint32_t), tmpl.hashing_blob.end(), other_blob.begin() + tmpl.nonce_offset + sizeof(uint32_t))) {
+      m_logger(Logging::ERROR) << "Nonce not found in block hashing blob";
+      return false;
+    }
+
+    if (tmpl.block.majorVersion < CryptoNote::BLOCK_MAJOR_VERSION_5) {
+      tmpl.blob_pow = check_blob_pow(tmpl);
+      return true;
+    }
+
+    try {
+      Crypto::PublicKey txPublicKey = getTransactionPublicKeyFromExtra(tmpl.block.baseTransaction.extra);
+      Crypto::KeyDerivation derivation;
+      if (!Crypto::generate_key_derivation(txPublicKey, m_account.viewSecretKey, derivation)) {
+        m_logger(Logging::ERROR) << "Failed to generate_key_derivation for block signature";
+        Q_EMIT minerMessageSignal(QString("Failed to generate_key_derivation for block signature"));
+        return false;
+      }
+
+      Crypto::derive_secret_key(derivation, 0, m_account.spendSecretKey, tmpl.signing_secret_key);
+      tmpl.signing_public_key = boost::get<KeyOutput>(tmpl.block.baseTransaction.outputs[0].target).key;
+    } catch (std::exception& e) {
+      m_logger(Logging::ERROR) << "Preparing block signature failed: " << e.what();
+      Q_EMIT minerMessageSignal(QString("Preparing block signature failed") + QString(e.what()));
+      return false;
+    }
+
     return true;
   }
   //-----------------------------------------------------------------------------------------------------
-  bool Miner::on_block_chain_update() {
-    if (!is_mining()) {
-      return true;
+  bool Miner::check_blob_pow(const miner_template& tmpl)
+  {
+    // the node's long hash of one nonce against CryptoNight over the prepared blob,
+    // so a block version whose PoW is not plain CryptoNight over it stays with the node
+    Crypto::cn_context context;
+    Crypto::Hash expected;
+    Crypto::Hash hash;
+    if (!tmpl.node->getBlockLongHash(context, tmpl.block, expected)) {
+      return false;
     }
 
-    //pause();
+    BinaryArray blob = tmpl.hashing_blob;
+    std::memcpy(&blob[tmpl.nonce_offset], &tmpl.block.nonce, sizeof(tmpl.block.nonce));
+    Crypto::cn_slow_hash(context, blob.data(), blob.size(), hash);
+    if (hash != expected) {
+      m_logger(Logging::DEBUGGING) << "CryptoNight over the hashing blob does not match the PoW of block version " << static_cast<int>(tmpl.block.majorVersion);
+      return false;
+    }
+
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------------
+  uint64_t millisecondsSinceEpoch() {
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+  }
+  //-----------------------------------------------------------------------------------------------------
+  bool Miner::set_block_template(const Block& bl, const difficulty_type& di, Node* node) {
+    std::shared_ptr<miner_template> tmpl = std::make_shared<miner_template>();
+    if (!make_template(bl, di, node, *tmpl)) {
+      return false;
+    }
+
+    // Workers pick the new snapshot up on their next hash, the old one lives
+    // until the last of them let go of it
+    {
+      std::lock_guard<std::mutex> lk(m_work_lock);
+      m_diffic = di;
+      m_starter_nonce = Random::randomValue<uint32_t>();
+      std::atomic_store(&m_template, std::shared_ptr<const miner_template>(tmpl));
+      ++m_template_no;
+    }
 
-    if (request_block_template()) {
-      //resume();
+    m_work_cv.notify_all();
+
+    const uint64_t stale_since = m_stale_since.exchange(0);
+    if (stale_since != 0 && is_mining()) {
+      const uint64_t stale_ms = millisecondsSinceEpoch() - stale_since;
+      m_last_stale_ms = stale_ms;
+      m_stale_thread_ms += m_pausers_count ? 0 : stale_ms * std::min(m_threads_active.load(), m_threads_total.load());
+      ++m_stale_templates;
+      m_logger(Logging::DEBUGGING) << "Template replaced " << stale_ms << " ms after a new block";
+    }
+
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------------
+  bool Miner::on_new_block() {
+    if (!is_mining()) {
       return true;
     }
-    else {
-      stop();
+
+    // from now on the workers hash on top of a block that is no longer the tip
+    uint64_t not_stale = 0;
+    m_stale_since.compare_exchange_strong(not_stale, millisecondsSinceEpoch());
+    return on_block_chain_update();
+  }
+  //-----------------------------------------------------------------------------------------------------
+  bool Miner::on_block_chain_update() {
+    if (!is_mining()) {
+      return true;
     }
 
-    return false;
+    return request_block_template();
   }
   //-----------------------------------------------------------------------------------------------------
   bool Miner::request_block_template() {
+    m_template_retry_timer.stop();
+    if (m_template_thread.joinable()) {
+      // the template in flight may predate the change, fetch once more after it
+      m_template_requested_again = true;
+      return true;
+    }
+
+    Node* node = NodeAdapter::instance().getCurrentNode();
+    if (node == nullptr) {
+      m_logger(Logging::ERROR) << "No node to request a block template from";
+      return false;
+    }
+
     QDateTime date = QDateTime::currentDateTime();
     QString formattedTime = date.toString("dd.MM.yyyy hh:mm:ss");
     qDebug() << formattedTime << "Requesting block template";
 
+    m_template_requested_again = false;
+    m_template_thread = std::thread(&Miner::fetch_block_template, this, node, m_account);
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::fetch_block_template(Node* node, AccountKeys account) {
     Block bl = boost::value_initialized<Block>();
     CryptoNote::difficulty_type di = 0;
     uint32_t height;
     CryptoNote::BinaryArray extra_nonce;
 
-    if (!NodeAdapter::instance().getBlockTemplate(bl, m_account, extra_nonce, di, height)) {
-      m_logger(Logging::ERROR) << "Failed to get_block_template(), stopping mining";
-      Q_EMIT minerMessageSignal(QString("Failed to get_block_template()"));
-      return false;
+    bool ok = node->getBlockTemplate(bl, account, extra_nonce, di, height);
+    if (!ok) {
+      m_logger(Logging::ERROR) << "Failed to get_block_template(), retrying";
+      Q_EMIT minerMessageSignal(QString("Failed to get_block_template(), retrying"));
+    } else if (!m_stop_mining) {
+      ok = set_block_template(bl, di, node);
+      if (!ok) {
+        m_logger(Logging::ERROR) << "Failed to prepare block template, retrying";
+        Q_EMIT minerMessageSignal(QString("Failed to prepare block template, retrying"));
+      }
     }
 
-    set_block_template(bl, di);
-
-    return true;
+    Q_EMIT blockTemplateFetchedSignal(ok);
   }
   //-----------------------------------------------------------------------------------------------------
-  bool Miner::on_idle()
-  {
-    m_update_block_template_interval.call([&](){
-      if (is_mining())
-        request_block_template();
-      return true;
-    });
+  void Miner::block_template_fetched(bool ok) {
+    if (m_template_thread.joinable()) {
+      m_template_thread.join();
+    }
 
-    m_update_merge_hr_interval.call([&](){
-      merge_hr();
-      return true;
-    });
+    if (!is_mining()) {
+      return;
+    }
 
-    return true;
+    if (m_template_requested_again) {
+      request_block_template();
+      return;
+    }
+
+    if (!ok) {
+      if (m_stale_since != 0) {
+        // the template is outdated by a new block, workers wait instead of hashing it
+        {
+          std::lock_guard<std::mutex> lk(m_work_lock);
+          std::atomic_store(&m_template, std::shared_ptr<const miner_template>());
+          ++m_template_no;
+        }
+
+        m_work_cv.notify_all();
+      }
+
+      m_template_retry_timer.start();
+    }
   }
   //-----------------------------------------------------------------------------------------------------
-  uint64_t millisecondsSinceEpoch() {
-    auto now = std::chrono::steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+  void Miner::get_stale_stats(uint64_t& last_ms, uint64_t& total_thread_ms, uint32_t& templates)
+  {
+    last_ms = m_last_stale_ms;
+    total_thread_ms = m_stale_thread_ms;
+    templates = m_stale_templates;
   }
 
   //-----------------------------------------------------------------------------------------------------
   void Miner::merge_hr()
   {
+    std::shared_ptr<miner_thread_stats_list> stats = std::atomic_load(&m_thread_stats);
+    std::lock_guard<std::mutex> lk(m_hash_rates_lock);
+    const uint64_t now = millisecondsSinceEpoch();
+    const size_t threads = stats ? stats->size() : 0;
+    if (stats != m_merged_stats) {
+      // a new run, counting starts from its threads' current values
+      m_merged_stats = stats;
+      m_merged_hashes.assign(threads, 0);
+      m_merged_sign_time_ns.assign(threads, 0);
+      m_merged_pow_time_ns.assign(threads, 0);
+      m_thread_hash_rates.assign(threads, 0);
+      m_last_hr_merge_time = 0;
+    }
+
+    // workers are never reset, each merge takes the difference to the previous one
+    uint64_t hashes = 0;
+    uint64_t sign_time_ns = 0;
+    uint64_t pow_time_ns = 0;
+    for (size_t i = 0; i < threads; ++i) {
+      const miner_thread_stats& thread_stats = (*stats)[i];
+      const uint64_t thread_hashes = thread_stats.hashes.load(std::memory_order_relaxed);
+      const uint64_t thread_sign_time_ns = thread_stats.sign_time_ns.load(std::memory_order_relaxed);
+      const uint64_t thread_pow_time_ns = thread_stats.pow_time_ns.load(std::memory_order_relaxed);
+      const uint64_t thread_delta = thread_hashes - m_merged_hashes[i];
+      if (m_last_hr_merge_time) {
+        m_thread_hash_rates[i] = static_cast<double>(thread_delta) * 1000 / (now - m_last_hr_merge_time + 1);
+      }
+
+      hashes += thread_delta;
+      sign_time_ns += thread_sign_time_ns - m_merged_sign_time_ns[i];
+      pow_time_ns += thread_pow_time_ns - m_merged_pow_time_ns[i];
+      m_merged_hashes[i] = thread_hashes;
+      m_merged_sign_time_ns[i] = thread_sign_time_ns;
+      m_merged_pow_time_ns[i] = thread_pow_time_ns;
+    }
+
     if(m_last_hr_merge_time && is_mining()) {
-      m_current_hash_rate = m_hashes * 1000 / (millisecondsSinceEpoch() - m_last_hr_merge_time + 1);
-      std::lock_guard<std::mutex> lk(m_last_hash_rates_lock);
-      m_last_hash_rates.push_back(m_current_hash_rate);
-      if(m_last_hash_rates.size() > 19)
-        m_last_hash_rates.pop_front();
-
-      uint64_t total_hr = std::accumulate(m_last_hash_rates.begin(), m_last_hash_rates.end(), static_cast<uint64_t>(0));
-      m_hash_rate = static_cast<float>(total_hr) / static_cast<float>(m_last_hash_rates.size());
+      m_current_hash_rate = hashes * 1000 / (now - m_last_hr_merge_time + 1);
+      if (hashes > 0) {
+        m_sign_cost_us = static_cast<double>(sign_time_ns) / hashes / 1000;
+        m_pow_cost_us = static_cast<double>(pow_time_ns) / hashes / 1000;
+      }
+
+      m_last_hash_rates[m_last_hash_rates_pos] = m_current_hash_rate;
+      m_last_hash_rates_pos = (m_last_hash_rates_pos + 1) % m_last_hash_rates.size();
+      m_last_hash_rates_count = std::min(m_last_hash_rates_count + 1, m_last_hash_rates.size());
+
+      uint64_t total_hr = std::accumulate(m_last_hash_rates.begin(), m_last_hash_rates.begin() + m_last_hash_rates_count, static_cast<uint64_t>(0));
+      m_hash_rate = static_cast<float>(total_hr) / static_cast<float>(m_last_hash_rates_count);
       //qDebug() << "Hashrate: " << m_hash_rate << " H/s";
     }
     
-    m_last_hr_merge_time = millisecondsSinceEpoch();
-    m_hashes = 0;
+    m_last_hr_merge_time = now;
   }
 
   //-----------------------------------------------------------------------------------------------------
@@ -202,10 +415,8 @@ namespace WalletGui
 
     std::lock_guard<std::mutex> lk(m_threads_lock);
 
-    if(!m_threads.empty()) {
-      m_logger(Logging::DEBUGGING) << "Unable to start miner because there are active mining threads";
-      return false;
-    }
+    // threads that stopped on their own after an error are still to be joined
+    join_threads();
 
     if (!WalletAdapter::instance().getAccountKeys(m_account)) {
       m_logger(Logging::ERROR) << "Unable to start miner because couldn't get account keys";
@@ -214,27 +425,216 @@ namespace WalletGui
     m_threads_total = static_cast<uint32_t>(threads_count);
     m_starter_nonce = Random::randomValue<uint32_t>();
 
+    {
+      std::lock_guard<std::mutex> work_lk(m_work_lock);
+      m_stop_mining = false;
+      m_threads_active = static_cast<uint32_t>(threads_count);
+      m_pausers_count = 0; // in case mining wasn't resumed after pause
+      // the template of a previous run is outdated, workers wait for a fresh one
+      std::atomic_store(&m_template, std::shared_ptr<const miner_template>());
+      ++m_template_no;
+    }
+
     // always request block template on start
     if (!request_block_template()) {
       m_logger(Logging::ERROR) << "Unable to start miner because block template request was unsuccessful";
+      send_stop_signal();
       return false;
     }
 
-    m_stop_mining = false;
-    m_pausers_count = 0; // in case mining wasn't resumed after pause
-
-    for (uint32_t i = 0; i != threads_count; i++) {
-      m_threads.push_back(std::thread(std::bind(&Miner::worker_thread, this, i)));
+    // room for every logical processor, so the thread count can grow without a restart
+    std::shared_ptr<miner_thread_stats_list> stats =
+      std::make_shared<miner_thread_stats_list>(std::max<size_t>(threads_count, std::thread::hardware_concurrency()));
+    std::atomic_store(&m_thread_stats, stats);
+    while (m_threads.size() < threads_count) {
+      spawn_thread(static_cast<uint32_t>(m_threads.size()), stats);
     }
 
     QDateTime date = QDateTime::currentDateTime();
     QString formattedTime = date.toString("dd.MM.yyyy hh:mm:ss");
 
-    m_logger(Logging::INFO) << "Mining has started with " << threads_count << " thread(s), at difficulty " << m_diffic << " good luck!";
-    Q_EMIT minerMessageSignal(QString("%1 Mining has started with %2 thread(s) at difficulty %3, good luck!").arg(formattedTime).arg(threads_count).arg(m_diffic));
+    if (!m_thread_cpus.empty()) {
+      m_logger(Logging::INFO) << "Mining threads are pinned to " << std::min(threads_count, m_thread_cpus.size()) << " logical processor(s)";
+    }
+
+    if (m_hash_ways > 1) {
+      m_logger(Logging::INFO) << "Blocks before version 5 are hashed " << m_hash_ways << " nonces at once";
+    }
+
+    m_logger(Logging::INFO) << "Mining has started with " << threads_count << " thread(s), good luck!";
+    Q_EMIT minerMessageSignal(QString("%1 Mining has started with %2 thread(s), good luck!").arg(formattedTime).arg(threads_count));
     return true;
   }
   
+  //-----------------------------------------------------------------------------------------------------
+  bool Miner::set_threads_count(size_t threads_count)
+  {
+    if (threads_count == 0) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lk(m_threads_lock);
+    std::shared_ptr<miner_thread_stats_list> stats = std::atomic_load(&m_thread_stats);
+    if (m_stop_mining || !stats) {
+      // takes effect on the next start
+      m_threads_total = static_cast<uint32_t>(threads_count);
+      return true;
+    }
+
+    if (threads_count > stats->size()) {
+      m_logger(Logging::DEBUGGING) << "Unable to run " << threads_count << " mining threads without a restart";
+      return false;
+    }
+
+    if (threads_count == m_threads.size()) {
+      return true;
+    }
+
+    // a new stride means new nonce sequences, workers restart them like on a new template
+    {
+      std::lock_guard<std::mutex> work_lk(m_work_lock);
+      m_threads_total = static_cast<uint32_t>(threads_count);
+      m_threads_active = static_cast<uint32_t>(threads_count);
+      m_starter_nonce = Random::randomValue<uint32_t>();
+      ++m_template_no;
+    }
+
+    m_work_cv.notify_all();
+
+    // workers beyond the new count leave their loop on their own
+    while (m_threads.size() > threads_count) {
+      m_threads.back().join();
+      m_threads.pop_back();
+    }
+
+    while (m_threads.size() < threads_count) {
+      spawn_thread(static_cast<uint32_t>(m_threads.size()), stats);
+    }
+
+    m_logger(Logging::INFO) << "Mining continues with " << threads_count << " thread(s)";
+    Q_EMIT minerMessageSignal(QString("Mining continues with %1 thread(s)").arg(threads_count));
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::set_active_threads(size_t threads_count)
+  {
+    {
+      std::lock_guard<std::mutex> work_lk(m_work_lock);
+      // parked workers only leave gaps in the nonce sequence, nothing restarts
+      m_threads_active = static_cast<uint32_t>(std::min<size_t>(threads_count, m_threads_total));
+    }
+
+    m_work_cv.notify_all();
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  size_t Miner::get_threads_count()
+  {
+    return m_threads_total;
+  }
+
+  size_t Miner::get_active_threads()
+  {
+    return is_mining() && !m_pausers_count ? std::min(m_threads_active.load(), m_threads_total.load()) : 0;
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::spawn_thread(uint32_t th_local_index, const std::shared_ptr<miner_thread_stats_list>& stats)
+  {
+    // called with m_threads_lock held
+    int cpu = m_thread_cpus.empty() ? -1 : m_thread_cpus[th_local_index % m_thread_cpus.size()];
+    m_threads.push_back(std::thread(std::bind(&Miner::worker_thread, this, th_local_index, cpu, stats)));
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::join_threads()
+  {
+    // called with m_threads_lock held, after the stop signal
+    for (auto& th : m_threads) {
+      th.join();
+    }
+
+    m_threads.clear();
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::set_thread_affinity(const std::vector<int>& cpus)
+  {
+    std::lock_guard<std::mutex> lk(m_threads_lock);
+    m_thread_cpus = cpus;
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::set_hash_ways(size_t ways)
+  {
+    // the self test behind maxWays() runs on first use only, and only if asked for more than one
+    m_hash_ways = static_cast<uint32_t>(ways > 1 ? std::min(ways, InterleavedHash::maxWays()) : 1);
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  uint64_t Miner::benchmark(size_t threads_count, const std::vector<int>& cpus, size_t ways, uint32_t duration_ms, const std::atomic<bool>& cancelled)
+  {
+    // the size of a usual hashing blob, the nonce where a block header has it
+    const size_t blob_size = 76;
+    const size_t nonce_offset = 39;
+
+    std::atomic<bool> stop(false);
+    std::vector<uint64_t> hashes(threads_count, 0);
+    std::vector<std::thread> threads;
+    ways = std::max<size_t>(1, std::min(ways, InterleavedHash::maxWays()));
+    for (size_t i = 0; i < threads_count; ++i) {
+      int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+      threads.emplace_back([&stop, &hashes, i, cpu, threads_count, ways, blob_size, nonce_offset]() {
+        if (cpu >= 0) {
+          CpuTopology::pinCurrentThread(cpu);
+        }
+
+        uint32_t nonce = static_cast<uint32_t>(i);
+        uint64_t count = 0;
+        if (ways > 1) {
+          InterleavedHash hasher(ways);
+          BinaryArray blobs(ways * blob_size, 0x5a);
+          std::vector<Crypto::Hash> batch(ways);
+          while (!stop) {
+            for (size_t w = 0; w < ways; ++w) {
+              std::memcpy(&blobs[w * blob_size + nonce_offset], &nonce, sizeof(nonce));
+              nonce += static_cast<uint32_t>(threads_count);
+            }
+
+            hasher.hash(blobs.data(), blob_size, batch.data());
+            count += ways;
+          }
+        } else {
+          Crypto::cn_context context;
+          BinaryArray blob(blob_size, 0x5a);
+          Crypto::Hash hash;
+          while (!stop) {
+            std::memcpy(&blob[nonce_offset], &nonce, sizeof(nonce));
+            Crypto::cn_slow_hash(context, blob.data(), blob.size(), hash);
+            nonce += static_cast<uint32_t>(threads_count);
+            ++count;
+          }
+        }
+
+        // read only after the join
+        hashes[i] = count;
+      });
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms);
+    while (!cancelled && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    stop = true;
+    for (auto& th : threads) {
+      th.join();
+    }
+
+    return std::accumulate(hashes.begin(), hashes.end(), static_cast<uint64_t>(0));
+  }
+
   //-----------------------------------------------------------------------------------------------------
   double Miner::get_speed()
   {
@@ -244,10 +644,34 @@ namespace WalletGui
       return 0;
   }
   
+  //-----------------------------------------------------------------------------------------------------
+  std::vector<double> Miner::get_thread_speeds()
+  {
+    std::lock_guard<std::mutex> lk(m_hash_rates_lock);
+    if (!is_mining()) {
+      return std::vector<double>();
+    }
+
+    // the stats have room for more threads than are running
+    return std::vector<double>(m_thread_hash_rates.begin(), m_thread_hash_rates.begin() + std::min<size_t>(m_threads_total, m_thread_hash_rates.size()));
+  }
+
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::get_hash_cost(double& sign_us, double& pow_us)
+  {
+    sign_us = is_mining() ? m_sign_cost_us.load() : 0;
+    pow_us = is_mining() ? m_pow_cost_us.load() : 0;
+  }
+
   //-----------------------------------------------------------------------------------------------------
   void Miner::send_stop_signal() 
   {
-    m_stop_mining = true;
+    {
+      std::lock_guard<std::mutex> lk(m_work_lock);
+      m_stop_mining = true;
+    }
+
+    m_work_cv.notify_all();
   }
 
   //-----------------------------------------------------------------------------------------------------
@@ -255,21 +679,29 @@ namespace WalletGui
   {
     send_stop_signal();
 
-    int threadsCount = m_threads.size();
-
-    std::lock_guard<std::mutex> lk(m_threads_lock);
-
-    for (auto& th : m_threads) {
-      th.detach();
+    m_template_retry_timer.stop();
+    if (m_template_thread.joinable()) {
+      m_template_thread.join();
     }
 
-    m_threads.clear();
+    std::lock_guard<std::mutex> lk(m_threads_lock);
+    size_t threadsCount = m_threads.size();
+    join_threads();
 
     m_current_hash_rate = 0;
     m_hash_rate = 0;
-    m_last_hash_rates.clear();
+    m_stale_since = 0;
+    std::atomic_store(&m_thread_stats, std::shared_ptr<miner_thread_stats_list>());
+    {
+      std::lock_guard<std::mutex> hr_lk(m_hash_rates_lock);
+      m_last_hash_rates_pos = 0;
+      m_last_hash_rates_count = 0;
+      m_last_hr_merge_time = 0;
+      m_merged_stats.reset();
+      m_thread_hash_rates.clear();
+    }
 
-    m_logger(Logging::INFO) << "Mining stopped, " << m_threads.size() << " threads finished" ;
+    m_logger(Logging::INFO) << "Mining stopped, " << threadsCount << " threads finished" ;
     Q_EMIT minerMessageSignal(QString("Mining stopped, %1 threads finished").arg(threadsCount));
 
     return true;
@@ -284,7 +716,7 @@ namespace WalletGui
   //-----------------------------------------------------------------------------------------------------
   void Miner::pause()
   {
-    std::lock_guard<std::mutex> lk(m_miners_count_lock);
+    std::lock_guard<std::mutex> lk(m_work_lock);
     ++m_pausers_count;
     if(m_pausers_count == 1 && is_mining())
       qDebug() << "MINING PAUSED";
@@ -292,7 +724,7 @@ namespace WalletGui
   //-----------------------------------------------------------------------------------------------------
   void Miner::resume()
   {
-    std::lock_guard<std::mutex> lk(m_miners_count_lock);
+    std::unique_lock<std::mutex> lk(m_work_lock);
     --m_pausers_count;
     if(m_pausers_count < 0)
     {
@@ -303,118 +735,178 @@ namespace WalletGui
     if(!m_pausers_count && is_mining())
       qDebug() << "MINING RESUMED";
       //Q_EMIT minerMessageSignal(QString("MINING RESUMED"));
+
+    lk.unlock();
+    m_work_cv.notify_all();
   }
   //-----------------------------------------------------------------------------------------------------
-  bool Miner::worker_thread(uint32_t th_local_index)
+  bool Miner::worker_thread(uint32_t th_local_index, int cpu, std::shared_ptr<miner_thread_stats_list> stats)
   {
     m_logger(Logging::DEBUGGING) << "Miner thread was started ["<< th_local_index << "]";
+    // pin before the scratchpads are allocated, they are bound to the NUMA node of the thread's CPU
+    if (cpu >= 0 && !CpuTopology::pinCurrentThread(cpu)) {
+      m_logger(Logging::DEBUGGING) << "Unable to pin miner thread [" << th_local_index << "] to CPU " << cpu;
+    }
+
+    miner_thread_stats& thread_stats = (*stats)[th_local_index];
+    // counters of the current nonce batch, published to thread_stats once per batch
+    uint32_t batch_hashes = 0;
+    uint64_t batch_sign_ns = 0;
+    uint64_t batch_pow_ns = 0;
+    auto flush_batch = [&]() {
+      // single writer, a plain store is enough and avoids a locked instruction
+      thread_stats.hashes.store(thread_stats.hashes.load(std::memory_order_relaxed) + batch_hashes, std::memory_order_relaxed);
+      thread_stats.sign_time_ns.store(thread_stats.sign_time_ns.load(std::memory_order_relaxed) + batch_sign_ns, std::memory_order_relaxed);
+      thread_stats.pow_time_ns.store(thread_stats.pow_time_ns.load(std::memory_order_relaxed) + batch_pow_ns, std::memory_order_relaxed);
+      batch_hashes = 0;
+      batch_sign_ns = 0;
+      batch_pow_ns = 0;
+    };
+
     uint32_t nonce = m_starter_nonce + th_local_index;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     Crypto::cn_context context;
+    std::shared_ptr<const miner_template> tmpl;
     Block b;
-
-    while(!m_stop_mining)
+    BinaryArray blob;
+    // blocks before version 5 with more than one way go through the interleaved hash,
+    // its scratchpads are only allocated once such a template comes
+    const size_t ways = m_hash_ways;
+    std::unique_ptr<InterleavedHash> hasher;
+    BinaryArray batch_blobs;
+    std::vector<Crypto::Hash> batch_pows(ways);
+
+    while(!m_stop_mining && th_local_index < m_threads_total)
     {
-      if(m_pausers_count) //anti split workaround
+      if(m_pausers_count || th_local_index >= m_threads_active || (!tmpl && local_template_ver == m_template_no)) //anti split workaround, parked by the governor, or no template yet
       {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        flush_batch();
+        std::unique_lock<std::mutex> lk(m_work_lock);
+        m_work_cv.wait(lk, [&]() {
+          return m_stop_mining || th_local_index >= m_threads_total || (!m_pausers_count && th_local_index < m_threads_active && (tmpl || local_template_ver != m_template_no));
+        });
         continue;
       }
 
       if(local_template_ver != m_template_no) {
-        std::unique_lock<std::mutex> lk(m_template_lock);
-        b = m_template;
-        local_diff = m_diffic;
-        lk.unlock();
-
+        // the counter is read first, a template published meanwhile is picked up next round
         local_template_ver = m_template_no;
+        tmpl = std::atomic_load(&m_template);
+        if (tmpl) {
+          b = tmpl->block;
+          blob = tmpl->hashing_blob;
+          local_diff = tmpl->difficulty;
+        }
+
         nonce = m_starter_nonce + th_local_index;
       }
 
-      if(!local_template_ver) //no any set_block_template call
+      if(!tmpl) //no any set_block_template call
       {
         m_logger(Logging::DEBUGGING) << "Block template not set yet";
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
         continue;
       }
 
-      b.nonce = nonce;
+      if (tmpl->blob_pow && ways > 1) {
+        // a batch of this thread's next nonces, hashed together on separate scratchpads
+        if (!hasher) {
+          hasher.reset(new InterleavedHash(ways));
+          m_logger(Logging::DEBUGGING) << "Miner thread [" << th_local_index << "] scratchpads on " << (hasher->largePages() ? "large" : "regular") << " pages";
+        }
 
-      // step 1: sing the block
-      if (b.majorVersion >= CryptoNote::BLOCK_MAJOR_VERSION_5) {
-        BinaryArray ba;
-        if (!get_block_hashing_blob(b, ba)) {
-          m_logger(Logging::ERROR) << "get_block_hashing_blob for signature failed.";
-          Q_EMIT minerMessageSignal(QString("get_block_hashing_blob for signature failed"));
-          m_stop_mining = true;
+        batch_blobs.resize(ways * blob.size());
+        for (size_t w = 0; w < ways; ++w) {
+          const uint32_t batch_nonce = nonce + static_cast<uint32_t>(w) * m_threads_total;
+          std::copy(blob.begin(), blob.end(), batch_blobs.begin() + w * blob.size());
+          std::memcpy(&batch_blobs[w * blob.size() + tmpl->nonce_offset], &batch_nonce, sizeof(batch_nonce));
         }
 
-        Crypto::Hash h = Crypto::cn_fast_hash(ba.data(), ba.size());
-        try {
-          Crypto::PublicKey txPublicKey = getTransactionPublicKeyFromExtra(b.baseTransaction.extra);
-          Crypto::KeyDerivation derivation;
-          if (!Crypto::generate_key_derivation(txPublicKey, m_account.viewSecretKey, derivation)) {
-            m_logger(Logging::ERROR) << "Failed to generate_key_derivation for block signature";
-            Q_EMIT minerMessageSignal(QString("Failed to generate_key_derivation for block signature"));
-            m_stop_mining = true;
+        auto pow_start = std::chrono::steady_clock::now();
+        hasher->hash(batch_blobs.data(), blob.size(), batch_pows.data());
+        batch_pow_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - pow_start).count();
+        for (size_t w = 0; w < ways && !m_stop_mining; ++w) {
+          if (check_hash(batch_pows[w], local_diff)) {
+            b.nonce = nonce + static_cast<uint32_t>(w) * m_threads_total;
+            block_found(*tmpl->node, b, batch_pows[w], local_diff);
           }
-          Crypto::SecretKey ephSecKey;
-          Crypto::derive_secret_key(derivation, 0, m_account.spendSecretKey, ephSecKey);
-          Crypto::PublicKey ephPubKey = boost::get<KeyOutput>(b.baseTransaction.outputs[0].target).key;
-
-          Crypto::generate_signature(h, ephPubKey, ephSecKey, b.signature);
         }
-        catch (std::exception& e) {
-          m_logger(Logging::ERROR) << "Signing block failed: " << e.what();
-          Q_EMIT minerMessageSignal(QString("Signing block failed") + QString(e.what()));
-          m_stop_mining = true;
+
+        nonce += static_cast<uint32_t>(ways) * m_threads_total;
+        batch_hashes += static_cast<uint32_t>(ways);
+        if (batch_hashes >= NONCE_BATCH) {
+          flush_batch();
         }
+
+        continue;
+      }
+
+      b.nonce = nonce;
+      auto sign_start = std::chrono::steady_clock::now();
+
+      // step 1: sign the block, only the nonce in the prepared blob changes
+      if (b.majorVersion >= CryptoNote::BLOCK_MAJOR_VERSION_5) {
+        std::memcpy(&blob[tmpl->nonce_offset], &nonce, sizeof(nonce));
+        Crypto::Hash h = Crypto::cn_fast_hash(blob.data(), blob.size());
+        Crypto::generate_signature(h, tmpl->signing_public_key, tmpl->signing_secret_key, b.signature);
       }
 
-      // step 2: get long hash
+      auto pow_start = std::chrono::steady_clock::now();
+
+      // step 2: get long hash, from the prepared blob if it is plain CryptoNight
       Crypto::Hash pow;
 
-      if (!m_stop_mining) {
-        if (!NodeAdapter::instance().getBlockLongHash(context, b, pow)) {
+      if (tmpl->blob_pow) {
+        std::memcpy(&blob[tmpl->nonce_offset], &nonce, sizeof(nonce));
+        Crypto::cn_slow_hash(context, blob.data(), blob.size(), pow);
+      } else if (!m_stop_mining) {
+        if (!tmpl->node->getBlockLongHash(context, b, pow)) {
           m_logger(Logging::ERROR) << "getBlockLongHash failed.";
           Q_EMIT minerMessageSignal(QString("getBlockLongHash failed"));
-          m_stop_mining = true;
+          send_stop_signal();
         }
       }
 
+      auto pow_end = std::chrono::steady_clock::now();
+      batch_sign_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(pow_start - sign_start).count();
+      batch_pow_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(pow_end - pow_start).count();
+
       if (!m_stop_mining && check_hash(pow, local_diff))
       {
         // we lucky!
-
-        //pause();
-
-        Crypto::Hash id;
-        if (!get_block_hash(b, id)) {
-          m_logger(Logging::ERROR) << "Failed to get block hash.";
-          Q_EMIT minerMessageSignal(QString("Failed to get block hash"));
-          m_stop_mining = true;
-        }
-        uint32_t bh = boost::get<BaseInput>(b.baseTransaction.inputs[0]).blockIndex;
-
-        QDateTime date = QDateTime::currentDateTime();
-        QString formattedTime = date.toString("dd.MM.yyyy hh:mm:ss");
-
-        m_logger(Logging::INFO) << "Found block " << Common::podToHex(id) << " at height " << bh << " for difficulty: " << local_diff << ", POW " << Common::podToHex(pow);
-        Q_EMIT minerMessageSignal(QString("%1 Found block %2 at height %3 for difficulty %4, POW %5").arg(formattedTime).arg(QString::fromStdString(Common::podToHex(id))).arg(bh).arg(local_diff).arg(QString::fromStdString(Common::podToHex(pow))));
-
-        if(!NodeAdapter::instance().handleBlockFound(b)) {
-          m_logger(Logging::ERROR) << "Failed to submit block";
-          Q_EMIT minerMessageSignal(QString("Failed to submit block"));
-        } else {
-          // yay!
-        }
+        block_found(*tmpl->node, b, pow, local_diff);
       }
 
       nonce += m_threads_total;
-      ++m_hashes;
+      if (++batch_hashes >= NONCE_BATCH) {
+        flush_batch();
+      }
     }
+
+    flush_batch();
     m_logger(Logging::DEBUGGING) << "Miner thread stopped ["<< th_local_index << "]";
     return true;
   }
+  //-----------------------------------------------------------------------------------------------------
+  void Miner::block_found(Node& node, Block& b, const Crypto::Hash& pow, difficulty_type diffic)
+  {
+    Crypto::Hash id;
+    if (!get_block_hash(b, id)) {
+      m_logger(Logging::ERROR) << "Failed to get block hash.";
+      Q_EMIT minerMessageSignal(QString("Failed to get block hash"));
+      send_stop_signal();
+    }
+    uint32_t bh = boost::get<BaseInput>(b.baseTransaction.inputs[0]).blockIndex;
+
+    QDateTime date = QDateTime::currentDateTime();
+    QString formattedTime = date.toString("dd.MM.yyyy hh:mm:ss");
+
+    m_logger(Logging::INFO) << "Found block " << Common::podToHex(id) << " at height " << bh << " for difficulty: " << diffic << ", POW " << Common::podToHex(pow);
+    Q_EMIT minerMessageSignal(QString("%1 Found block %2 at height %3 for difficulty %4, POW %5").arg(formattedTime).arg(QString::fromStdString(Common::podToHex(id))).arg(bh).arg(diffic).arg(QString::fromStdString(Common::podToHex(pow))));
+
+    if(!node.handleBlockFound(b)) {
+      m_logger(Logging::ERROR) << "Failed to submit block";
+      Q_EMIT minerMessageSignal(QString("Failed to submit block"));
+    }
+  }
 }
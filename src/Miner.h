@@ -20,16 +20,19 @@
 
 #include <QObject>
 #include <QReadWriteLock>
+#include <QTimer>
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <thread>
 
 #include "CryptoNoteCore/CryptoNoteBasic.h"
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/Difficulty.h"
-#include "CryptoNoteCore/OnceInInterval.h"
 #include "Logging/LoggerRef.h"
 #include "Serialization/ISerializer.h"
 #include "WalletAdapter.h"
@@ -37,6 +40,42 @@
 using namespace CryptoNote;
 
 namespace WalletGui {
+  class Node;
+
+  // Immutable once published, workers share it through a shared_ptr and only
+  // patch the nonce into their own copy of the hashing blob
+  struct miner_template
+  {
+    Block block;
+    difficulty_type difficulty;
+    BinaryArray hashing_blob;
+    size_t nonce_offset;
+    // before block version 5 the PoW is CryptoNight over hashing_blob and was
+    // checked to match the node's: workers hash the blob themselves, several
+    // nonces at once with InterleavedHash if enabled
+    bool blob_pow;
+    // the node that made the template computes the PoW otherwise; taken on the
+    // GUI thread, so workers never go through NodeAdapter
+    Node* node;
+    Crypto::PublicKey signing_public_key;
+    Crypto::SecretKey signing_secret_key;
+  };
+
+  // Counters of one mining thread. Only the owning thread writes them, merge_hr
+  // reads deltas. Padded to two cache lines so neighbouring threads never share
+  // one whatever the alignment of the allocation.
+  struct miner_thread_stats
+  {
+    std::atomic<uint64_t> hashes;
+    std::atomic<uint64_t> sign_time_ns;
+    std::atomic<uint64_t> pow_time_ns;
+    char padding[128 - 3 * sizeof(std::atomic<uint64_t>)];
+
+    miner_thread_stats() : hashes(0), sign_time_ns(0), pow_time_ns(0) {}
+  };
+
+  typedef std::vector<miner_thread_stats> miner_thread_stats_list;
+
   class Miner : public QObject {
     Q_OBJECT
 
@@ -44,22 +83,56 @@ namespace WalletGui {
     Miner(QObject* _parent, Logging::ILogger& log);
     ~Miner();
 
-    bool set_block_template(const Block& bl, const difficulty_type& diffic);
+    bool set_block_template(const Block& bl, const difficulty_type& diffic, Node* node);
+    // Fetches a template from the current node on a thread of its own, a remote
+    // node answers over blocking RPC; a failed fetch is retried while mining.
+    // False only if there is no node to ask.
     bool request_block_template();
+    // Refreshes the template, on_new_block also counts the time until then as stale
     bool on_block_chain_update();
+    bool on_new_block();
     bool start(size_t threads_count);
+    // Grows or shrinks the running pool without restarting it, or sets the count for the next start
+    bool set_threads_count(size_t threads_count);
+    size_t get_threads_count();
+    // Lets only the first threads_count workers of the pool hash, the others
+    // park until it is raised again; capped at the pool size
+    void set_active_threads(size_t threads_count);
+    size_t get_active_threads();
+    // Logical processors to pin the mining threads to, thread i gets cpus[i % size]; empty leaves scheduling to the OS
+    void set_thread_affinity(const std::vector<int>& cpus);
+    // Nonces a worker hashes together on blocks before version 5, capped at what
+    // InterleavedHash::maxWays() allows; 1 uses the library hash. Read on start.
+    void set_hash_ways(size_t ways);
     double get_speed();
+    // Hashrate of every mining thread over the last merge interval, H/s
+    std::vector<double> get_thread_speeds();
+    // Hashes a synthetic blob on threads_count threads for duration_ms, pinned to cpus like the
+    // miner if not empty and ways nonces at a time per thread. Needs neither a node nor a
+    // template; returns the number of hashes.
+    static uint64_t benchmark(size_t threads_count, const std::vector<int>& cpus, size_t ways, uint32_t duration_ms, const std::atomic<bool>& cancelled);
+    // Average time per hash of the last interval spent on block signing and on PoW, microseconds
+    void get_hash_cost(double& sign_us, double& pow_us);
     void send_stop_signal();
     bool stop();
     bool is_mining();
-    bool on_idle();
     void on_synchronized();
     void pause();
     void resume();
     void merge_hr();
+    // How long workers hashed on templates a new block had outdated: the last
+    // time, in total in thread milliseconds, and how many templates that was
+    void get_stale_stats(uint64_t& last_ms, uint64_t& total_thread_ms, uint32_t& templates);
 
   private:
-    bool worker_thread(uint32_t th_local_index);
+    static const size_t HASH_RATE_HISTORY = 19;
+    // Nonces a worker hashes between publishing its counters
+    static const uint32_t NONCE_BATCH = 4;
+    static const int TEMPLATE_RETRY_DELAY = 5000;
+
+    bool worker_thread(uint32_t th_local_index, int cpu, std::shared_ptr<miner_thread_stats_list> stats);
+    void spawn_thread(uint32_t th_local_index, const std::shared_ptr<miner_thread_stats_list>& stats);
+    void join_threads();
 
     struct miner_config
     {
@@ -69,38 +142,67 @@ namespace WalletGui {
       }
     };
 
+    void fetch_block_template(Node* node, AccountKeys account);
+    void block_template_fetched(bool ok);
+    bool make_template(const Block& bl, const difficulty_type& diffic, Node* node, miner_template& tmpl);
+    bool check_blob_pow(const miner_template& tmpl);
+    void block_found(Node& node, Block& b, const Crypto::Hash& pow, difficulty_type diffic);
+
     std::atomic<bool> m_stop_mining;
-    std::mutex m_template_lock;
-    Block m_template;
+    std::shared_ptr<const miner_template> m_template; // accessed with std::atomic_load/atomic_store only
     std::atomic<uint32_t> m_template_no;
     std::atomic<uint32_t> m_starter_nonce;
+    // the fetch in flight and whether another was asked for meanwhile, GUI thread only
+    std::thread m_template_thread;
+    bool m_template_requested_again;
+    QTimer m_template_retry_timer;
     difficulty_type m_diffic;
 
     std::atomic<uint32_t> m_threads_total;
+    // workers at or above it are parked, the nonce stride stays m_threads_total
+    std::atomic<uint32_t> m_threads_active;
     std::atomic<int32_t> m_pausers_count;
-    std::mutex m_miners_count_lock;
+    // idle and paused workers wait on m_work_cv; stop, pause and template state change under m_work_lock
+    std::mutex m_work_lock;
+    std::condition_variable m_work_cv;
 
     std::list<std::thread> m_threads;
     std::mutex m_threads_lock;
+    std::vector<int> m_thread_cpus;
+    std::atomic<uint32_t> m_hash_ways;
     AccountKeys m_account;
-    OnceInInterval m_update_block_template_interval;
-    OnceInInterval m_update_merge_hr_interval;
+    std::atomic<uint64_t> m_stale_since;
+    std::atomic<uint64_t> m_last_stale_ms;
+    std::atomic<uint64_t> m_stale_thread_ms;
+    std::atomic<uint32_t> m_stale_templates;
 
     std::vector<BinaryArray> m_extra_messages;
     miner_config m_config;
     std::string m_config_folder_path;
     std::atomic<uint64_t> m_last_hr_merge_time;
-    std::atomic<uint64_t> m_hashes;
+    // replaced on every start, sized for every logical processor so the pool can grow
+    std::shared_ptr<miner_thread_stats_list> m_thread_stats;
+    std::atomic<double> m_sign_cost_us;
+    std::atomic<double> m_pow_cost_us;
     std::atomic<uint64_t> m_current_hash_rate;
     std::atomic<double> m_hash_rate;
-    std::mutex m_last_hash_rates_lock;
-    std::list<uint64_t> m_last_hash_rates;
+    std::mutex m_hash_rates_lock;
+    // guarded by m_hash_rates_lock
+    std::shared_ptr<miner_thread_stats_list> m_merged_stats;
+    std::vector<uint64_t> m_merged_hashes;
+    std::vector<uint64_t> m_merged_sign_time_ns;
+    std::vector<uint64_t> m_merged_pow_time_ns;
+    std::vector<double> m_thread_hash_rates;
+    std::array<uint64_t, HASH_RATE_HISTORY> m_last_hash_rates;
+    size_t m_last_hash_rates_pos;
+    size_t m_last_hash_rates_count;
     bool m_do_mining;
 
     Logging::LoggerRef m_logger;
 
   Q_SIGNALS:
     void minerMessageSignal(const QString& _message);
+    void blockTemplateFetchedSignal(bool _ok);
 
   };
 }
@@ -0,0 +1,264 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <algorithm>
+
+#include "MiningBenchmark.h"
+#include "CpuTopology.h"
+#include "InterleavedHash.h"
+#include "LoggerAdapter.h"
+#include "Miner.h"
+#include "Settings.h"
+
+namespace WalletGui {
+
+namespace {
+
+// A setting within this share of the fastest one with fewer threads wins,
+// it leaves cores free and draws less power for the same hashrate
+const double BEST_TOLERANCE = 0.02;
+const int MAX_THREAD_COUNTS = 8;
+
+struct Layout {
+  bool pinned;
+  bool skipSmt;
+};
+
+// Sum of the package energy counters of Linux powercap (RAPL), microjoules.
+// Usually readable by root only; false where there is none.
+bool readEnergy(quint64& _energy, quint64& _range) {
+#if defined(Q_OS_LINUX)
+  QDir powercap("/sys/class/powercap");
+  bool found = false;
+  _energy = 0;
+  _range = 0;
+  for (const QString& zone : powercap.entryList(QStringList() << "intel-rapl:[0-9]", QDir::Dirs | QDir::System)) {
+    QFile energyFile(powercap.absoluteFilePath(zone + "/energy_uj"));
+    QFile rangeFile(powercap.absoluteFilePath(zone + "/max_energy_range_uj"));
+    if (!energyFile.open(QIODevice::ReadOnly) || !rangeFile.open(QIODevice::ReadOnly)) {
+      continue;
+    }
+
+    _energy += energyFile.readAll().trimmed().toULongLong();
+    _range += rangeFile.readAll().trimmed().toULongLong();
+    found = true;
+  }
+
+  return found;
+#else
+  Q_UNUSED(_energy);
+  Q_UNUSED(_range);
+  return false;
+#endif
+}
+
+QVector<quint32> threadCounts(quint32 _logicalCpus, quint32 _cores) {
+  // Every count on small machines, a spread including the core count on big ones
+  QVector<quint32> counts;
+  const quint32 step = std::max<quint32>(1, _logicalCpus / MAX_THREAD_COUNTS);
+  for (quint32 count = 1; count <= _logicalCpus; count += step) {
+    counts.append(count);
+  }
+
+  counts << _cores << _logicalCpus;
+  std::sort(counts.begin(), counts.end());
+  counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+  return counts;
+}
+
+}
+
+MiningBenchmark::MiningBenchmark() : QObject(), m_cancelled(false) {
+  m_thread.setObjectName("MiningBenchmark");
+  moveToThread(&m_thread);
+}
+
+MiningBenchmark::~MiningBenchmark() {
+  cancel();
+  m_thread.quit();
+  m_thread.wait();
+}
+
+void MiningBenchmark::start(bool _interleaved, quint32 _runTime) {
+  m_cancelled = false;
+  m_results.clear();
+  m_thread.start();
+  QMetaObject::invokeMethod(this, "run", Qt::QueuedConnection, Q_ARG(bool, _interleaved), Q_ARG(quint32, _runTime));
+}
+
+void MiningBenchmark::cancel() {
+  m_cancelled = true;
+}
+
+bool MiningBenchmark::isRunning() const {
+  return m_thread.isRunning();
+}
+
+const QVector<MiningBenchmarkResult>& MiningBenchmark::results() const {
+  return m_results;
+}
+
+int MiningBenchmark::bestIndex() const {
+  int fastest = -1;
+  for (int i = 0; i < m_results.size(); ++i) {
+    if (fastest < 0 || m_results[i].hashRate > m_results[fastest].hashRate) {
+      fastest = i;
+    }
+  }
+
+  if (fastest < 0) {
+    return -1;
+  }
+
+  int best = fastest;
+  for (int i = 0; i < m_results.size(); ++i) {
+    // fewer threads first, then the library hash over interleaving
+    if (m_results[i].hashRate >= m_results[fastest].hashRate * (1 - BEST_TOLERANCE) && (m_results[i].threads < m_results[best].threads ||
+        (m_results[i].threads == m_results[best].threads && m_results[i].ways < m_results[best].ways))) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+bool MiningBenchmark::applyBest() const {
+  int best = bestIndex();
+  if (best < 0) {
+    return false;
+  }
+
+  const MiningBenchmarkResult& result = m_results[best];
+  Settings::instance().setMiningThreads(result.threads);
+  Settings::instance().setMiningThreadPinningEnabled(result.pinned);
+  Settings::instance().setMiningSkipSmtEnabled(result.skipSmt);
+  Settings::instance().setMiningHashWays(result.ways);
+  return true;
+}
+
+QString MiningBenchmark::describe(const MiningBenchmarkResult& _result) {
+  QString layout = !_result.pinned ? tr("unpinned") : (_result.skipSmt ? tr("pinned, no SMT siblings") : tr("pinned"));
+  if (_result.ways > 1) {
+    layout += tr(", %1 nonces at once").arg(_result.ways);
+  }
+
+  QString text = tr("%1 thread(s), %2: %3 H/s").arg(_result.threads).arg(layout).arg(_result.hashRate, 0, 'f', 1);
+  if (_result.hashesPerJoule > 0) {
+    text += tr(", %1 H/s per W").arg(_result.hashesPerJoule, 0, 'f', 2);
+  }
+
+  return text;
+}
+
+bool MiningBenchmark::measure(quint32 _threads, bool _pinned, bool _skipSmt, quint32 _ways, quint32 _runTime) {
+  std::vector<int> cpus;
+  if (_pinned) {
+    QVector<int> miningCpus = CpuTopology::instance().miningCpus(_skipSmt);
+    cpus.assign(miningCpus.begin(), miningCpus.end());
+  }
+
+  quint64 energyBefore = 0;
+  quint64 energyAfter = 0;
+  quint64 energyRange = 0;
+  const bool hasEnergy = readEnergy(energyBefore, energyRange);
+  QElapsedTimer clock;
+  clock.start();
+  const uint64_t hashes = Miner::benchmark(_threads, cpus, _ways, _runTime, m_cancelled);
+  const qint64 elapsed = std::max<qint64>(clock.elapsed(), 1);
+  if (m_cancelled) {
+    return false;
+  }
+
+  MiningBenchmarkResult result{_threads, _pinned, _skipSmt, _ways, static_cast<double>(hashes) * 1000 / elapsed, 0};
+  if (hasEnergy && readEnergy(energyAfter, energyRange)) {
+    // The counters wrap around at their range
+    const quint64 used = energyAfter >= energyBefore ? energyAfter - energyBefore : energyAfter + energyRange - energyBefore;
+    const double watts = static_cast<double>(used) / elapsed / 1000;
+    if (watts > 0) {
+      result.hashesPerJoule = result.hashRate / watts;
+    }
+  }
+
+  m_results.append(result);
+  LoggerAdapter::instance().log(QString("Mining benchmark: %1").arg(describe(result)).toStdString());
+  return true;
+}
+
+void MiningBenchmark::run(bool _interleaved, quint32 _runTime) {
+  const CpuTopology& topology = CpuTopology::instance();
+  const quint32 logicalCpus = topology.cpus().size();
+  const quint32 cores = topology.coreCount();
+
+  QVector<Layout> layouts;
+  layouts.append(Layout{false, false});
+  if (topology.isAvailable()) {
+    layouts.append(Layout{true, false});
+    if (cores < logicalCpus) {
+      layouts.append(Layout{true, true});
+    }
+  }
+
+  struct Candidate {
+    quint32 threads;
+    Layout layout;
+  };
+
+  QVector<Candidate> candidates;
+  for (quint32 count : threadCounts(logicalCpus, cores)) {
+    for (const Layout& layout : layouts) {
+      // Without SMT siblings there is one processor per core to pin to
+      if (!layout.skipSmt || count <= cores) {
+        candidates.append(Candidate{count, layout});
+      }
+    }
+  }
+
+  // the fastest of these is tried again hashing several nonces at once, the
+  // miner only does that for blocks before version 5
+  QVector<quint32> ways;
+  for (quint32 count = 2; _interleaved && count <= InterleavedHash::maxWays(); count *= 2) {
+    ways.append(count);
+  }
+
+  const int total = candidates.size() + ways.size();
+  LoggerAdapter::instance().log(QString("Mining benchmark: %1, %2 setting(s), %3 ms each").
+    arg(topology.describe()).arg(total).arg(_runTime).toStdString());
+  for (int i = 0; i < candidates.size() && !m_cancelled; ++i) {
+    const Candidate& candidate = candidates[i];
+    if (!measure(candidate.threads, candidate.layout.pinned, candidate.layout.skipSmt, 1, _runTime)) {
+      break;
+    }
+
+    Q_EMIT benchmarkProgressSignal(i + 1, total, describe(m_results.last()));
+  }
+
+  int fastest = -1;
+  for (int i = 0; i < m_results.size(); ++i) {
+    if (fastest < 0 || m_results[i].hashRate > m_results[fastest].hashRate) {
+      fastest = i;
+    }
+  }
+
+  for (int i = 0; i < ways.size() && fastest >= 0 && !m_cancelled; ++i) {
+    const MiningBenchmarkResult scalar = m_results[fastest];
+    if (!measure(scalar.threads, scalar.pinned, scalar.skipSmt, ways[i], _runTime)) {
+      break;
+    }
+
+    const MiningBenchmarkResult& result = m_results.last();
+    LoggerAdapter::instance().log(QString("Mining benchmark: %1 nonces at once %2 the library hash, %3 against %4 H/s").
+      arg(ways[i]).arg(result.hashRate > scalar.hashRate ? "beat" : "did not beat").
+      arg(result.hashRate, 0, 'f', 1).arg(scalar.hashRate, 0, 'f', 1).toStdString());
+    Q_EMIT benchmarkProgressSignal(candidates.size() + i + 1, total, describe(result));
+  }
+
+  Q_EMIT benchmarkFinishedSignal(!m_cancelled);
+  m_thread.quit();
+}
+
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+
+#include <atomic>
+
+namespace WalletGui {
+
+struct MiningBenchmarkResult {
+  quint32 threads;
+  bool pinned;
+  bool skipSmt;
+  quint32 ways;  // nonces hashed together per thread, see InterleavedHash
+  double hashRate;
+  double hashesPerJoule; // H/s per watt, 0 where the package energy cannot be read
+};
+
+// Runs Miner::benchmark at a range of thread counts, unpinned and pinned with
+// and without SMT siblings where the topology is known, then, if the blocks to
+// mine are hashed by the miner itself (before version 5), the fastest of those
+// with interleaved hashing, and picks the fastest setting. Must not run while
+// mining, both compete for the cores.
+class MiningBenchmark : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(MiningBenchmark)
+
+public:
+  MiningBenchmark();
+  ~MiningBenchmark();
+
+  void start(bool _interleaved, quint32 _runTime = DEFAULT_RUN_TIME);
+  void cancel();
+  bool isRunning() const;
+
+  // Written by the benchmark thread, valid once benchmarkFinishedSignal arrived
+  const QVector<MiningBenchmarkResult>& results() const;
+  int bestIndex() const;
+  // Stores the best setting, GUI thread only
+  bool applyBest() const;
+
+  static QString describe(const MiningBenchmarkResult& _result);
+
+  static const quint32 DEFAULT_RUN_TIME = 3000;
+
+private:
+  QThread m_thread;
+  std::atomic<bool> m_cancelled;
+  QVector<MiningBenchmarkResult> m_results;
+
+  // Appends one result, false once cancelled
+  bool measure(quint32 _threads, bool _pinned, bool _skipSmt, quint32 _ways, quint32 _runTime);
+  Q_INVOKABLE void run(bool _interleaved, quint32 _runTime);
+
+Q_SIGNALS:
+  void benchmarkProgressSignal(int _current, int _total, const QString& _message);
+  void benchmarkFinishedSignal(bool _completed);
+};
+
+}
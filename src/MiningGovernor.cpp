@@ -0,0 +1,295 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QTime>
+#include <QTimerEvent>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <ApplicationServices/ApplicationServices.h>
+#endif
+
+#include "MiningGovernor.h"
+#include "CpuTopology.h"
+#include "LoggerAdapter.h"
+#include "Miner.h"
+#include "Settings.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int GOVERNOR_TIMER_INTERVAL = 5000;
+// Input within this many seconds means somebody is at the computer
+const quint64 USER_IDLE_TIME = 120;
+// A block or two behind is the usual refresh on a new block, not a synchronization
+const quint64 SYNC_LAG = 10;
+
+// Busy and total processor time of the whole system so far, in the platform's units
+bool readSystemTimes(quint64& _busy, quint64& _total) {
+#if defined(Q_OS_LINUX)
+  QFile file("/proc/stat");
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  // cpu user nice system idle iowait irq softirq steal ...
+  QStringList fields = QString(file.readLine()).simplified().split(' ');
+  if (fields.size() < 9 || fields[0] != "cpu") {
+    return false;
+  }
+
+  quint64 idle = fields[4].toULongLong() + fields[5].toULongLong();
+  _busy = fields[1].toULongLong() + fields[2].toULongLong() + fields[3].toULongLong() + fields[6].toULongLong() +
+    fields[7].toULongLong() + fields[8].toULongLong();
+  _total = _busy + idle;
+  return true;
+#elif defined(Q_OS_WIN)
+  FILETIME idleTime, kernelTime, userTime;
+  if (!GetSystemTimes(&idleTime, &kernelTime, &userTime)) {
+    return false;
+  }
+
+  auto toUInt64 = [](const FILETIME& _time) { return (static_cast<quint64>(_time.dwHighDateTime) << 32) | _time.dwLowDateTime; };
+  // kernel time includes the idle time
+  _total = toUInt64(kernelTime) + toUInt64(userTime);
+  _busy = _total - toUInt64(idleTime);
+  return true;
+#else
+  Q_UNUSED(_busy);
+  Q_UNUSED(_total);
+  return false;
+#endif
+}
+
+}
+
+MiningGovernor::MiningGovernor(Miner* _miner, QObject* _parent) : QObject(_parent), m_miner(_miner), m_governorTimerId(-1),
+  m_enabled(Settings::instance().isMiningGovernorEnabled()), m_isSynchronizing(false), m_maxThreads(0), m_activeThreads(0),
+  m_limit(LIMIT_NONE), m_minedThreadMs(0), m_configuredThreadMs(0), m_lastSystemBusy(0), m_lastSystemTotal(0), m_foreignLoad(0) {
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationProgressUpdatedSignal, this, &MiningGovernor::synchronizationProgressUpdated, Qt::QueuedConnection);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationCompletedSignal, this, &MiningGovernor::synchronizationCompleted, Qt::QueuedConnection);
+}
+
+MiningGovernor::~MiningGovernor() {
+}
+
+void MiningGovernor::start(quint32 _maxThreads) {
+  // the miner starts with the whole pool active
+  m_maxThreads = _maxThreads;
+  m_activeThreads = _maxThreads;
+  m_limit = LIMIT_NONE;
+  m_minedThreadMs = 0;
+  m_configuredThreadMs = 0;
+  m_foreignLoad = 0;
+  if (!readSystemTimes(m_lastSystemBusy, m_lastSystemTotal)) {
+    m_lastSystemBusy = 0;
+    m_lastSystemTotal = 0;
+  }
+
+  m_sinceUpdate.start();
+  if (m_governorTimerId == -1) {
+    m_governorTimerId = startTimer(GOVERNOR_TIMER_INTERVAL);
+  }
+
+  update();
+}
+
+void MiningGovernor::stop() {
+  if (m_governorTimerId == -1) {
+    return;
+  }
+
+  account();
+  killTimer(m_governorTimerId);
+  m_governorTimerId = -1;
+  LoggerAdapter::instance().log(QString("Mining duty cycle %1%, %2 of %3 thread-s mined").arg(dutyCycle() * 100, 0, 'f', 1).
+    arg(m_minedThreadMs / 1000).arg(m_configuredThreadMs / 1000).toStdString());
+}
+
+void MiningGovernor::setMaxThreads(quint32 _maxThreads) {
+  if (m_governorTimerId == -1) {
+    return;
+  }
+
+  // resizing the pool activates all of it again
+  account();
+  m_maxThreads = _maxThreads;
+  m_activeThreads = _maxThreads;
+  update();
+}
+
+void MiningGovernor::setEnabled(bool _enabled) {
+  m_enabled = _enabled;
+  Settings::instance().setMiningGovernorEnabled(_enabled);
+  if (m_governorTimerId != -1) {
+    update();
+  }
+}
+
+quint32 MiningGovernor::activeThreads() const {
+  return m_activeThreads;
+}
+
+QString MiningGovernor::reason() const {
+  switch (m_limit) {
+  case LIMIT_SYNCHRONIZATION:
+    return tr("wallet is synchronizing");
+  case LIMIT_SCHEDULE:
+    return tr("outside the mining schedule");
+  case LIMIT_USER_ACTIVE:
+    return tr("computer is in use");
+  case LIMIT_SYSTEM_LOAD:
+    return tr("other programs use %1 core(s)").arg(m_foreignLoad, 0, 'f', 1);
+  default:
+    return QString();
+  }
+}
+
+double MiningGovernor::dutyCycle() const {
+  return m_configuredThreadMs > 0 ? static_cast<double>(m_minedThreadMs) / m_configuredThreadMs : 0;
+}
+
+quint64 MiningGovernor::userIdleTime() {
+#if defined(Q_OS_WIN)
+  LASTINPUTINFO info;
+  info.cbSize = sizeof(info);
+  if (!GetLastInputInfo(&info)) {
+    return 0;
+  }
+
+  return (GetTickCount() - info.dwTime) / 1000;
+#elif defined(Q_OS_MAC)
+  // any input event of any application in the login session
+  return static_cast<quint64>(CGEventSourceSecondsSinceLastEventType(kCGEventSourceStateCombinedSessionState, kCGAnyInputEventType));
+#else
+  // input to other programs cannot be seen, somebody may be at the computer
+  return 0;
+#endif
+}
+
+void MiningGovernor::timerEvent(QTimerEvent* _event) {
+  if (_event->timerId() == m_governorTimerId) {
+    update();
+    return;
+  }
+
+  QObject::timerEvent(_event);
+}
+
+void MiningGovernor::update() {
+  if (m_governorTimerId == -1) {
+    return;
+  }
+
+  account();
+  Limit limit = LIMIT_NONE;
+  quint32 target = targetThreads(limit);
+  // also after a resize, which activates the whole pool again
+  m_miner->set_active_threads(target);
+  if (target == m_activeThreads && limit == m_limit) {
+    return;
+  }
+
+  m_activeThreads = target;
+  m_limit = limit;
+  Q_EMIT activeThreadsChangedSignal(m_activeThreads, m_maxThreads, reason());
+}
+
+void MiningGovernor::account() {
+  const qint64 elapsed = m_sinceUpdate.restart();
+  m_minedThreadMs += m_miner->get_active_threads() * elapsed;
+  m_configuredThreadMs += m_maxThreads * elapsed;
+
+  // the miner's own threads run flat out, the rest of the busy time is somebody else's
+  quint64 busy = 0;
+  quint64 total = 0;
+  if (readSystemTimes(busy, total) && m_lastSystemTotal != 0 && total > m_lastSystemTotal) {
+    const double usedCores = static_cast<double>(busy - m_lastSystemBusy) / (total - m_lastSystemTotal) * CpuTopology::instance().cpus().size();
+    m_foreignLoad = std::max(usedCores - m_miner->get_active_threads(), 0.0);
+    m_lastSystemBusy = busy;
+    m_lastSystemTotal = total;
+  }
+}
+
+quint32 MiningGovernor::targetThreads(Limit& _limit) {
+  _limit = LIMIT_NONE;
+  if (!m_enabled) {
+    return m_maxThreads;
+  }
+
+  if (m_isSynchronizing) {
+    _limit = LIMIT_SYNCHRONIZATION;
+    return 0;
+  }
+
+  if (!isInSchedule()) {
+    _limit = LIMIT_SCHEDULE;
+    return 0;
+  }
+
+  quint32 target = m_maxThreads;
+  if (userIdleTime() < USER_IDLE_TIME && target > 1) {
+    target /= 2;
+    _limit = LIMIT_USER_ACTIVE;
+  }
+
+  const int cpuCount = CpuTopology::instance().cpus().size();
+  const int freeCores = std::max(cpuCount - static_cast<int>(std::ceil(m_foreignLoad - 0.25)), 0);
+  if (static_cast<int>(target) > freeCores) {
+    target = freeCores;
+    _limit = LIMIT_SYSTEM_LOAD;
+  }
+
+  // give back cores one at a time, the load of the last interval lags behind
+  if (target > m_activeThreads + 1 && m_limit == LIMIT_SYSTEM_LOAD) {
+    target = m_activeThreads + 1;
+    _limit = LIMIT_SYSTEM_LOAD;
+  }
+
+  return target;
+}
+
+bool MiningGovernor::isInSchedule() const {
+  if (!Settings::instance().isMiningScheduleEnabled()) {
+    return true;
+  }
+
+  QTime startTime = Settings::instance().getMiningStartTime();
+  QTime stopTime = Settings::instance().getMiningStopTime();
+  QTime currentTime = QTime::currentTime();
+  if (startTime == stopTime) {
+    return true;
+  } else if (stopTime > startTime) {
+    return currentTime >= startTime && currentTime < stopTime;
+  }
+
+  // the window spans midnight
+  return currentTime >= startTime || currentTime < stopTime;
+}
+
+void MiningGovernor::synchronizationProgressUpdated(quint64 _current, quint64 _total) {
+  const bool isSynchronizing = _total > _current + SYNC_LAG;
+  if (isSynchronizing != m_isSynchronizing) {
+    m_isSynchronizing = isSynchronizing;
+    update();
+  }
+}
+
+void MiningGovernor::synchronizationCompleted() {
+  if (m_isSynchronizing) {
+    m_isSynchronizing = false;
+    update();
+  }
+}
+
+}
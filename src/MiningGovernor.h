@@ -0,0 +1,80 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+
+namespace WalletGui {
+
+class Miner;
+
+// Keeps background mining out of the user's way. Every few seconds it decides
+// how many workers of the running pool may hash: none while the wallet
+// synchronizes or outside the mining schedule, half while the user is at the
+// computer and no more than the cores other programs leave idle. Workers above
+// that park in the pool, nothing is restarted. The duty cycle is the share of
+// the configured thread time that was actually mined.
+class MiningGovernor : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(MiningGovernor)
+
+public:
+  MiningGovernor(Miner* _miner, QObject* _parent);
+  ~MiningGovernor();
+
+  void start(quint32 _maxThreads);
+  void stop();
+  void setMaxThreads(quint32 _maxThreads);
+  void setEnabled(bool _enabled);
+
+  quint32 activeThreads() const;
+  QString reason() const;
+  double dutyCycle() const;
+
+  // Seconds since the last keyboard or mouse input, system wide; 0 where the
+  // platform does not tell, the user then counts as active
+  static quint64 userIdleTime();
+
+protected:
+  void timerEvent(QTimerEvent* _event) Q_DECL_OVERRIDE;
+
+private:
+  enum Limit {
+    LIMIT_NONE,
+    LIMIT_SYNCHRONIZATION,
+    LIMIT_SCHEDULE,
+    LIMIT_USER_ACTIVE,
+    LIMIT_SYSTEM_LOAD
+  };
+
+  Miner* m_miner;
+  int m_governorTimerId;
+  bool m_enabled;
+  bool m_isSynchronizing;
+  quint32 m_maxThreads;
+  quint32 m_activeThreads;
+  Limit m_limit;
+  QElapsedTimer m_sinceUpdate;
+  quint64 m_minedThreadMs;
+  quint64 m_configuredThreadMs;
+  quint64 m_lastSystemBusy;
+  quint64 m_lastSystemTotal;
+  // cores busy with anything but mining over the last interval
+  double m_foreignLoad;
+
+  void update();
+  void account();
+  quint32 targetThreads(Limit& _limit);
+  bool isInSchedule() const;
+
+  Q_SLOT void synchronizationProgressUpdated(quint64 _current, quint64 _total);
+  Q_SLOT void synchronizationCompleted();
+
+Q_SIGNALS:
+  void activeThreadsChangedSignal(quint32 _activeThreads, quint32 _maxThreads, const QString& _reason);
+};
+
+}
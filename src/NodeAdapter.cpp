@@ -9,14 +9,24 @@
 #include <QTimer>
 #include <QUrl>
 
+#include <memory>
+
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
 #include "CryptoNoteCore/CoreConfig.h"
+#include "BlockchainExplorerData.h"
+#include "BootstrapExporter.h"
+#include "BootstrapImporter.h"
 #include "CurrencyAdapter.h"
+#include "DnsCheckpoints.h"
 #include "LoggerAdapter.h"
 #include "NodeAdapter.h"
+#include "NodeEventHub.h"
+#include "NodeProbe.h"
 #include "P2p/NetNodeConfig.h"
+#include "RemoteNodePool.h"
+#include "ReplayNode.h"
 #include "Settings.h"
 #include "Wallet/WalletErrors.h"
 
@@ -24,6 +34,18 @@ namespace WalletGui {
 
 namespace {
 
+const char LOCAL_NODE_HOST[] = "127.0.0.1";
+const char BLOCK_HEADER_CACHE_FILE[] = "headers.cache";
+const int DNS_CHECKPOINTS_TIMEOUT = 5000;
+const int REMOTE_NODE_PROBE_GRACE = 300;
+const int MIN_NODE_INIT_TIMEOUT = 1000;
+const int MAX_NODE_INIT_TIMEOUT = 3000;
+// Builtin node states of the auto mode race, failures are the error codes
+const int AUTO_NODE_PENDING = -1;
+const int AUTO_NODE_READY = 0;
+// Heights asked for in one backfill request
+const quint32 HEADER_BACKFILL_BATCH = 100;
+
 std::vector<std::string> convertStringListToVector(const QStringList& list) {
   std::vector<std::string> result;
   Q_FOREACH (const QString& item, list) {
@@ -87,16 +109,26 @@ NodeAdapter& NodeAdapter::instance() {
   return inst;
 }
 
-NodeAdapter::NodeAdapter() : QObject(), m_node(nullptr), m_nodeInitializerThread(), m_nodeInitializer(new InProcessNodeInitializer) {
+NodeAdapter::NodeAdapter() : QObject(), m_node(nullptr), m_inProcessNode(nullptr), m_remoteNodePool(nullptr), m_replayNodeServer(nullptr), m_dnsCheckpoints(nullptr), m_inProcessNodeReady(false), m_hybridSwitched(false), m_autoNodeInitResult(AUTO_NODE_PENDING), m_autoLocalDaemonChosen(false), m_eventHub(new NodeEventHub(this)), m_bootstrapImporter(nullptr), m_bootstrapExporter(nullptr), m_headerBackfillPending(false), m_headerRequestPending(false), m_nextHeaderRequest(-1), m_nodeInitializerThread(), m_nodeInitializer(new InProcessNodeInitializer) {
   m_nodeInitializer->moveToThread(&m_nodeInitializerThread);
 
   qRegisterMetaType<CryptoNote::CoreConfig>("CryptoNote::CoreConfig");
   qRegisterMetaType<CryptoNote::NetNodeConfig>("CryptoNote::NetNodeConfig");
   qRegisterMetaType<CryptoNote::RpcServerConfig>("CryptoNote::RpcServerConfig");
+  qRegisterMetaType<NodeCounters>("WalletGui::NodeCounters");
+  qRegisterMetaType<QVector<CryptoNote::BlockHeaderInfo>>("QVector<CryptoNote::BlockHeaderInfo>");
 
   connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitCompletedSignal, this, &NodeAdapter::nodeInitCompletedSignal, Qt::QueuedConnection);
   connect(this, &NodeAdapter::initNodeSignal, m_nodeInitializer, &InProcessNodeInitializer::start, Qt::QueuedConnection);
   connect(this, &NodeAdapter::deinitNodeSignal, m_nodeInitializer, &InProcessNodeInitializer::stop, Qt::QueuedConnection);
+  connect(this, &NodeAdapter::localBlockchainUpdatedSignal, this, &NodeAdapter::cacheLastLocalBlockHeader, Qt::QueuedConnection);
+  connect(this, &NodeAdapter::blockHeadersFetchedSignal, this, &NodeAdapter::blockHeadersFetched, Qt::QueuedConnection);
+
+  // Node callbacks reach the GUI merged and rate limited through the event hub
+  connect(m_eventHub, &NodeEventHub::localBlockchainUpdatedSignal, this, &NodeAdapter::localBlockchainUpdatedSignal);
+  connect(m_eventHub, &NodeEventHub::lastKnownBlockHeightUpdatedSignal, this, &NodeAdapter::lastKnownBlockHeightUpdatedSignal);
+  connect(m_eventHub, &NodeEventHub::peerCountUpdatedSignal, this, &NodeAdapter::peerCountUpdatedSignal);
+  connect(m_eventHub, &NodeEventHub::poolChangedSignal, this, &NodeAdapter::poolChangedSignal);
 }
 
 NodeAdapter::~NodeAdapter() {
@@ -126,6 +158,48 @@ CryptoNote::IWalletLegacy* NodeAdapter::createWallet() const {
   return m_node->createWallet();
 }
 
+bool NodeAdapter::importBootstrap(const QString& _file) {
+  if (m_inProcessNode == nullptr || !m_inProcessNodeReady || (m_bootstrapImporter != nullptr && m_bootstrapImporter->isRunning())) {
+    return false;
+  }
+
+  if (m_bootstrapImporter == nullptr) {
+    m_bootstrapImporter = new BootstrapImporter(m_inProcessNode);
+    connect(m_bootstrapImporter, &BootstrapImporter::importProgressSignal, this, &NodeAdapter::bootstrapImportProgressSignal, Qt::QueuedConnection);
+    connect(m_bootstrapImporter, &BootstrapImporter::importFinishedSignal, this, &NodeAdapter::bootstrapImportFinishedSignal, Qt::QueuedConnection);
+  }
+
+  m_bootstrapImporter->start(_file);
+  return true;
+}
+
+bool NodeAdapter::isBootstrapImportRunning() const {
+  return m_bootstrapImporter != nullptr && m_bootstrapImporter->isRunning();
+}
+
+bool NodeAdapter::exportBootstrap(const QString& _file) {
+  if (m_inProcessNode == nullptr || !m_inProcessNodeReady || isBootstrapExportRunning()) {
+    return false;
+  }
+
+  if (m_bootstrapExporter == nullptr) {
+    m_bootstrapExporter = new BootstrapExporter(m_inProcessNode);
+    connect(m_bootstrapExporter, &BootstrapExporter::exportProgressSignal, this, &NodeAdapter::bootstrapExportProgressSignal, Qt::QueuedConnection);
+    connect(m_bootstrapExporter, &BootstrapExporter::exportFinishedSignal, this, &NodeAdapter::bootstrapExportFinishedSignal, Qt::QueuedConnection);
+  }
+
+  m_bootstrapExporter->start(_file);
+  return true;
+}
+
+bool NodeAdapter::isBootstrapExportRunning() const {
+  return m_bootstrapExporter != nullptr && m_bootstrapExporter->isRunning();
+}
+
+NodeEventStats NodeAdapter::getNodeEventStats() const {
+  return m_eventHub->stats();
+}
+
 NodeType NodeAdapter::getNodeType() const {
   return m_node == nullptr ? NodeType::UNKNOWN : m_node->getNodeType();
 }
@@ -135,6 +209,13 @@ bool NodeAdapter::init() {
 
   QString connection = Settings::instance().getConnection();
 
+  // A recorded node session replaces the network for offline sync tests and benchmarks
+  const QString replayFile = Settings::instance().getReplayNodeFile();
+  if (!replayFile.isEmpty()) {
+    LoggerAdapter::instance().log("Initializing with replayed node session...");
+    return initReplayNode(replayFile);
+  }
+
   if(connection.compare("embedded") == 0) {
 
     LoggerAdapter::instance().log("Initializing embedded node...");
@@ -144,74 +225,106 @@ bool NodeAdapter::init() {
   } else if(connection.compare("local") == 0) {
 
     LoggerAdapter::instance().log("Initializing with local node...");
-    QUrl localNodeUrl = QUrl::fromUserInput(QString("127.0.0.1:%1").arg(Settings::instance().getCurrentLocalDaemonPort()));
-    m_node = createRpcNode(CurrencyAdapter::instance().getCurrency(), *this, LoggerAdapter::instance().getLoggerManager(), localNodeUrl.host().toStdString(), localNodeUrl.port(), false);
-    QTimer initTimer;
-    initTimer.setInterval(3000);
-    initTimer.setSingleShot(true);
-    initTimer.start();
-    m_node->init([this](std::error_code _err) {
-      Q_UNUSED(_err);
-    });
-    QEventLoop waitLoop;
-    connect(&initTimer, &QTimer::timeout, &waitLoop, &QEventLoop::quit);
-    connect(this, &NodeAdapter::peerCountUpdatedSignal, &waitLoop, &QEventLoop::quit);
-    connect(this, &NodeAdapter::localBlockchainUpdatedSignal, &waitLoop, &QEventLoop::quit);
-    waitLoop.exec();
-    if (initTimer.isActive()) {
-      initTimer.stop();
-      Q_EMIT nodeInitCompletedSignal();
-      return true;
+    const NodeSetting localNode = {LOCAL_NODE_HOST, Settings::instance().getCurrentLocalDaemonPort(), "/", false};
+    NodeProbe probe;
+    probe.start(QVector<NodeSetting>() << localNode);
+    probe.wait(0);
+    const bool responding = probe.results().first().ok;
+    if (!responding) {
+      LoggerAdapter::instance().log("Local node is not responding yet");
     }
 
+    // A node that did not answer the probe would only run out the init timeout as well
+    initRpcNode(localNode, 0, responding);
+
   } else if(connection.compare("remote") == 0) {
 
     LoggerAdapter::instance().log("Initializing with remote node...");
-    const NodeSetting nodeSetting = Settings::instance().getCurrentRemoteNode();
-    m_node = createRpcNode(CurrencyAdapter::instance().getCurrency(), *this, LoggerAdapter::instance().getLoggerManager(), nodeSetting.host.toStdString(), nodeSetting.port, nodeSetting.ssl);
-    QTimer initTimer;
-    initTimer.setInterval(3000);
-    initTimer.setSingleShot(true);
-    initTimer.start();
-    m_node->init([this](std::error_code _err) {
-      Q_UNUSED(_err);
-    });
-    QEventLoop waitLoop;
-    connect(&initTimer, &QTimer::timeout, &waitLoop, &QEventLoop::quit);
-    connect(this, &NodeAdapter::peerCountUpdatedSignal, &waitLoop, &QEventLoop::quit);
-    connect(this, &NodeAdapter::localBlockchainUpdatedSignal, &waitLoop, &QEventLoop::quit);
-    waitLoop.exec();
-    if (initTimer.isActive()) {
-      initTimer.stop();
-      Q_EMIT nodeInitCompletedSignal();
-      return true;
-    }
+    initRemoteNode();
+
+  } else if(connection.compare("hybrid") == 0) {
+
+    // The wallet starts on remote nodes right away, the builtin node syncs in
+    // the background and takes over in the node pool once it caught up
+    LoggerAdapter::instance().log("Initializing with remote node, builtin node syncing in background...");
+    initRemoteNode();
+    connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitCompletedSignal, this, &NodeAdapter::hybridNodeInitCompleted, Qt::UniqueConnection);
+    connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitFailedSignal, this, &NodeAdapter::hybridNodeInitFailed, Qt::UniqueConnection);
+    startInProcessNode();
 
   } else {
 
     LoggerAdapter::instance().log("Trying to connect to local daemon...");
-    QUrl localNodeUrl = QUrl::fromUserInput(QString("127.0.0.1:%1").arg(CryptoNote::RPC_DEFAULT_PORT));
-    m_node = createRpcNode(CurrencyAdapter::instance().getCurrency(), *this, LoggerAdapter::instance().getLoggerManager(), localNodeUrl.host().toStdString(), localNodeUrl.port(), false);
-    QTimer initTimer;
-    initTimer.setInterval(3000);
-    initTimer.setSingleShot(true);
-    initTimer.start();
-    m_node->init([this](std::error_code _err) {
-      Q_UNUSED(_err);
-    });
-    QEventLoop waitLoop;
-    connect(&initTimer, &QTimer::timeout, &waitLoop, &QEventLoop::quit);
-    connect(this, &NodeAdapter::peerCountUpdatedSignal, &waitLoop, &QEventLoop::quit);
-    connect(this, &NodeAdapter::localBlockchainUpdatedSignal, &waitLoop, &QEventLoop::quit);
-    waitLoop.exec();
-    if (initTimer.isActive()) {
-      initTimer.stop();
-      Q_EMIT nodeInitCompletedSignal();
+    const NodeSetting localNode = {LOCAL_NODE_HOST, static_cast<quint16>(CryptoNote::RPC_DEFAULT_PORT), "/", false};
+    NodeProbe probe;
+    probe.start(QVector<NodeSetting>() << localNode);
+
+    // If the builtin node was used last time it most likely is needed again, so it is
+    // started right away and raced against the probe, whichever is up first is used.
+    // It fails on its own if a local daemon holds the ports and is not started again.
+    const bool builtinStarted = Settings::instance().isLastAutoConnectionEmbedded();
+    if (builtinStarted) {
+      LoggerAdapter::instance().log("Launching builtin node while probing local daemon...");
+      m_autoNodeInitResult = AUTO_NODE_PENDING;
+      connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitCompletedSignal, this, &NodeAdapter::autoNodeInitCompleted, Qt::UniqueConnection);
+      connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitFailedSignal, this, &NodeAdapter::autoNodeInitFailed, Qt::UniqueConnection);
+      startInProcessNode();
+
+      QEventLoop raceLoop;
+      connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitCompletedSignal, &raceLoop, &QEventLoop::quit);
+      connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitFailedSignal, &raceLoop, &QEventLoop::quit);
+      connect(&probe, &NodeProbe::probeFinishedSignal, &raceLoop, &QEventLoop::quit);
+      while (m_autoNodeInitResult == AUTO_NODE_PENDING && !(probe.isFinished() && probe.results().first().ok)) {
+        raceLoop.exec();
+      }
+
+      if (m_autoNodeInitResult == AUTO_NODE_READY) {
+        probe.abort();
+        return inProcessNodeStarted();
+      }
+
+      if (m_autoNodeInitResult != AUTO_NODE_PENDING) {
+        LoggerAdapter::instance().log("Builtin node failed to start, waiting for local daemon...");
+      }
+    }
+
+    probe.wait(0);
+    if (probe.results().first().ok && initRpcNode(localNode)) {
+      Settings::instance().setLastAutoConnectionEmbedded(false);
+      // A builtin node still starting is stopped once it is up
+      m_autoLocalDaemonChosen = true;
+      if (builtinStarted && m_autoNodeInitResult == AUTO_NODE_READY) {
+        autoNodeInitCompleted();
+      }
+
       return true;
     }
+
     delete m_node;
     m_node = nullptr;
-    LoggerAdapter::instance().log("Attempt connecting to local daemon timed out, launching builtin node...");
+    delete m_remoteNodePool;
+    m_remoteNodePool = nullptr;
+    m_headerCache.close();
+    if (builtinStarted) {
+      // The builtin node already running is the only one left, a failed one is not relaunched
+      QEventLoop waitLoop;
+      connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitCompletedSignal, &waitLoop, &QEventLoop::quit);
+      connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitFailedSignal, &waitLoop, &QEventLoop::quit);
+      while (m_autoNodeInitResult == AUTO_NODE_PENDING) {
+        waitLoop.exec();
+      }
+
+      if (m_autoNodeInitResult == AUTO_NODE_READY) {
+        LoggerAdapter::instance().log("Local daemon is not available, using builtin node");
+        return inProcessNodeStarted();
+      }
+
+      LoggerAdapter::instance().log("Neither the local daemon nor the builtin node is available");
+      return false;
+    }
+
+    LoggerAdapter::instance().log("Local daemon is not available, launching builtin node...");
+    Settings::instance().setLastAutoConnectionEmbedded(true);
     return initInProcessNode();
 
   }
@@ -219,6 +332,187 @@ bool NodeAdapter::init() {
   return true;
 }
 
+bool NodeAdapter::initRemoteNode() {
+  const QVector<NodeSetting> candidates = remoteNodeCandidates();
+  const int preferred = chooseRemoteNode(candidates);
+
+  // RpcNode talks to the pool, which forwards to the best remote node and fails over
+  if (startNodePool(candidates, preferred)) {
+    return initRpcNode({LOCAL_NODE_HOST, m_remoteNodePool->port(), "/", false}, NodeProbe::timeoutFor(candidates[preferred]));
+  }
+
+  LoggerAdapter::instance().log("Failed to start remote node pool, connecting directly");
+  return initRpcNode(candidates[preferred]);
+}
+
+bool NodeAdapter::startNodePool(const QVector<NodeSetting>& _nodes, int _preferred) {
+  m_remoteNodePool = new RemoteNodePool(_nodes, _preferred);
+  connect(m_remoteNodePool, &RemoteNodePool::scoresUpdatedSignal, this, &NodeAdapter::remoteNodeScoresUpdatedSignal, Qt::QueuedConnection);
+  connect(m_remoteNodePool, &RemoteNodePool::activeFeeAddressChangedSignal, this, &NodeAdapter::nodeFeeAddressChangedSignal, Qt::QueuedConnection);
+  const QString recordFile = Settings::instance().getRecordNodeFile();
+  if (!recordFile.isEmpty() && !m_remoteNodePool->recordTo(recordFile)) {
+    LoggerAdapter::instance().log(QString("Failed to open node recording file %1").arg(recordFile).toStdString());
+  }
+
+  if (!m_remoteNodePool->start()) {
+    delete m_remoteNodePool;
+    m_remoteNodePool = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+bool NodeAdapter::initReplayNode(const QString& _file) {
+  m_replayNodeServer = new ReplayNodeServer(Settings::instance().getReplayLatency(), Settings::instance().getReplayThroughput());
+  if (!m_replayNodeServer->load(_file) || !m_replayNodeServer->start()) {
+    LoggerAdapter::instance().log(QString("Failed to replay node session from %1").arg(_file).toStdString());
+    delete m_replayNodeServer;
+    m_replayNodeServer = nullptr;
+    return false;
+  }
+
+  return initRpcNode({LOCAL_NODE_HOST, m_replayNodeServer->port(), "/", false});
+}
+
+void NodeAdapter::hybridNodeInitCompleted() {
+  LoggerAdapter::instance().log("Builtin node started, syncing in background");
+  m_inProcessNodeReady = true;
+  applyDnsCheckpoints();
+  const QString bootstrapFile = Settings::instance().getBootstrapFile();
+  if (!bootstrapFile.isEmpty()) {
+    importBootstrap(bootstrapFile);
+  }
+
+  if (!m_inProcessNode->isRpcServerRunning()) {
+    LoggerAdapter::instance().log("Builtin node rpc server is not running, staying on remote nodes");
+    return;
+  }
+
+  checkHybridSwitch();
+}
+
+void NodeAdapter::hybridNodeInitFailed(int _errorCode) {
+  LoggerAdapter::instance().log(QString("Builtin node failed to start (%1), staying on remote nodes").arg(_errorCode).toStdString());
+  m_nodeInitializerThread.quit();
+  m_nodeInitializerThread.wait();
+  m_inProcessNode = nullptr;
+}
+
+void NodeAdapter::autoNodeInitCompleted() {
+  m_autoNodeInitResult = AUTO_NODE_READY;
+  if (m_autoLocalDaemonChosen && m_inProcessNode != nullptr) {
+    LoggerAdapter::instance().log("Local daemon answered first, stopping builtin node");
+    m_nodeInitializer->stop(&m_inProcessNode);
+  }
+}
+
+void NodeAdapter::autoNodeInitFailed(int _errorCode) {
+  LoggerAdapter::instance().log(QString("Builtin node failed to start (%1)").arg(_errorCode).toStdString());
+  m_autoNodeInitResult = _errorCode > 0 ? _errorCode : static_cast<int>(CryptoNote::error::INTERNAL_WALLET_ERROR);
+  m_nodeInitializerThread.quit();
+  m_nodeInitializerThread.wait();
+  m_inProcessNode = nullptr;
+}
+
+void NodeAdapter::checkHybridSwitch() {
+  if (m_hybridSwitched || !m_inProcessNodeReady || m_remoteNodePool == nullptr || m_node == nullptr || m_inProcessNode == nullptr) {
+    return;
+  }
+
+  // Whatever else listens on the rpc port, e.g. a daemon started before, is never pinned
+  if (!m_inProcessNode->isRpcServerRunning()) {
+    return;
+  }
+
+  const quint64 knownHeight = std::max<quint64>(m_node->getLastKnownBlockHeight(), m_inProcessNode->getLastKnownBlockHeight());
+  if (m_inProcessNode->getLastLocalBlockHeight() + 1 < knownHeight) {
+    return;
+  }
+
+  // The wallet keeps its RpcNode, the pool now forwards to the builtin node's rpc server
+  const QString bindIp = Settings::instance().getRpcBindIp();
+  const QString host = bindIp.isEmpty() || bindIp == "0.0.0.0" ? QString(LOCAL_NODE_HOST) : bindIp;
+  m_remoteNodePool->pinNode({host, Settings::instance().getRpcBindPort(), "/", false});
+  m_hybridSwitched = true;
+  LoggerAdapter::instance().log("Builtin node is synchronized, switched over from remote nodes");
+}
+
+QVector<NodeSetting> NodeAdapter::remoteNodeCandidates() const {
+  const NodeSetting currentNode = Settings::instance().getCurrentRemoteNode();
+  QVector<NodeSetting> candidates;
+  candidates.append(currentNode);
+  for (const NodeSetting& node : Settings::instance().getRpcNodesList()) {
+    if (node.host != currentNode.host || node.port != currentNode.port) {
+      candidates.append(node);
+    }
+  }
+
+  return candidates;
+}
+
+int NodeAdapter::chooseRemoteNode(const QVector<NodeSetting>& _candidates) const {
+  NodeProbe probe;
+  probe.start(_candidates);
+  // the current node is kept whenever it is fine, so its own answer is always awaited
+  probe.wait(REMOTE_NODE_PROBE_GRACE, 0);
+
+  // The selected node is kept unless it is down or lags behind
+  const int best = probe.bestIndex();
+  const NodeProbeResult& current = probe.results().first();
+  if (best < 0 || (current.ok && current.height + 1 >= probe.results()[best].height)) {
+    return 0;
+  }
+
+  const NodeSetting& currentNode = _candidates.first();
+  const NodeSetting& bestNode = _candidates[best];
+  LoggerAdapter::instance().log(QString("Remote node %1:%2 is not available or behind, using %3:%4").
+    arg(currentNode.host).arg(currentNode.port).arg(bestNode.host).arg(bestNode.port).toStdString());
+  return best;
+}
+
+bool NodeAdapter::initRpcNode(const NodeSetting& _node, int _probeTimeout, bool _wait) {
+  if (!m_headerCache.open(Settings::instance().getDataDir().absoluteFilePath(BLOCK_HEADER_CACHE_FILE))) {
+    LoggerAdapter::instance().log("Failed to open block header cache");
+  }
+
+  // Recording takes the traffic from a loopback pool, a node reached directly
+  // (local daemon, auto mode) gets one with just that node behind it
+  NodeSetting node = _node;
+  if (m_remoteNodePool == nullptr && m_replayNodeServer == nullptr && !Settings::instance().getRecordNodeFile().isEmpty()) {
+    if (startNodePool(QVector<NodeSetting>() << _node, 0)) {
+      node = {LOCAL_NODE_HOST, m_remoteNodePool->port(), "/", false};
+    } else {
+      LoggerAdapter::instance().log("Failed to start recording node pool, node traffic is not recorded");
+    }
+  }
+
+  m_node = createRpcNode(CurrencyAdapter::instance().getCurrency(), *this, LoggerAdapter::instance().getLoggerManager(), node.host.toStdString(), node.port, node.ssl);
+  QTimer initTimer;
+  initTimer.setInterval(qBound(MIN_NODE_INIT_TIMEOUT, (_probeTimeout > 0 ? _probeTimeout : NodeProbe::timeoutFor(_node)) * 2, MAX_NODE_INIT_TIMEOUT));
+  initTimer.setSingleShot(true);
+  initTimer.start();
+  m_node->init([this](std::error_code _err) {
+    Q_UNUSED(_err);
+  });
+  if (!_wait) {
+    return false;
+  }
+
+  QEventLoop waitLoop;
+  connect(&initTimer, &QTimer::timeout, &waitLoop, &QEventLoop::quit);
+  connect(this, &NodeAdapter::peerCountUpdatedSignal, &waitLoop, &QEventLoop::quit);
+  connect(this, &NodeAdapter::localBlockchainUpdatedSignal, &waitLoop, &QEventLoop::quit);
+  waitLoop.exec();
+  if (initTimer.isActive()) {
+    initTimer.stop();
+    Q_EMIT nodeInitCompletedSignal();
+    return true;
+  }
+
+  return false;
+}
+
 quint64 NodeAdapter::getLastKnownBlockHeight() const {
   Q_CHECK_PTR(m_node);
   return m_node->getLastKnownBlockHeight();
@@ -231,6 +525,11 @@ quint64 NodeAdapter::getLastLocalBlockHeight() const {
 
 QDateTime NodeAdapter::getLastLocalBlockTimestamp() const {
   Q_CHECK_PTR(m_node);
+  CachedBlockHeader header;
+  if (getCachedLastLocalBlockHeader(header)) {
+    return QDateTime::fromTime_t(header.timestamp, Qt::UTC);
+  }
+
   return QDateTime::fromTime_t(m_node->getLastLocalBlockTimestamp(), Qt::UTC);
 }
 
@@ -296,6 +595,17 @@ quint64 NodeAdapter::getNodeFeeAmount() const {
 
 QString NodeAdapter::getNodeFeeAddress() const {
   Q_CHECK_PTR(m_node);
+  // No node fee is paid in hybrid mode, neither to the remote nodes that
+  // bridge the sync nor to the builtin node once it took over
+  if (Settings::instance().getConnection().compare("hybrid") == 0) {
+    return QString();
+  }
+
+  // the node proxy asked the pool once, the pool knows which node serves now
+  if (m_remoteNodePool != nullptr) {
+    return m_remoteNodePool->activeFeeAddress();
+  }
+
   return QString::fromStdString(m_node->feeAddress());
 }
 
@@ -306,6 +616,11 @@ CryptoNote::BlockHeaderInfo NodeAdapter::getLastLocalBlockHeaderInfo() {
 
 uint8_t NodeAdapter::getCurrentBlockMajorVersion() {
   Q_CHECK_PTR(m_node);
+  CachedBlockHeader header;
+  if (getCachedLastLocalBlockHeader(header)) {
+    return header.majorVersion;
+  }
+
   return m_node->getCurrentBlockMajorVersion();
 }
 
@@ -314,9 +629,30 @@ quint64 NodeAdapter::getAlreadyGeneratedCoins() {
   return m_node->getAlreadyGeneratedCoins();
 }
 
-std::vector<CryptoNote::p2pConnection> NodeAdapter::getConnections() {
+void NodeAdapter::prefetchRandomOuts(const std::vector<uint64_t>& _amounts) {
   Q_CHECK_PTR(m_node);
-  return m_node->getConnections();
+  m_node->prefetchRandomOuts(_amounts);
+}
+
+void NodeAdapter::requestConnections() {
+  Q_CHECK_PTR(m_node);
+  std::shared_ptr<std::vector<CryptoNote::p2pConnection>> connections = std::make_shared<std::vector<CryptoNote::p2pConnection>>();
+  m_node->getConnections(*connections, [this, connections](std::error_code _error) {
+    if (_error) {
+      LoggerAdapter::instance().log("Failed to get connections: " + _error.message());
+      Q_EMIT connectionsRequestFailedSignal();
+      return;
+    }
+
+    Q_EMIT connectionsReceivedSignal(*connections);
+  });
+}
+
+void NodeAdapter::requestCounters() {
+  Q_CHECK_PTR(m_node);
+  m_node->getCounters([this](const NodeCounters& _counters) {
+    Q_EMIT nodeCountersReceivedSignal(_counters);
+  });
 }
 
 bool NodeAdapter::getBlockTemplate(CryptoNote::Block& b, const CryptoNote::AccountKeys& acc, const CryptoNote::BinaryArray& extraNonce, CryptoNote::difficulty_type& difficulty, uint32_t& height) {
@@ -336,18 +672,41 @@ bool NodeAdapter::getBlockLongHash(Crypto::cn_context &context, const CryptoNote
 
 
 void NodeAdapter::peerCountUpdated(Node& _node, size_t _count) {
-  Q_UNUSED(_node);
-  Q_EMIT peerCountUpdatedSignal(_count);
+  // A builtin node still starting up is not the active one yet
+  if (&_node != m_node) {
+    m_eventHub->drop();
+    return;
+  }
+
+  m_eventHub->postPeerCountUpdated(_count);
 }
 
 void NodeAdapter::localBlockchainUpdated(Node& _node, uint64_t _height) {
-  Q_UNUSED(_node);
-  Q_EMIT localBlockchainUpdatedSignal(_height);
+  if (&_node == m_inProcessNode && m_node != m_inProcessNode) {
+    QMetaObject::invokeMethod(this, "checkHybridSwitch", Qt::QueuedConnection);
+    return;
+  }
+
+  if (&_node != m_node) {
+    m_eventHub->drop();
+    return;
+  }
+
+  m_eventHub->postLocalBlockchainUpdated(_height);
 }
 
 void NodeAdapter::lastKnownBlockHeightUpdated(Node& _node, uint64_t _height) {
-  Q_UNUSED(_node);
-  Q_EMIT lastKnownBlockHeightUpdatedSignal(_height);
+  if (&_node == m_inProcessNode && m_node != m_inProcessNode) {
+    QMetaObject::invokeMethod(this, "checkHybridSwitch", Qt::QueuedConnection);
+    return;
+  }
+
+  if (&_node != m_node) {
+    m_eventHub->drop();
+    return;
+  }
+
+  m_eventHub->postLastKnownBlockHeightUpdated(_height);
 }
 
 void NodeAdapter::connectionStatusUpdated(bool _connected) {
@@ -355,42 +714,245 @@ void NodeAdapter::connectionStatusUpdated(bool _connected) {
 }
 
 void NodeAdapter::poolChanged(Node& _node) {
-  Q_EMIT poolChangedSignal();
+  if (&_node != m_node) {
+    m_eventHub->drop();
+    return;
+  }
+
+  m_eventHub->postPoolChanged();
 }
 
 bool NodeAdapter::initInProcessNode() {
-  Q_ASSERT(m_node == nullptr);
+  startInProcessNode();
+  return waitInProcessNode();
+}
+
+void NodeAdapter::startInProcessNode() {
+  Q_ASSERT(m_inProcessNode == nullptr);
   m_nodeInitializerThread.start();
   CryptoNote::CoreConfig coreConfig = makeCoreConfig();
   CryptoNote::NetNodeConfig netNodeConfig = makeNetNodeConfig();
   CryptoNote::RpcServerConfig rpcServerConfig = makeRpcServerConfig();
-  Q_EMIT initNodeSignal(&m_node, &CurrencyAdapter::instance().getCurrency(), this, &LoggerAdapter::instance().getLoggerManager(), coreConfig, netNodeConfig, rpcServerConfig);
+  Q_EMIT initNodeSignal(&m_inProcessNode, &CurrencyAdapter::instance().getCurrency(), this, &LoggerAdapter::instance().getLoggerManager(), coreConfig, netNodeConfig, rpcServerConfig);
+
+  // The node starts with the cached DNS checkpoints, fresh ones replace them when they arrive
+  if (m_dnsCheckpoints == nullptr && !Settings::instance().withoutCheckpoints() && !Settings::instance().isTestnet()) {
+    m_dnsCheckpoints = new DnsCheckpoints(Settings::instance().getDataDir().absoluteFilePath(CHECKPOINTS_CACHE_FILE), this);
+    connect(m_dnsCheckpoints, &DnsCheckpoints::checkpointsLoadedSignal, this, &NodeAdapter::applyDnsCheckpoints);
+    m_dnsCheckpoints->start(DNS_CHECKPOINTS_TIMEOUT);
+  }
+}
+
+void NodeAdapter::applyDnsCheckpoints() {
+  // Until the builtin node is up the checkpoints wait, they are applied once it is ready
+  if (m_dnsCheckpoints == nullptr || m_inProcessNode == nullptr || !m_inProcessNodeReady) {
+    return;
+  }
+
+  m_inProcessNode->setCheckpoints(m_dnsCheckpoints->checkpoints());
+}
+
+bool NodeAdapter::waitInProcessNode() {
   QEventLoop waitLoop;
   connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitCompletedSignal, &waitLoop, &QEventLoop::quit);
   connect(m_nodeInitializer, &InProcessNodeInitializer::nodeInitFailedSignal, &waitLoop, &QEventLoop::exit);
   if (waitLoop.exec() != 0) {
+    // The initializer thread finishes with the failed node before it is forgotten
+    m_nodeInitializerThread.quit();
+    m_nodeInitializerThread.wait();
+    m_inProcessNode = nullptr;
     return false;
   }
 
+  return inProcessNodeStarted();
+}
+
+bool NodeAdapter::inProcessNodeStarted() {
+  m_node = m_inProcessNode;
+  m_inProcessNodeReady = true;
+  applyDnsCheckpoints();
+  if (!Settings::instance().getRecordNodeFile().isEmpty()) {
+    LoggerAdapter::instance().log("The builtin node is called directly, there is no node traffic to record");
+  }
+
+  // A bootstrap file from the command line is imported before the wallet opens,
+  // the splash screen shows the progress from the log
+  const QString bootstrapFile = Settings::instance().getBootstrapFile();
+  if (!bootstrapFile.isEmpty() && importBootstrap(bootstrapFile)) {
+    QEventLoop importLoop;
+    connect(this, &NodeAdapter::bootstrapImportFinishedSignal, &importLoop, &QEventLoop::quit);
+    importLoop.exec();
+  }
+
   Q_EMIT localBlockchainUpdatedSignal(getLastLocalBlockHeight());
   Q_EMIT lastKnownBlockHeightUpdatedSignal(getLastKnownBlockHeight());
   return true;
 }
 
 void NodeAdapter::deinit() {
-  if (m_node != nullptr) {
-    if (m_nodeInitializerThread.isRunning()) {
-      m_nodeInitializer->stop(&m_node);
+  const NodeEventStats eventStats = m_eventHub->stats();
+  LoggerAdapter::instance().log(QString("Node events: %1 posted, %2 deliveries, %3 merged, %4 dropped").
+    arg(eventStats.posted).arg(eventStats.delivered).arg(eventStats.merged).arg(eventStats.dropped).toStdString());
+
+  // The importer and exporter wait on the core, they have to finish before the node stops
+  delete m_bootstrapImporter;
+  m_bootstrapImporter = nullptr;
+  delete m_bootstrapExporter;
+  m_bootstrapExporter = nullptr;
+
+  // In hybrid mode both the rpc node and the builtin node may be running
+  if (m_node != nullptr && m_node != m_inProcessNode) {
+    delete m_node;
+  }
+
+  m_node = nullptr;
+  if (m_nodeInitializerThread.isRunning()) {
+    if (m_inProcessNode != nullptr) {
+      m_nodeInitializer->stop(&m_inProcessNode);
       QEventLoop waitLoop;
       connect(m_nodeInitializer, &InProcessNodeInitializer::nodeDeinitCompletedSignal, &waitLoop, &QEventLoop::quit, Qt::QueuedConnection);
       waitLoop.exec();
-      m_nodeInitializerThread.quit();
-      m_nodeInitializerThread.wait();
-    } else {
-      delete m_node;
-      m_node = nullptr;
     }
+
+    m_nodeInitializerThread.quit();
+    m_nodeInitializerThread.wait();
+  }
+
+  m_inProcessNode = nullptr;
+  m_inProcessNodeReady = false;
+  m_hybridSwitched = false;
+  delete m_remoteNodePool;
+  m_remoteNodePool = nullptr;
+  delete m_replayNodeServer;
+  m_replayNodeServer = nullptr;
+  delete m_dnsCheckpoints;
+  m_dnsCheckpoints = nullptr;
+  m_headerCache.close();
+  // Requests of the old node may never be answered
+  m_headerBackfillPending = false;
+  m_headerRequestPending = false;
+  m_nextHeaderRequest = -1;
+}
+
+QDateTime NodeAdapter::estimateBlockTime(quint32 _height) const {
+  return m_headerCache.estimateBlockTime(_height, CurrencyAdapter::instance().getCurrency().difficultyTarget());
+}
+
+bool NodeAdapter::getCachedLastLocalBlockHeader(CachedBlockHeader& _header) const {
+  quint32 height;
+  return m_headerCache.topHeight(height) && m_headerCache.get(height, _header);
+}
+
+void NodeAdapter::cacheLastLocalBlockHeader() {
+  if (m_node == nullptr || !m_headerCache.isOpen()) {
+    return;
+  }
+
+  const CryptoNote::BlockHeaderInfo header = m_node->getLastLocalBlockHeaderInfo();
+  if (header.timestamp != 0) {
+    m_headerCache.store(header);
+  }
+
+  backfillBlockHeaders();
+}
+
+void NodeAdapter::backfillBlockHeaders() {
+  if (m_node == nullptr || m_headerBackfillPending) {
+    return;
+  }
+
+  // Newest gaps first, they are what confirmations and status need
+  const std::vector<uint32_t> heights = m_headerCache.missingHeights(HEADER_BACKFILL_BATCH);
+  if (!heights.empty()) {
+    m_headerBackfillPending = true;
+    fetchBlockHeaders(heights, true);
+  }
+}
+
+void NodeAdapter::requestBlockHeader(quint32 _height) {
+  CachedBlockHeader header;
+  if (m_node == nullptr || m_headerCache.get(_height, header)) {
+    return;
+  }
+
+  if (m_headerRequestPending) {
+    m_nextHeaderRequest = _height;
+    return;
+  }
+
+  m_headerRequestPending = true;
+  fetchBlockHeaders(std::vector<uint32_t>(1, _height), false);
+}
+
+void NodeAdapter::fetchBlockHeaders(const std::vector<uint32_t>& _heights, bool _backfill) {
+  std::shared_ptr<std::vector<std::vector<CryptoNote::BlockDetails>>> blocks =
+    std::make_shared<std::vector<std::vector<CryptoNote::BlockDetails>>>();
+  m_node->getNode()->getBlocks(_heights, *blocks, [this, blocks, _backfill](std::error_code _error) {
+    QVector<CryptoNote::BlockHeaderInfo> headers;
+    if (!_error) {
+      for (const std::vector<CryptoNote::BlockDetails>& blocksAtHeight : *blocks) {
+        for (const CryptoNote::BlockDetails& block : blocksAtHeight) {
+          if (block.isOrphaned) {
+            continue;
+          }
+
+          CryptoNote::BlockHeaderInfo header;
+          header.index = block.height;
+          header.majorVersion = block.majorVersion;
+          header.minorVersion = block.minorVersion;
+          header.timestamp = block.timestamp;
+          header.hash = block.hash;
+          header.prevHash = block.prevBlockHash;
+          header.nonce = block.nonce;
+          header.isAlternative = false;
+          header.difficulty = block.difficulty;
+          headers.append(header);
+        }
+      }
+    }
+
+    Q_EMIT blockHeadersFetchedSignal(headers, _backfill);
+  });
+}
+
+void NodeAdapter::blockHeadersFetched(const QVector<CryptoNote::BlockHeaderInfo>& _headers, bool _backfill) {
+  bool filled = false;
+  for (const CryptoNote::BlockHeaderInfo& header : _headers) {
+    filled = m_headerCache.fill(header) || filled;
+  }
+
+  if (!_headers.isEmpty()) {
+    Q_EMIT blockHeadersReceivedSignal(_headers);
   }
+
+  if (_backfill) {
+    m_headerBackfillPending = false;
+    // A failed or useless answer waits for the next block instead of looping
+    if (filled) {
+      backfillBlockHeaders();
+    }
+  } else {
+    m_headerRequestPending = false;
+    if (m_nextHeaderRequest >= 0) {
+      const quint32 height = static_cast<quint32>(m_nextHeaderRequest);
+      m_nextHeaderRequest = -1;
+      requestBlockHeader(height);
+    }
+  }
+}
+
+quint64 NodeAdapter::getConfirmationHeight() const {
+  quint64 height = m_node != nullptr ? m_node->getLastKnownBlockHeight() : 0;
+  quint32 cachedHeight;
+  if (m_headerCache.topHeight(cachedHeight) && cachedHeight > height) {
+    height = cachedHeight;
+  }
+
+  return height;
+}
+
+QVector<RemoteNodeScore> NodeAdapter::getRemoteNodeScores() const {
+  return m_remoteNodePool != nullptr ? m_remoteNodePool->scores() : QVector<RemoteNodeScore>();
 }
 
 CryptoNote::CoreConfig NodeAdapter::makeCoreConfig() const {
@@ -488,11 +1050,19 @@ bool NodeAdapter::isOffline() {
   return getConnectionsCount() == 0;
 }
 
+bool NodeAdapter::hasNode() const {
+  return m_node != nullptr;
+}
+
 CryptoNote::INode* NodeAdapter::getNode() {
   Q_CHECK_PTR(m_node);
   return m_node->getNode();
 }
 
+Node* NodeAdapter::getCurrentNode() const {
+  return m_node;
+}
+
 System::Dispatcher &NodeAdapter::getDispatcher() {
   return m_node->getDispatcher();
 }
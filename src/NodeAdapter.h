@@ -10,7 +10,9 @@
 
 #include <INode.h>
 #include <IWalletLegacy.h>
+#include "BlockHeaderCache.h"
 #include "CryptoNoteWrapper.h"
+#include "Settings.h"
 #include "Rpc/RpcServerConfig.h"
 #include "System/Dispatcher.h"
 
@@ -26,7 +28,15 @@ namespace Logging {
 
 namespace WalletGui {
 
+class BootstrapExporter;
+class BootstrapImporter;
+class DnsCheckpoints;
 class InProcessNodeInitializer;
+class NodeEventHub;
+struct NodeEventStats;
+class RemoteNodePool;
+class ReplayNodeServer;
+struct RemoteNodeScore;
 
 class NodeAdapter : public QObject, public INodeCallback {
   Q_OBJECT
@@ -60,13 +70,33 @@ public:
   QString getNodeFeeAddress() const;
   uint8_t getCurrentBlockMajorVersion();
   quint64 getAlreadyGeneratedCoins();
-  std::vector<CryptoNote::p2pConnection> getConnections();
+  void prefetchRandomOuts(const std::vector<uint64_t>& _amounts);
+  void requestConnections();
+  // Answered with nodeCountersReceivedSignal
+  void requestCounters();
   CryptoNote::BlockHeaderInfo getLastLocalBlockHeaderInfo();
   bool getBlockTemplate(CryptoNote::Block& b, const CryptoNote::AccountKeys& acc, const CryptoNote::BinaryArray& extraNonce, CryptoNote::difficulty_type& difficulty, uint32_t& height);
   bool handleBlockFound(CryptoNote::Block& b);
   bool getBlockLongHash(Crypto::cn_context &context, const CryptoNote::Block& block, Crypto::Hash& res);
   NodeType getNodeType() const;
   bool isOffline();
+  bool hasNode() const;
+  // From the block header cache, RPC mode only
+  QDateTime estimateBlockTime(quint32 _height) const;
+  // Asks the node for a header missing from the cache, answered with
+  // blockHeadersReceivedSignal. Only the newest height asked for while a
+  // request is running is sent after it.
+  void requestBlockHeader(quint32 _height);
+  // Top height for confirmations, falls back to the cache while the node has not answered yet
+  quint64 getConfirmationHeight() const;
+  QVector<RemoteNodeScore> getRemoteNodeScores() const;
+  NodeEventStats getNodeEventStats() const;
+  // Imports a block file into the builtin node in the background, false if there is none
+  bool importBootstrap(const QString& _file);
+  bool isBootstrapImportRunning() const;
+  // Writes the builtin node's chain to a block file in the background, false if there is none
+  bool exportBootstrap(const QString& _file);
+  bool isBootstrapExportRunning() const;
 
   void peerCountUpdated(Node& _node, size_t _count) Q_DECL_OVERRIDE;
   void localBlockchainUpdated(Node& _node, uint64_t _height) Q_DECL_OVERRIDE;
@@ -75,10 +105,29 @@ public:
   void poolChanged(Node& _node) Q_DECL_OVERRIDE;
 
   CryptoNote::INode* getNode();
+  // For handing the node to a worker thread, which must not read the adapter
+  // itself. GUI thread only, null while there is no node.
+  Node* getCurrentNode() const;
   System::Dispatcher& getDispatcher();
 
 private:
   Node* m_node;
+  Node* m_inProcessNode;
+  RemoteNodePool* m_remoteNodePool;
+  ReplayNodeServer* m_replayNodeServer;
+  DnsCheckpoints* m_dnsCheckpoints;
+  bool m_inProcessNodeReady;
+  bool m_hybridSwitched;
+  // Auto mode races the builtin node against the local daemon
+  int m_autoNodeInitResult;
+  bool m_autoLocalDaemonChosen;
+  NodeEventHub* m_eventHub;
+  BootstrapImporter* m_bootstrapImporter;
+  BootstrapExporter* m_bootstrapExporter;
+  BlockHeaderCache m_headerCache;
+  bool m_headerBackfillPending;
+  bool m_headerRequestPending;
+  qint64 m_nextHeaderRequest;
   QThread m_nodeInitializerThread;
   InProcessNodeInitializer* m_nodeInitializer;
 
@@ -86,6 +135,28 @@ private:
   ~NodeAdapter();
 
   bool initInProcessNode();
+  void startInProcessNode();
+  bool waitInProcessNode();
+  bool inProcessNodeStarted();
+  void applyDnsCheckpoints();
+  // Waits until the node answers, up to a timeout derived from _probeTimeout,
+  // unless _wait is off for a node already known not to answer yet
+  bool initRpcNode(const NodeSetting& _node, int _probeTimeout = 0, bool _wait = true);
+  bool initRemoteNode();
+  bool startNodePool(const QVector<NodeSetting>& _nodes, int _preferred);
+  bool initReplayNode(const QString& _file);
+  void hybridNodeInitCompleted();
+  void hybridNodeInitFailed(int _errorCode);
+  void autoNodeInitCompleted();
+  void autoNodeInitFailed(int _errorCode);
+  Q_INVOKABLE void checkHybridSwitch();
+  QVector<NodeSetting> remoteNodeCandidates() const;
+  int chooseRemoteNode(const QVector<NodeSetting>& _candidates) const;
+  bool getCachedLastLocalBlockHeader(CachedBlockHeader& _header) const;
+  void cacheLastLocalBlockHeader();
+  void backfillBlockHeaders();
+  void fetchBlockHeaders(const std::vector<uint32_t>& _heights, bool _backfill);
+  void blockHeadersFetched(const QVector<CryptoNote::BlockHeaderInfo>& _headers, bool _backfill);
   CryptoNote::CoreConfig makeCoreConfig() const;
   CryptoNote::NetNodeConfig makeNetNodeConfig() const;
   CryptoNote::RpcServerConfig makeRpcServerConfig() const;
@@ -94,6 +165,8 @@ Q_SIGNALS:
   void localBlockchainUpdatedSignal(quint64 _height);
   void lastKnownBlockHeightUpdatedSignal(quint64 _height);
   void nodeInitCompletedSignal();
+  void blockHeadersReceivedSignal(const QVector<CryptoNote::BlockHeaderInfo>& _headers);
+  void blockHeadersFetchedSignal(const QVector<CryptoNote::BlockHeaderInfo>& _headers, bool _backfill);
   void peerCountUpdatedSignal(quintptr _count);
   void poolChangedSignal();
   void initNodeSignal(WalletGui::Node** _node, const CryptoNote::Currency* currency, INodeCallback* _callback, Logging::LoggerManager* _loggerManager,
@@ -101,6 +174,15 @@ Q_SIGNALS:
   void deinitNodeSignal(WalletGui::Node** _node);
   void connectionFailedSignal();
   void connectionStatusUpdatedSignal(bool _connected);
+  void remoteNodeScoresUpdatedSignal();
+  void nodeFeeAddressChangedSignal();
+  void connectionsReceivedSignal(const std::vector<CryptoNote::p2pConnection>& _connections);
+  void connectionsRequestFailedSignal();
+  void nodeCountersReceivedSignal(const WalletGui::NodeCounters& _counters);
+  void bootstrapImportProgressSignal(quint32 _current, quint32 _total);
+  void bootstrapImportFinishedSignal(bool _ok, const QString& _message);
+  void bootstrapExportProgressSignal(quint32 _current, quint32 _total);
+  void bootstrapExportFinishedSignal(bool _ok, const QString& _message);
 };
 
 }
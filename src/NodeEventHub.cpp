@@ -0,0 +1,117 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "NodeEventHub.h"
+
+namespace WalletGui {
+
+namespace {
+
+// At most ten deliveries per second
+const int MIN_DELIVERY_INTERVAL = 100;
+
+}
+
+NodeEventHub::NodeEventHub(QObject* _parent) : QObject(_parent), m_dirty(0), m_scheduled(false), m_localHeight(0), m_knownHeight(0),
+  m_peerCount(0), m_stats() {
+  m_deliveryTimer.setSingleShot(true);
+  connect(&m_deliveryTimer, &QTimer::timeout, this, &NodeEventHub::deliver);
+}
+
+NodeEventHub::~NodeEventHub() {
+}
+
+void NodeEventHub::postLocalBlockchainUpdated(quint64 _height) {
+  QMutexLocker locker(&m_mutex);
+  m_localHeight = _height;
+  post(LOCAL_HEIGHT);
+}
+
+void NodeEventHub::postLastKnownBlockHeightUpdated(quint64 _height) {
+  QMutexLocker locker(&m_mutex);
+  m_knownHeight = _height;
+  post(KNOWN_HEIGHT);
+}
+
+void NodeEventHub::postPeerCountUpdated(quintptr _count) {
+  QMutexLocker locker(&m_mutex);
+  m_peerCount = _count;
+  post(PEER_COUNT);
+}
+
+void NodeEventHub::postPoolChanged() {
+  QMutexLocker locker(&m_mutex);
+  post(POOL_CHANGED);
+}
+
+void NodeEventHub::drop() {
+  QMutexLocker locker(&m_mutex);
+  ++m_stats.dropped;
+}
+
+NodeEventStats NodeEventHub::stats() const {
+  QMutexLocker locker(&m_mutex);
+  return m_stats;
+}
+
+void NodeEventHub::post(Event _event) {
+  // Called with m_mutex held
+  ++m_stats.posted;
+  if ((m_dirty & _event) != 0) {
+    ++m_stats.merged;
+  }
+
+  m_dirty |= _event;
+  if (!m_scheduled) {
+    m_scheduled = true;
+    QMetaObject::invokeMethod(this, "scheduleDelivery", Qt::QueuedConnection);
+  }
+}
+
+void NodeEventHub::scheduleDelivery() {
+  const qint64 sinceLast = m_lastDelivery.isValid() ? m_lastDelivery.elapsed() : MIN_DELIVERY_INTERVAL;
+  if (sinceLast >= MIN_DELIVERY_INTERVAL) {
+    deliver();
+  } else if (!m_deliveryTimer.isActive()) {
+    m_deliveryTimer.start(MIN_DELIVERY_INTERVAL - sinceLast);
+  }
+}
+
+void NodeEventHub::deliver() {
+  int dirty;
+  quint64 localHeight;
+  quint64 knownHeight;
+  quintptr peerCount;
+  {
+    QMutexLocker locker(&m_mutex);
+    dirty = m_dirty;
+    localHeight = m_localHeight;
+    knownHeight = m_knownHeight;
+    peerCount = m_peerCount;
+    m_dirty = 0;
+    m_scheduled = false;
+    if (dirty != 0) {
+      ++m_stats.delivered;
+    }
+  }
+
+  m_lastDelivery.start();
+  if ((dirty & KNOWN_HEIGHT) != 0) {
+    Q_EMIT lastKnownBlockHeightUpdatedSignal(knownHeight);
+  }
+
+  if ((dirty & LOCAL_HEIGHT) != 0) {
+    Q_EMIT localBlockchainUpdatedSignal(localHeight);
+  }
+
+  if ((dirty & PEER_COUNT) != 0) {
+    Q_EMIT peerCountUpdatedSignal(peerCount);
+  }
+
+  if ((dirty & POOL_CHANGED) != 0) {
+    Q_EMIT poolChangedSignal();
+  }
+}
+
+}
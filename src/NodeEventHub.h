@@ -0,0 +1,70 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+
+namespace WalletGui {
+
+struct NodeEventStats {
+  quint64 posted;
+  quint64 delivered;
+  quint64 merged;
+  quint64 dropped;
+};
+
+// Collects node callbacks from any thread and hands them to the GUI thread at a
+// bounded rate. Heights and peer count are merged into their latest value, pool
+// changes into a dirty flag, so a burst of callbacks becomes one delivery.
+class NodeEventHub : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(NodeEventHub)
+
+public:
+  explicit NodeEventHub(QObject* _parent);
+  ~NodeEventHub();
+
+  void postLocalBlockchainUpdated(quint64 _height);
+  void postLastKnownBlockHeightUpdated(quint64 _height);
+  void postPeerCountUpdated(quintptr _count);
+  void postPoolChanged();
+  // Counts an event that is not delivered at all, e.g. from an inactive node
+  void drop();
+
+  NodeEventStats stats() const;
+
+private:
+  enum Event {
+    LOCAL_HEIGHT = 1 << 0,
+    KNOWN_HEIGHT = 1 << 1,
+    PEER_COUNT = 1 << 2,
+    POOL_CHANGED = 1 << 3
+  };
+
+  mutable QMutex m_mutex;
+  int m_dirty;
+  bool m_scheduled;
+  quint64 m_localHeight;
+  quint64 m_knownHeight;
+  quintptr m_peerCount;
+  NodeEventStats m_stats;
+  QElapsedTimer m_lastDelivery;
+  QTimer m_deliveryTimer;
+
+  void post(Event _event);
+  Q_INVOKABLE void scheduleDelivery();
+  void deliver();
+
+Q_SIGNALS:
+  void localBlockchainUpdatedSignal(quint64 _height);
+  void lastKnownBlockHeightUpdatedSignal(quint64 _height);
+  void peerCountUpdatedSignal(quintptr _count);
+  void poolChangedSignal();
+};
+
+}
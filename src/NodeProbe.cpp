@@ -0,0 +1,189 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QUrl>
+
+#include <algorithm>
+
+#include "NodeProbe.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int LOCAL_NODE_DEFAULT_TIMEOUT = 500;
+const int REMOTE_NODE_DEFAULT_TIMEOUT = 2000;
+const int MIN_PROBE_TIMEOUT = 200;
+const int MAX_PROBE_TIMEOUT = 3000;
+
+bool isLocalHost(const QString& _host) {
+  return _host == "127.0.0.1" || _host == "localhost" || _host == "::1";
+}
+
+}
+
+NodeProbe::NodeProbe(QObject* _parent) : QObject(_parent), m_manager(new QNetworkAccessManager(this)), m_pending(0), m_recordRtt(true) {
+}
+
+NodeProbe::~NodeProbe() {
+  abort();
+}
+
+int NodeProbe::timeoutFor(const NodeSetting& _node) {
+  quint32 rtt = Settings::instance().getNodeRtt(_node);
+  if (rtt == 0) {
+    return isLocalHost(_node.host) ? LOCAL_NODE_DEFAULT_TIMEOUT : REMOTE_NODE_DEFAULT_TIMEOUT;
+  }
+
+  return std::min<int>(std::max<int>(rtt * 4 + 100, MIN_PROBE_TIMEOUT), MAX_PROBE_TIMEOUT);
+}
+
+void NodeProbe::setRecordRtt(bool _record) {
+  m_recordRtt = _record;
+}
+
+void NodeProbe::start(const QVector<NodeSetting>& _nodes, const QVector<int>& _timeouts) {
+  abort();
+  m_results.clear();
+  m_replies.clear();
+  m_pending = _nodes.size();
+  m_clock.start();
+  for (int i = 0; i < _nodes.size(); ++i) {
+    const NodeSetting& node = _nodes[i];
+    m_results.append(NodeProbeResult{node, false, false, 0, 0});
+
+    QUrl url;
+    url.setScheme(node.ssl ? "https" : "http");
+    url.setHost(node.host);
+    url.setPort(node.port);
+    url.setPath("/getinfo");
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QNetworkReply* reply = m_manager->get(request);
+    m_replies.append(reply);
+    connect(reply, &QNetworkReply::finished, this, [this, i]() { probeFinished(i); });
+    QTimer::singleShot(i < _timeouts.size() ? _timeouts[i] : timeoutFor(node), reply, &QNetworkReply::abort);
+  }
+
+  if (m_pending == 0) {
+    Q_EMIT probeFinishedSignal();
+  }
+}
+
+void NodeProbe::abort() {
+  recordRtts();
+  for (QNetworkReply* reply : m_replies) {
+    if (reply != nullptr) {
+      reply->disconnect(this);
+      reply->abort();
+      reply->deleteLater();
+    }
+  }
+
+  m_replies.clear();
+  m_pending = 0;
+}
+
+bool NodeProbe::isFinished() const {
+  return m_pending == 0;
+}
+
+const QVector<NodeProbeResult>& NodeProbe::results() const {
+  return m_results;
+}
+
+int NodeProbe::bestIndex() const {
+  int best = -1;
+  for (int i = 0; i < m_results.size(); ++i) {
+    const NodeProbeResult& result = m_results[i];
+    if (!result.ok) {
+      continue;
+    }
+
+    if (best < 0 || result.height > m_results[best].height ||
+        (result.height == m_results[best].height && result.rtt < m_results[best].rtt)) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+void NodeProbe::wait(int _grace, int _required) {
+  if (isFinished()) {
+    return;
+  }
+
+  QEventLoop waitLoop;
+  QTimer graceTimer;
+  bool graceExpired = false;
+  auto requiredFinished = [this, _required]() {
+    return _required < 0 || _required >= m_results.size() || m_results[_required].finished;
+  };
+
+  graceTimer.setSingleShot(true);
+  graceTimer.setInterval(_grace);
+  connect(&graceTimer, &QTimer::timeout, &waitLoop, [&waitLoop, &graceExpired, requiredFinished]() {
+    graceExpired = true;
+    if (requiredFinished()) {
+      waitLoop.quit();
+    }
+  });
+  connect(this, &NodeProbe::probeFinishedSignal, &waitLoop, &QEventLoop::quit);
+  connect(this, &NodeProbe::nodeProbedSignal, &waitLoop, [this, &waitLoop, &graceTimer, &graceExpired, _required](int _index) {
+    if (_index == _required && graceExpired) {
+      waitLoop.quit();
+    } else if (m_results[_index].ok && !graceTimer.isActive() && !graceExpired) {
+      graceTimer.start();
+    }
+  });
+
+  if (bestIndex() >= 0) {
+    graceTimer.start();
+  }
+
+  waitLoop.exec();
+}
+
+void NodeProbe::probeFinished(int _index) {
+  QNetworkReply* reply = m_replies[_index];
+  m_replies[_index] = nullptr;
+  reply->deleteLater();
+
+  NodeProbeResult& result = m_results[_index];
+  result.finished = true;
+  result.rtt = m_clock.elapsed();
+  if (reply->error() == QNetworkReply::NoError) {
+    QJsonObject info = QJsonDocument::fromJson(reply->readAll()).object();
+    result.height = static_cast<quint64>(info.value("height").toVariant().toULongLong());
+    result.ok = info.value("status").toString() == "OK" && result.height > 0;
+  }
+
+  if (result.ok && m_recordRtt) {
+    m_rtts.append(qMakePair(result.node, static_cast<quint32>(result.rtt)));
+  }
+
+  --m_pending;
+  Q_EMIT nodeProbedSignal(_index);
+  if (m_pending == 0) {
+    recordRtts();
+    Q_EMIT probeFinishedSignal();
+  }
+}
+
+void NodeProbe::recordRtts() {
+  if (!m_rtts.isEmpty()) {
+    Settings::instance().setNodeRtts(m_rtts);
+    m_rtts.clear();
+  }
+}
+
+}
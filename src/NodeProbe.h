@@ -0,0 +1,72 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVector>
+
+#include "Settings.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+namespace WalletGui {
+
+struct NodeProbeResult {
+  NodeSetting node;
+  bool finished;
+  bool ok;
+  quint64 height;
+  qint64 rtt;
+};
+
+// Queries /getinfo of several nodes at once. Every node gets a timeout derived
+// from its last measured round trip, so dead nodes are given up quickly.
+class NodeProbe : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(NodeProbe)
+
+public:
+  explicit NodeProbe(QObject* _parent = nullptr);
+  ~NodeProbe();
+
+  // Timeouts default to timeoutFor() of every node
+  void start(const QVector<NodeSetting>& _nodes, const QVector<int>& _timeouts = QVector<int>());
+  void abort();
+  bool isFinished() const;
+  const QVector<NodeProbeResult>& results() const;
+
+  // Highest responding node, the faster one among equal heights; -1 if none answered
+  int bestIndex() const;
+  // Waits with a local event loop until all probes finished, or only until
+  // _grace ms after the first healthy answer. The probe of _required, if given,
+  // is always waited for, up to its own timeout.
+  void wait(int _grace, int _required = -1);
+
+  // Off for probes running outside the GUI thread, Settings is not thread safe
+  void setRecordRtt(bool _record);
+
+  static int timeoutFor(const NodeSetting& _node);
+
+private:
+  QNetworkAccessManager* m_manager;
+  QVector<NodeProbeResult> m_results;
+  QVector<QNetworkReply*> m_replies;
+  QElapsedTimer m_clock;
+  int m_pending;
+  bool m_recordRtt;
+  // measured round trips not written to Settings yet
+  QVector<QPair<NodeSetting, quint32>> m_rtts;
+
+  void probeFinished(int _index);
+  void recordRtts();
+
+Q_SIGNALS:
+  void nodeProbedSignal(int _index);
+  void probeFinishedSignal();
+};
+
+}
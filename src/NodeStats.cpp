@@ -0,0 +1,122 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "NodeStats.h"
+#include "NodeAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int STATS_REFRESH_INTERVAL = 1000;
+const int STATS_TTL = 2000;
+
+}
+
+NodeStats& NodeStats::instance() {
+  static NodeStats inst;
+  return inst;
+}
+
+NodeStats::NodeStats() : QObject(), m_snapshot(), m_refreshTimer(this), m_subscribers(0), m_refreshScheduled(false),
+  m_countersRequested(false) {
+  m_refreshTimer.setInterval(STATS_REFRESH_INTERVAL);
+  connect(&m_refreshTimer, &QTimer::timeout, this, &NodeStats::refresh);
+  connect(&NodeAdapter::instance(), &NodeAdapter::nodeInitCompletedSignal, this, &NodeStats::nodeInitCompleted, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::localBlockchainUpdatedSignal, this, &NodeStats::scheduleRefresh, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::peerCountUpdatedSignal, this, &NodeStats::scheduleRefresh, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::nodeCountersReceivedSignal, this, &NodeStats::countersReceived, Qt::QueuedConnection);
+  if (NodeAdapter::instance().hasNode()) {
+    scheduleRefresh();
+  }
+}
+
+NodeStats::~NodeStats() {
+}
+
+NodeStatsSnapshot NodeStats::snapshot() {
+  if (!m_snapshot.valid || !m_age.isValid() || m_age.elapsed() > STATS_TTL) {
+    scheduleRefresh();
+  }
+
+  return m_snapshot;
+}
+
+void NodeStats::subscribe() {
+  ++m_subscribers;
+  updatePolling();
+  scheduleRefresh();
+}
+
+void NodeStats::unsubscribe() {
+  --m_subscribers;
+  updatePolling();
+}
+
+void NodeStats::refresh() {
+  m_refreshScheduled = false;
+  NodeAdapter& node = NodeAdapter::instance();
+  if (!node.hasNode()) {
+    return;
+  }
+
+  m_snapshot.peerCount = node.getPeerCount();
+  m_snapshot.lastKnownBlockHeight = node.getLastKnownBlockHeight();
+  m_snapshot.lastLocalBlockHeight = node.getLastLocalBlockHeight();
+  m_snapshot.lastLocalBlockTimestamp = node.getLastLocalBlockTimestamp();
+  m_snapshot.currentBlockMajorVersion = node.getCurrentBlockMajorVersion();
+
+  // One pass at a time, a slow node is not asked again before it answered
+  if (!m_countersRequested) {
+    m_countersRequested = true;
+    node.requestCounters();
+  }
+}
+
+void NodeStats::countersReceived(const WalletGui::NodeCounters& _counters) {
+  m_countersRequested = false;
+  m_snapshot.valid = true;
+  m_snapshot.connectionsCount = _counters.connectionsCount;
+  m_snapshot.outgoingConnectionsCount = _counters.outgoingConnectionsCount;
+  m_snapshot.incomingConnectionsCount = _counters.incomingConnectionsCount;
+  m_snapshot.whitePeerlistSize = _counters.whitePeerlistSize;
+  m_snapshot.greyPeerlistSize = _counters.greyPeerlistSize;
+  m_snapshot.difficulty = _counters.difficulty;
+  m_snapshot.nextReward = _counters.nextReward;
+  m_snapshot.txCount = _counters.txCount;
+  m_snapshot.txPoolSize = _counters.txPoolSize;
+  m_snapshot.altBlocksCount = _counters.altBlocksCount;
+  m_snapshot.alreadyGeneratedCoins = _counters.alreadyGeneratedCoins;
+  m_snapshot.minimalFee = _counters.minimalFee;
+  m_age.start();
+  Q_EMIT statsUpdatedSignal();
+}
+
+void NodeStats::updatePolling() {
+  // Block and peer updates refresh the snapshot anyway, the timer only keeps
+  // the other values current for views that show them
+  if (m_subscribers > 0 && NodeAdapter::instance().hasNode()) {
+    if (!m_refreshTimer.isActive()) {
+      m_refreshTimer.start();
+    }
+  } else {
+    m_refreshTimer.stop();
+  }
+}
+
+void NodeStats::nodeInitCompleted() {
+  m_countersRequested = false;
+  refresh();
+  updatePolling();
+}
+
+void NodeStats::scheduleRefresh() {
+  // Bursts of block updates during sync result in one refresh
+  if (!m_refreshScheduled) {
+    m_refreshScheduled = true;
+    QTimer::singleShot(0, this, &NodeStats::refresh);
+  }
+}
+
+}
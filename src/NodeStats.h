@@ -0,0 +1,79 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include "CryptoNoteWrapper.h"
+
+namespace WalletGui {
+
+struct NodeStatsSnapshot {
+  bool valid;
+  quint64 peerCount;
+  quint64 connectionsCount;
+  quint64 outgoingConnectionsCount;
+  quint64 incomingConnectionsCount;
+  quint64 whitePeerlistSize;
+  quint64 greyPeerlistSize;
+  quint64 lastKnownBlockHeight;
+  quint64 lastLocalBlockHeight;
+  QDateTime lastLocalBlockTimestamp;
+  quint64 difficulty;
+  quint64 nextReward;
+  quint64 txCount;
+  quint64 txPoolSize;
+  quint64 altBlocksCount;
+  quint64 alreadyGeneratedCoins;
+  quint64 minimalFee;
+  quint8 currentBlockMajorVersion;
+};
+
+// Node statistics for the views. Heights, peers and the values of the last
+// block are what the GUI thread already holds; everything else comes from one
+// node call (NodeAdapter::requestCounters) that answers asynchronously, so
+// nothing shown waits on RPC round trips or core locks. A pass runs after node
+// init, on new blocks and peer changes, and once a second while somebody is
+// subscribed. GUI thread only.
+class NodeStats : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(NodeStats)
+
+public:
+  static NodeStats& instance();
+
+  // The last collected values, never blocks; a new pass is requested if they
+  // are older than the TTL and statsUpdatedSignal follows when it is done
+  NodeStatsSnapshot snapshot();
+
+  // Views showing the statistics live subscribe while they are visible
+  void subscribe();
+  void unsubscribe();
+
+private:
+  NodeStatsSnapshot m_snapshot;
+  QTimer m_refreshTimer;
+  QElapsedTimer m_age;
+  int m_subscribers;
+  bool m_refreshScheduled;
+  bool m_countersRequested;
+
+  NodeStats();
+  ~NodeStats();
+
+  void refresh();
+  void updatePolling();
+  void nodeInitCompleted();
+  void countersReceived(const WalletGui::NodeCounters& _counters);
+  void scheduleRefresh();
+
+Q_SIGNALS:
+  void statsUpdatedSignal();
+};
+
+}
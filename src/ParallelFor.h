@@ -0,0 +1,63 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace WalletGui {
+
+// Runs _func(0.._count-1) on _threadCount threads (all cores by default), the
+// calling thread included. Stops at the first item returning false or throwing,
+// or once _cancelled is set; returns true only if every item succeeded.
+template<typename Func>
+bool parallelFor(size_t _count, Func _func, const std::atomic<bool>* _cancelled = nullptr, std::atomic<size_t>* _done = nullptr,
+  size_t _threadCount = 0) {
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  auto worker = [&]() {
+    for (size_t i = next++; i < _count; i = next++) {
+      if (failed || (_cancelled != nullptr && *_cancelled)) {
+        return;
+      }
+
+      bool ok = false;
+      try {
+        ok = _func(i);
+      } catch (std::exception&) {
+      }
+
+      if (!ok) {
+        failed = true;
+        return;
+      }
+
+      if (_done != nullptr) {
+        ++*_done;
+      }
+    }
+  };
+
+  if (_threadCount == 0) {
+    _threadCount = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(_threadCount, _count); ++i) {
+    threads.emplace_back(worker);
+  }
+
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  return !failed && (_cancelled == nullptr || !*_cancelled);
+}
+
+}
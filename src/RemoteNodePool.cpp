@@ -0,0 +1,498 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+
+#include <algorithm>
+#include <limits>
+
+#include "RemoteNodePool.h"
+#include "LoggerAdapter.h"
+#include "NodeProbe.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int MAX_REQUEST_SIZE = 4 * 1024 * 1024;
+const int FORWARD_TIMEOUT = 20000;
+const int MAX_FORWARD_ATTEMPTS = 3;
+const int PROBE_INTERVAL = 30000;
+const int MIN_PROBE_TIMEOUT = 500;
+const int MAX_PROBE_TIMEOUT = 5000;
+const int UNKNOWN_RTT_PROBE_TIMEOUT = 3000;
+
+// Smoothing of round trip and error rate
+const double RTT_ALPHA = 0.3;
+const double ERROR_ALPHA = 0.2;
+
+// Score is a virtual round trip in ms, every block behind costs as much as 250 ms
+const double LAG_PENALTY = 250;
+const double ERROR_PENALTY = 5000;
+const double FEE_PENALTY = 1000;
+
+// Hysteresis, the active node is replaced only by a clearly better one
+const double SWITCH_RATIO = 0.7;
+const double MAX_ERROR_RATE = 0.5;
+const quint64 MAX_LAG = 5;
+
+QUrl upstreamUrl(const NodeSetting& _node, const QByteArray& _path) {
+  QUrl url;
+  url.setScheme(_node.ssl ? "https" : "http");
+  url.setHost(_node.host);
+  url.setPort(_node.port);
+  QString path = _node.path;
+  if (path.endsWith('/')) {
+    path.chop(1);
+  }
+
+  url.setPath(path + QString::fromLatin1(_path));
+  return url;
+}
+
+}
+
+RemoteNodePool::RemoteNodePool(const QVector<NodeSetting>& _nodes, int _preferred) : QObject(), m_server(nullptr),
+  m_network(nullptr), m_probe(nullptr), m_probeTimer(nullptr), m_port(0), m_nextClientId(0), m_active(_preferred), m_pinned(-1) {
+  for (const NodeSetting& node : _nodes) {
+    m_upstreams.append(Upstream{node, true, false, false, 0, 0, 0, QString()});
+  }
+
+  if (m_active < 0 || m_active >= m_upstreams.size()) {
+    m_active = m_upstreams.isEmpty() ? -1 : 0;
+  }
+}
+
+RemoteNodePool::~RemoteNodePool() {
+  stop();
+}
+
+bool RemoteNodePool::start() {
+  if (m_thread.isRunning()) {
+    return true;
+  }
+
+  m_thread.setObjectName("RemoteNodePool");
+  moveToThread(&m_thread);
+  m_thread.start();
+
+  bool started = false;
+  QMetaObject::invokeMethod(this, "startListening", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, started));
+  if (!started) {
+    stop();
+  }
+
+  return started;
+}
+
+void RemoteNodePool::stop() {
+  if (!m_thread.isRunning()) {
+    return;
+  }
+
+  QMetaObject::invokeMethod(this, "stopListening", Qt::BlockingQueuedConnection);
+  m_thread.quit();
+  m_thread.wait();
+}
+
+quint16 RemoteNodePool::port() const {
+  return m_port;
+}
+
+QVector<RemoteNodeScore> RemoteNodePool::scores() const {
+  QMutexLocker locker(&m_mutex);
+  const quint64 best = bestHeight();
+  QVector<RemoteNodeScore> result;
+  for (int i = 0; i < m_upstreams.size(); ++i) {
+    const Upstream& upstream = m_upstreams[i];
+    result.append(RemoteNodeScore{upstream.node, upstream.online, i == m_active, upstream.height,
+      best > upstream.height ? best - upstream.height : 0, static_cast<qint64>(upstream.rtt), upstream.errorRate,
+      upstream.hasFee, score(upstream, best)});
+  }
+
+  return result;
+}
+
+void RemoteNodePool::pinNode(const NodeSetting& _node) {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_pinned = -1;
+    for (int i = 0; i < m_upstreams.size(); ++i) {
+      if (m_upstreams[i].node.host == _node.host && m_upstreams[i].node.port == _node.port) {
+        m_pinned = i;
+        break;
+      }
+    }
+
+    if (m_pinned < 0) {
+      m_upstreams.append(Upstream{_node, false, false, false, 0, 0, 0, QString()});
+      m_pinned = m_upstreams.size() - 1;
+    }
+  }
+
+  // The pinned node takes over as soon as a probe sees it healthy
+  QMetaObject::invokeMethod(this, "probe", Qt::QueuedConnection);
+}
+
+bool RemoteNodePool::recordTo(const QString& _path) {
+  return m_recorder.open(_path);
+}
+
+QString RemoteNodePool::activeFeeAddress() const {
+  QMutexLocker locker(&m_mutex);
+  return m_active >= 0 && m_upstreams[m_active].feeChecked ? m_upstreams[m_active].feeAddress : QString();
+}
+
+bool RemoteNodePool::startListening() {
+  m_server = new QTcpServer(this);
+  m_network = new QNetworkAccessManager(this);
+  m_probe = new NodeProbe(this);
+  m_probe->setRecordRtt(false);
+  m_probeTimer = new QTimer(this);
+  m_probeTimer->setInterval(PROBE_INTERVAL);
+  connect(m_server, &QTcpServer::newConnection, this, &RemoteNodePool::acceptConnection);
+  connect(m_probe, &NodeProbe::probeFinishedSignal, this, &RemoteNodePool::probeFinished);
+  connect(m_probeTimer, &QTimer::timeout, this, &RemoteNodePool::probe);
+  if (!m_server->listen(QHostAddress::LocalHost, 0)) {
+    return false;
+  }
+
+  m_port = m_server->serverPort();
+  m_probeTimer->start();
+  probe();
+  return true;
+}
+
+void RemoteNodePool::stopListening() {
+  m_probeTimer->stop();
+  m_probe->abort();
+  m_server->close();
+  for (Client& client : m_clients) {
+    if (!client.socket.isNull()) {
+      client.socket->abort();
+      client.socket->deleteLater();
+    }
+  }
+
+  m_clients.clear();
+  delete m_probeTimer;
+  m_probeTimer = nullptr;
+  delete m_probe;
+  m_probe = nullptr;
+  delete m_network;
+  m_network = nullptr;
+  delete m_server;
+  m_server = nullptr;
+}
+
+void RemoteNodePool::acceptConnection() {
+  while (m_server->hasPendingConnections()) {
+    QTcpSocket* socket = m_server->nextPendingConnection();
+    const quint64 clientId = ++m_nextClientId;
+    Client client;
+    client.socket = socket;
+    client.busy = false;
+    m_clients.insert(clientId, client);
+    connect(socket, &QTcpSocket::readyRead, this, [this, clientId]() { readClient(clientId); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, clientId, socket]() {
+      m_clients.remove(clientId);
+      socket->deleteLater();
+    });
+  }
+}
+
+void RemoteNodePool::readClient(quint64 _clientId) {
+  auto it = m_clients.find(_clientId);
+  if (it == m_clients.end() || it->socket.isNull()) {
+    return;
+  }
+
+  it->buffer.append(it->socket->readAll());
+  if (it->buffer.size() > MAX_REQUEST_SIZE) {
+    writeResponse(_clientId, 413, QByteArray(), "text/plain");
+    it->socket->disconnectFromHost();
+    return;
+  }
+
+  if (it->busy) {
+    return;
+  }
+
+  HttpRequest request;
+  if (!parseHttpRequest(it->buffer, request)) {
+    return;
+  }
+
+  it->busy = true;
+  forward(_clientId, request, QVector<int>());
+}
+
+void RemoteNodePool::forward(quint64 _clientId, const HttpRequest& _request, QVector<int> _tried) {
+  int index;
+  NodeSetting node;
+  {
+    QMutexLocker locker(&m_mutex);
+    index = pickUpstream(_tried);
+    if (index >= 0) {
+      node = m_upstreams[index].node;
+    }
+  }
+
+  if (index < 0) {
+    writeResponse(_clientId, 503, QByteArray(), "text/plain");
+    return;
+  }
+
+  QNetworkRequest request(upstreamUrl(node, _request.path));
+  request.setHeader(QNetworkRequest::ContentTypeHeader, _request.headers.value("content-type", "application/json"));
+  QNetworkReply* reply = _request.method == "GET" ? m_network->get(request) : m_network->post(request, _request.body);
+  QTimer::singleShot(FORWARD_TIMEOUT, reply, &QNetworkReply::abort);
+  connect(reply, &QNetworkReply::finished, this, [this, reply, index, _clientId, _request, _tried]() mutable {
+    reply->deleteLater();
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 0) {
+      // No HTTP answer. Only a refused connection or an unknown host means the request
+      // never left; after a timeout or a dropped connection the daemon may have acted
+      // on it, so requests that change something are not sent to another node.
+      recordResult(index, false);
+      _tried.append(index);
+      const bool notSent = reply->error() == QNetworkReply::ConnectionRefusedError || reply->error() == QNetworkReply::HostNotFoundError;
+      if (_tried.size() < MAX_FORWARD_ATTEMPTS && (notSent || isIdempotent(_request))) {
+        forward(_clientId, _request, _tried);
+      } else {
+        writeResponse(_clientId, 502, QByteArray(), "text/plain");
+      }
+
+      return;
+    }
+
+    recordResult(index, status < 500);
+    QByteArray contentType = reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+    const RecordedExchange exchange = {_request.path, _request.body, status, contentType.isEmpty() ? QByteArray("application/json") : contentType, reply->readAll()};
+    m_recorder.record(exchange);
+    writeResponse(_clientId, status, exchange.response, exchange.contentType);
+  });
+}
+
+void RemoteNodePool::writeResponse(quint64 _clientId, int _status, const QByteArray& _body, const QByteArray& _contentType) {
+  auto it = m_clients.find(_clientId);
+  if (it == m_clients.end() || it->socket.isNull()) {
+    return;
+  }
+
+  it->socket->write(makeHttpResponse(_status, _body, _contentType));
+  it->busy = false;
+  if (!it->buffer.isEmpty()) {
+    QTimer::singleShot(0, this, [this, _clientId]() { readClient(_clientId); });
+  }
+}
+
+void RemoteNodePool::probe() {
+  if (!m_probe->isFinished()) {
+    return;
+  }
+
+  QVector<NodeSetting> nodes;
+  QVector<int> timeouts;
+  {
+    QMutexLocker locker(&m_mutex);
+    for (const Upstream& upstream : m_upstreams) {
+      nodes.append(upstream.node);
+      timeouts.append(upstream.rtt > 0 ?
+        std::min<int>(std::max<int>(static_cast<int>(upstream.rtt * 4) + 100, MIN_PROBE_TIMEOUT), MAX_PROBE_TIMEOUT) :
+        UNKNOWN_RTT_PROBE_TIMEOUT);
+    }
+  }
+
+  m_probe->start(nodes, timeouts);
+}
+
+void RemoteNodePool::probeFinished() {
+  const QVector<NodeProbeResult>& results = m_probe->results();
+  {
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < results.size() && i < m_upstreams.size(); ++i) {
+      Upstream& upstream = m_upstreams[i];
+      const NodeProbeResult& result = results[i];
+      upstream.online = result.ok;
+      upstream.errorRate = upstream.errorRate * (1 - ERROR_ALPHA) + (result.ok ? 0 : ERROR_ALPHA);
+      if (result.ok) {
+        upstream.height = result.height;
+        upstream.rtt = upstream.rtt > 0 ? upstream.rtt * (1 - RTT_ALPHA) + result.rtt * RTT_ALPHA : result.rtt;
+      }
+    }
+  }
+
+  for (int i = 0; i < results.size(); ++i) {
+    if (results[i].ok) {
+      checkFee(i);
+    }
+  }
+
+  updateActive();
+  Q_EMIT scoresUpdatedSignal();
+}
+
+void RemoteNodePool::checkFee(int _index) {
+  NodeSetting node;
+  {
+    QMutexLocker locker(&m_mutex);
+    if (m_upstreams[_index].feeChecked) {
+      return;
+    }
+
+    m_upstreams[_index].feeChecked = true;
+    node = m_upstreams[_index].node;
+  }
+
+  QNetworkRequest request(upstreamUrl(node, "/feeaddress"));
+  QNetworkReply* reply = m_network->get(request);
+  QTimer::singleShot(FORWARD_TIMEOUT, reply, &QNetworkReply::abort);
+  connect(reply, &QNetworkReply::finished, this, [this, reply, _index]() {
+    reply->deleteLater();
+    const bool answered = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 0;
+    const QString feeAddress = QJsonDocument::fromJson(reply->readAll()).object().value("fee_address").toString();
+    bool active;
+    {
+      QMutexLocker locker(&m_mutex);
+      m_upstreams[_index].feeChecked = answered;
+      m_upstreams[_index].hasFee = !feeAddress.isEmpty();
+      m_upstreams[_index].feeAddress = feeAddress;
+      active = _index == m_active;
+    }
+
+    if (active && answered) {
+      Q_EMIT activeFeeAddressChangedSignal();
+    }
+  });
+}
+
+void RemoteNodePool::recordResult(int _index, bool _ok) {
+  bool activeFailed;
+  {
+    QMutexLocker locker(&m_mutex);
+    Upstream& upstream = m_upstreams[_index];
+    upstream.errorRate = upstream.errorRate * (1 - ERROR_ALPHA) + (_ok ? 0 : ERROR_ALPHA);
+    activeFailed = !_ok && _index == m_active;
+  }
+
+  if (activeFailed) {
+    updateActive();
+    Q_EMIT scoresUpdatedSignal();
+  }
+}
+
+int RemoteNodePool::pickUpstream(const QVector<int>& _tried) const {
+  if (m_active >= 0 && !_tried.contains(m_active)) {
+    return m_active;
+  }
+
+  const quint64 best = bestHeight();
+  int result = -1;
+  double resultScore = std::numeric_limits<double>::max();
+  for (int i = 0; i < m_upstreams.size(); ++i) {
+    if (_tried.contains(i)) {
+      continue;
+    }
+
+    // Offline nodes are still worth a try when nothing else is left
+    const double nodeScore = score(m_upstreams[i], best);
+    if (result < 0 || nodeScore < resultScore) {
+      result = i;
+      resultScore = nodeScore;
+    }
+  }
+
+  return result;
+}
+
+void RemoteNodePool::updateActive() {
+  NodeSetting switchedTo;
+  {
+    QMutexLocker locker(&m_mutex);
+    const quint64 best = bestHeight();
+    int candidate = -1;
+    double candidateScore = std::numeric_limits<double>::max();
+    for (int i = 0; i < m_upstreams.size(); ++i) {
+      const double nodeScore = score(m_upstreams[i], best);
+      if (nodeScore < candidateScore) {
+        candidate = i;
+        candidateScore = nodeScore;
+      }
+    }
+
+    const bool pinned = m_pinned >= 0 && isHealthy(m_upstreams[m_pinned], best);
+    if (pinned) {
+      candidate = m_pinned;
+    }
+
+    if (candidate < 0 || candidate == m_active) {
+      return;
+    }
+
+    if (!pinned && m_active >= 0) {
+      const Upstream& active = m_upstreams[m_active];
+      if (isHealthy(active, best) && candidateScore >= score(active, best) * SWITCH_RATIO) {
+        return;
+      }
+    }
+
+    m_active = candidate;
+    switchedTo = m_upstreams[candidate].node;
+  }
+
+  LoggerAdapter::instance().log(QString("Switching to remote node %1:%2").arg(switchedTo.host).arg(switchedTo.port).toStdString());
+  // sends now pay the new node, its fee address is asked for if not known yet
+  Q_EMIT activeFeeAddressChangedSignal();
+  checkFee(m_active);
+}
+
+bool RemoteNodePool::isIdempotent(const HttpRequest& _request) {
+  // relaying a transaction or a block twice can fail on the second node after the
+  // first one took it
+  if (_request.path == "/sendrawtransaction") {
+    return false;
+  }
+
+  if (_request.path == "/json_rpc") {
+    return QJsonDocument::fromJson(_request.body).object().value("method").toString() != "submitblock";
+  }
+
+  return true;
+}
+
+bool RemoteNodePool::isHealthy(const Upstream& _upstream, quint64 _bestHeight) const {
+  return _upstream.online && _upstream.errorRate <= MAX_ERROR_RATE && _bestHeight <= _upstream.height + MAX_LAG;
+}
+
+double RemoteNodePool::score(const Upstream& _upstream, quint64 _bestHeight) const {
+  if (!_upstream.online) {
+    return std::numeric_limits<double>::max();
+  }
+
+  const quint64 lag = _bestHeight > _upstream.height ? _bestHeight - _upstream.height : 0;
+  return _upstream.rtt + LAG_PENALTY * lag + ERROR_PENALTY * _upstream.errorRate + (_upstream.hasFee ? FEE_PENALTY : 0);
+}
+
+quint64 RemoteNodePool::bestHeight() const {
+  quint64 best = 0;
+  for (const Upstream& upstream : m_upstreams) {
+    if (upstream.online) {
+      best = std::max(best, upstream.height);
+    }
+  }
+
+  return best;
+}
+
+}
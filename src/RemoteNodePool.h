@@ -0,0 +1,120 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QVector>
+
+#include "HttpMessage.h"
+#include "ReplayNode.h"
+#include "Settings.h"
+
+class QNetworkAccessManager;
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+namespace WalletGui {
+
+class NodeProbe;
+
+struct RemoteNodeScore {
+  NodeSetting node;
+  bool online;
+  bool active;
+  quint64 height;
+  quint64 lag;
+  qint64 rtt;
+  double errorRate;
+  bool hasFee;
+  double score;
+};
+
+// Loopback HTTP endpoint for RpcNode that forwards every request to the best
+// of several remote nodes. Nodes are probed periodically and scored by round
+// trip, height lag, error rate and node fee; a failing node is replaced
+// without reconnecting the wallet.
+class RemoteNodePool : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(RemoteNodePool)
+
+public:
+  RemoteNodePool(const QVector<NodeSetting>& _nodes, int _preferred);
+  ~RemoteNodePool();
+
+  bool start();
+  void stop();
+  quint16 port() const;
+
+  QVector<RemoteNodeScore> scores() const;
+
+  // Adds _node if needed and prefers it over all others while it is healthy
+  void pinNode(const NodeSetting& _node);
+  // Every answered request is appended to _path for replaying it later
+  bool recordTo(const QString& _path);
+  // Fee address of the node requests go to now, empty until that node told it
+  QString activeFeeAddress() const;
+
+private:
+  struct Upstream {
+    NodeSetting node;
+    bool online;
+    bool feeChecked;
+    bool hasFee;
+    quint64 height;
+    double rtt;
+    double errorRate;
+    QString feeAddress;
+  };
+
+  struct Client {
+    QPointer<QTcpSocket> socket;
+    QByteArray buffer;
+    bool busy;
+  };
+
+  QThread m_thread;
+  QTcpServer* m_server;
+  QNetworkAccessManager* m_network;
+  NodeProbe* m_probe;
+  QTimer* m_probeTimer;
+  quint16 m_port;
+  quint64 m_nextClientId;
+  QHash<quint64, Client> m_clients;
+  NodeRecorder m_recorder;
+
+  mutable QMutex m_mutex;
+  QVector<Upstream> m_upstreams;
+  int m_active;
+  int m_pinned;
+
+  Q_INVOKABLE bool startListening();
+  Q_INVOKABLE void stopListening();
+  void acceptConnection();
+  void readClient(quint64 _clientId);
+  void forward(quint64 _clientId, const HttpRequest& _request, QVector<int> _tried);
+  void writeResponse(quint64 _clientId, int _status, const QByteArray& _body, const QByteArray& _contentType);
+  Q_INVOKABLE void probe();
+  void probeFinished();
+  void checkFee(int _index);
+  void recordResult(int _index, bool _ok);
+  int pickUpstream(const QVector<int>& _tried) const;
+  void updateActive();
+  bool isHealthy(const Upstream& _upstream, quint64 _bestHeight) const;
+  static bool isIdempotent(const HttpRequest& _request);
+  double score(const Upstream& _upstream, quint64 _bestHeight) const;
+  quint64 bestHeight() const;
+
+Q_SIGNALS:
+  void scoresUpdatedSignal();
+  // Another node became active or the active one's fee address arrived
+  void activeFeeAddressChangedSignal();
+};
+
+}
@@ -0,0 +1,262 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QDataStream>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <algorithm>
+
+#include "ReplayNode.h"
+#include "LoggerAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const quint32 RECORDING_MAGIC = 0x4b524543; // "KREC"
+const quint32 RECORDING_VERSION = 1;
+const int MAX_REQUEST_SIZE = 4 * 1024 * 1024;
+
+QByteArray exchangeKey(const QByteArray& _path, const QByteArray& _request) {
+  return _path + '\n' + _request;
+}
+
+}
+
+NodeRecorder::NodeRecorder() {
+}
+
+NodeRecorder::~NodeRecorder() {
+  m_file.close();
+}
+
+bool NodeRecorder::open(const QString& _path) {
+  QMutexLocker locker(&m_mutex);
+  m_file.setFileName(_path);
+  if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+
+  QDataStream stream(&m_file);
+  stream << RECORDING_MAGIC << RECORDING_VERSION;
+  return stream.status() == QDataStream::Ok;
+}
+
+void NodeRecorder::record(const RecordedExchange& _exchange) {
+  QMutexLocker locker(&m_mutex);
+  if (!m_file.isOpen()) {
+    return;
+  }
+
+  QDataStream stream(&m_file);
+  stream << _exchange.path << _exchange.request << _exchange.status << _exchange.contentType << _exchange.response;
+  m_file.flush();
+}
+
+bool NodeRecorder::load(const QString& _path, QVector<RecordedExchange>& _exchanges) {
+  QFile file(_path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream stream(&file);
+  quint32 magic = 0;
+  quint32 version = 0;
+  stream >> magic >> version;
+  if (magic != RECORDING_MAGIC || version != RECORDING_VERSION) {
+    return false;
+  }
+
+  _exchanges.clear();
+  while (!stream.atEnd()) {
+    RecordedExchange exchange;
+    stream >> exchange.path >> exchange.request >> exchange.status >> exchange.contentType >> exchange.response;
+    if (stream.status() != QDataStream::Ok) {
+      // A recording cut off by a crash is still usable up to the last complete exchange
+      break;
+    }
+
+    _exchanges.append(exchange);
+  }
+
+  return true;
+}
+
+ReplayNodeServer::ReplayNodeServer(quint32 _latency, quint32 _throughput) : QObject(), m_server(nullptr), m_port(0),
+  m_latency(_latency), m_throughput(_throughput), m_nextClientId(0), m_linkFreeAt(0) {
+}
+
+ReplayNodeServer::~ReplayNodeServer() {
+  stop();
+}
+
+bool ReplayNodeServer::load(const QString& _path) {
+  if (!NodeRecorder::load(_path, m_exchanges)) {
+    return false;
+  }
+
+  m_responses.clear();
+  m_lastByPath.clear();
+  for (int i = 0; i < m_exchanges.size(); ++i) {
+    const RecordedExchange& exchange = m_exchanges[i];
+    Responses& responses = m_responses[exchangeKey(exchange.path, exchange.request)];
+    responses.exchanges.append(i);
+    responses.next = 0;
+    m_lastByPath.insert(exchange.path, i);
+  }
+
+  LoggerAdapter::instance().log(QString("Loaded %1 recorded node exchanges from %2").arg(m_exchanges.size()).arg(_path).toStdString());
+  return true;
+}
+
+bool ReplayNodeServer::start() {
+  if (m_thread.isRunning()) {
+    return true;
+  }
+
+  m_thread.setObjectName("ReplayNodeServer");
+  moveToThread(&m_thread);
+  m_thread.start();
+
+  bool started = false;
+  QMetaObject::invokeMethod(this, "startListening", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, started));
+  if (!started) {
+    stop();
+  }
+
+  return started;
+}
+
+void ReplayNodeServer::stop() {
+  if (!m_thread.isRunning()) {
+    return;
+  }
+
+  QMetaObject::invokeMethod(this, "stopListening", Qt::BlockingQueuedConnection);
+  m_thread.quit();
+  m_thread.wait();
+}
+
+quint16 ReplayNodeServer::port() const {
+  return m_port;
+}
+
+bool ReplayNodeServer::startListening() {
+  m_server = new QTcpServer(this);
+  connect(m_server, &QTcpServer::newConnection, this, &ReplayNodeServer::acceptConnection);
+  if (!m_server->listen(QHostAddress::LocalHost, 0)) {
+    return false;
+  }
+
+  m_port = m_server->serverPort();
+  m_clock.start();
+  return true;
+}
+
+void ReplayNodeServer::stopListening() {
+  m_server->close();
+  for (Client& client : m_clients) {
+    if (!client.socket.isNull()) {
+      client.socket->abort();
+      client.socket->deleteLater();
+    }
+  }
+
+  m_clients.clear();
+  delete m_server;
+  m_server = nullptr;
+}
+
+void ReplayNodeServer::acceptConnection() {
+  while (m_server->hasPendingConnections()) {
+    QTcpSocket* socket = m_server->nextPendingConnection();
+    const quint64 clientId = ++m_nextClientId;
+    Client client;
+    client.socket = socket;
+    client.busy = false;
+    m_clients.insert(clientId, client);
+    connect(socket, &QTcpSocket::readyRead, this, [this, clientId]() { readClient(clientId); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, clientId, socket]() {
+      m_clients.remove(clientId);
+      socket->deleteLater();
+    });
+  }
+}
+
+void ReplayNodeServer::readClient(quint64 _clientId) {
+  auto it = m_clients.find(_clientId);
+  if (it == m_clients.end() || it->socket.isNull()) {
+    return;
+  }
+
+  it->buffer.append(it->socket->readAll());
+  if (it->buffer.size() > MAX_REQUEST_SIZE) {
+    it->socket->write(makeHttpResponse(413, QByteArray(), "text/plain"));
+    it->socket->disconnectFromHost();
+    return;
+  }
+
+  if (it->busy) {
+    return;
+  }
+
+  HttpRequest request;
+  if (!parseHttpRequest(it->buffer, request)) {
+    return;
+  }
+
+  it->busy = true;
+  reply(_clientId, request);
+}
+
+void ReplayNodeServer::reply(quint64 _clientId, const HttpRequest& _request) {
+  int index = -1;
+  auto responses = m_responses.find(exchangeKey(_request.path, _request.body));
+  if (responses != m_responses.end()) {
+    // Repeated requests walk through the recorded answers and stay on the last one
+    index = responses->exchanges[responses->next];
+    responses->next = std::min(responses->next + 1, responses->exchanges.size() - 1);
+  } else {
+    // Polling requests like /getinfo differ in nothing that matters for the replay
+    index = m_lastByPath.value(_request.path, -1);
+  }
+
+  QByteArray response;
+  if (index < 0) {
+    response = makeHttpResponse(404, QByteArray(), "text/plain");
+  } else {
+    const RecordedExchange& exchange = m_exchanges[index];
+    response = makeHttpResponse(exchange.status, exchange.response, exchange.contentType);
+  }
+
+  // Responses share one simulated link, each one occupies it for its transfer time
+  const qint64 now = m_clock.elapsed() + m_latency;
+  const qint64 transfer = m_throughput > 0 ? response.size() * 1000 / (static_cast<qint64>(m_throughput) * 1024) : 0;
+  m_linkFreeAt = std::max(now, m_linkFreeAt) + transfer;
+  const qint64 delay = m_linkFreeAt - m_clock.elapsed();
+  if (delay <= 0) {
+    writeResponse(_clientId, response);
+    return;
+  }
+
+  QTimer::singleShot(static_cast<int>(delay), this, [this, _clientId, response]() { writeResponse(_clientId, response); });
+}
+
+void ReplayNodeServer::writeResponse(quint64 _clientId, const QByteArray& _response) {
+  auto it = m_clients.find(_clientId);
+  if (it == m_clients.end() || it->socket.isNull()) {
+    return;
+  }
+
+  it->socket->write(_response);
+  it->busy = false;
+  if (!it->buffer.isEmpty()) {
+    QTimer::singleShot(0, this, [this, _clientId]() { readClient(_clientId); });
+  }
+}
+
+}
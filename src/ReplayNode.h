@@ -0,0 +1,98 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QVector>
+
+#include "HttpMessage.h"
+
+class QTcpServer;
+class QTcpSocket;
+
+namespace WalletGui {
+
+struct RecordedExchange {
+  QByteArray path;
+  QByteArray request;
+  qint32 status;
+  QByteArray contentType;
+  QByteArray response;
+};
+
+// Appends node rpc exchanges to a recording file, may be used from any thread
+class NodeRecorder {
+  Q_DISABLE_COPY(NodeRecorder)
+
+public:
+  NodeRecorder();
+  ~NodeRecorder();
+
+  bool open(const QString& _path);
+  void record(const RecordedExchange& _exchange);
+
+  static bool load(const QString& _path, QVector<RecordedExchange>& _exchanges);
+
+private:
+  QMutex m_mutex;
+  QFile m_file;
+};
+
+// Loopback HTTP endpoint for RpcNode that answers from a recorded node session.
+// Equal requests get the recorded responses in their original order, the same
+// recording always gives the same sync. Latency and bandwidth are simulated.
+class ReplayNodeServer : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(ReplayNodeServer)
+
+public:
+  ReplayNodeServer(quint32 _latency, quint32 _throughput);
+  ~ReplayNodeServer();
+
+  bool load(const QString& _path);
+  bool start();
+  void stop();
+  quint16 port() const;
+
+private:
+  struct Client {
+    QPointer<QTcpSocket> socket;
+    QByteArray buffer;
+    bool busy;
+  };
+
+  struct Responses {
+    QVector<int> exchanges;
+    int next;
+  };
+
+  QThread m_thread;
+  QTcpServer* m_server;
+  quint16 m_port;
+  quint32 m_latency;
+  quint32 m_throughput;
+  quint64 m_nextClientId;
+  QHash<quint64, Client> m_clients;
+  QVector<RecordedExchange> m_exchanges;
+  QHash<QByteArray, Responses> m_responses;
+  QHash<QByteArray, int> m_lastByPath;
+  QElapsedTimer m_clock;
+  qint64 m_linkFreeAt;
+
+  Q_INVOKABLE bool startListening();
+  Q_INVOKABLE void stopListening();
+  void acceptConnection();
+  void readClient(quint64 _clientId);
+  void reply(quint64 _clientId, const HttpRequest& _request);
+  void writeResponse(quint64 _clientId, const QByteArray& _response);
+};
+
+}
@@ -0,0 +1,387 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+
+#include "ReserveProof.h"
+#include "CryptoNoteWrapper.h"
+#include "CurrencyAdapter.h"
+#include "ParallelFor.h"
+
+#include "BlockchainExplorerData.h"
+#include "Common/Base58.h"
+#include "Common/StringTools.h"
+#include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "CryptoNoteCore/CryptoNoteSerialization.h"
+#include "CryptoNoteCore/CryptoNoteTools.h"
+#include "INode.h"
+#include "crypto/crypto.h"
+
+namespace WalletGui {
+
+namespace {
+
+const char PROOF_HEADER[] = "ReserveProofV1";
+const size_t PROOF_HEADER_SIZE = sizeof(PROOF_HEADER) - 1;
+const int PROGRESS_UPDATE_INTERVAL = 100;
+// A node that takes longer to return the proven transactions fails the check
+const std::chrono::seconds NODE_REQUEST_TIMEOUT(60);
+
+bool isCancelled(const ReserveProof::Progress* _progress) {
+  return _progress != nullptr && _progress->cancelled;
+}
+
+Crypto::Hash prefixHash(const std::string& _message, const CryptoNote::AccountPublicAddress& _address,
+  const std::vector<CryptoNote::reserve_proof_entry>& _entries) {
+  std::string prefixData = _message;
+  prefixData.append(reinterpret_cast<const char*>(&_address), sizeof(CryptoNote::AccountPublicAddress));
+  for (const CryptoNote::reserve_proof_entry& entry : _entries) {
+    prefixData.append(reinterpret_cast<const char*>(&entry.key_image), sizeof(Crypto::PublicKey));
+  }
+
+  Crypto::Hash hash;
+  Crypto::cn_fast_hash(prefixData.data(), prefixData.size(), hash);
+  return hash;
+}
+
+bool decodeProof(const QString& _proof, CryptoNote::reserve_proof& _decoded) {
+  const std::string proof = _proof.trimmed().toStdString();
+  if (proof.size() < PROOF_HEADER_SIZE || proof.compare(0, PROOF_HEADER_SIZE, PROOF_HEADER) != 0) {
+    return false;
+  }
+
+  std::string hex;
+  CryptoNote::BinaryArray binary;
+  return Tools::Base58::decode(proof.substr(PROOF_HEADER_SIZE), hex) && Common::fromHex(hex, binary) &&
+    CryptoNote::fromBinaryArray(_decoded, binary);
+}
+
+}
+
+ReserveProof::ReserveProof(QObject* _parent) : QObject(_parent), m_running(false), m_jobId(0) {
+  m_progress.done = 0;
+  m_progress.total = 0;
+  m_progress.cancelled = false;
+  m_progressTimer.setInterval(PROGRESS_UPDATE_INTERVAL);
+  connect(&m_progressTimer, &QTimer::timeout, this, &ReserveProof::updateProgress);
+}
+
+ReserveProof::~ReserveProof() {
+  cancel();
+}
+
+std::vector<CryptoNote::TransactionOutputInformation> ReserveProof::selectOutputs(std::vector<CryptoNote::TransactionOutputInformation> _outputs,
+  quint64 _reserve) {
+  std::sort(_outputs.begin(), _outputs.end(), [](const CryptoNote::TransactionOutputInformation& a, const CryptoNote::TransactionOutputInformation& b) {
+    return a.amount > b.amount;
+  });
+
+  quint64 total = 0;
+  size_t count = 0;
+  while (count < _outputs.size() && total < _reserve) {
+    total += _outputs[count].amount;
+    ++count;
+  }
+
+  if (total < _reserve || count == 0) {
+    return std::vector<CryptoNote::TransactionOutputInformation>();
+  }
+
+  // The last output taken may be swapped for the smallest one that still covers the reserve
+  const quint64 needed = _reserve - (total - _outputs[count - 1].amount);
+  size_t last = count - 1;
+  for (size_t i = count; i < _outputs.size() && _outputs[i].amount >= needed; ++i) {
+    last = i;
+  }
+
+  std::swap(_outputs[count - 1], _outputs[last]);
+  _outputs.resize(count);
+  return _outputs;
+}
+
+bool ReserveProof::createProof(const CryptoNote::AccountKeys& _keys, const std::vector<CryptoNote::TransactionOutputInformation>& _outputs,
+  quint64 _reserve, const std::string& _message, std::string& _proof, QString& _errorText, Progress* _progress) {
+  if (_keys.spendSecretKey == CryptoNote::NULL_SECRET_KEY) {
+    _errorText = tr("The reserve proof can be generated only by a full wallet");
+    return false;
+  }
+
+  const std::vector<CryptoNote::TransactionOutputInformation> selected = selectOutputs(_outputs, _reserve);
+  if (selected.empty()) {
+    _errorText = tr("Not enough balance for the requested minimum reserve amount");
+    return false;
+  }
+
+  const size_t count = selected.size();
+  if (_progress != nullptr) {
+    _progress->total = count * 2;
+  }
+
+  // Key images go into the prefix hash, so they are derived in a first pass
+  std::vector<CryptoNote::KeyPair> ephemeralKeys(count);
+  std::vector<CryptoNote::reserve_proof_entry> entries(count);
+  bool ok = parallelFor(count, [&](size_t i) {
+    const CryptoNote::TransactionOutputInformation& output = selected[i];
+    CryptoNote::reserve_proof_entry& entry = entries[i];
+    if (!CryptoNote::generate_key_image_helper(_keys, output.transactionPublicKey, output.outputInTransaction, ephemeralKeys[i], entry.key_image)) {
+      return false;
+    }
+
+    entry.txid = output.transactionHash;
+    entry.index_in_tx = output.outputInTransaction;
+    return ephemeralKeys[i].publicKey == output.outputKey;
+  }, _progress != nullptr ? &_progress->cancelled : nullptr, _progress != nullptr ? &_progress->done : nullptr);
+
+  if (!ok) {
+    _errorText = isCancelled(_progress) ? tr("Cancelled") : tr("Failed to derive the key images of the wallet outputs");
+    return false;
+  }
+
+  const Crypto::Hash hash = prefixHash(_message, _keys.address, entries);
+  ok = parallelFor(count, [&](size_t i) {
+    const CryptoNote::TransactionOutputInformation& output = selected[i];
+    CryptoNote::reserve_proof_entry& entry = entries[i];
+    Crypto::KeyImage sharedSecret = Crypto::scalarmultKey(*reinterpret_cast<const Crypto::KeyImage*>(&output.transactionPublicKey),
+      *reinterpret_cast<const Crypto::KeyImage*>(&_keys.viewSecretKey));
+    entry.shared_secret = *reinterpret_cast<const Crypto::PublicKey*>(&sharedSecret);
+    Crypto::generate_tx_proof(hash, _keys.address.viewPublicKey, output.transactionPublicKey, entry.shared_secret, _keys.viewSecretKey,
+      entry.shared_secret_sig);
+
+    const Crypto::PublicKey* keys[] = { &ephemeralKeys[i].publicKey };
+    Crypto::generate_ring_signature(hash, entry.key_image, keys, 1, ephemeralKeys[i].secretKey, 0, &entry.key_image_sig);
+    return true;
+  }, _progress != nullptr ? &_progress->cancelled : nullptr, _progress != nullptr ? &_progress->done : nullptr);
+
+  if (!ok) {
+    _errorText = isCancelled(_progress) ? tr("Cancelled") : tr("Failed to sign the wallet outputs");
+    return false;
+  }
+
+  CryptoNote::reserve_proof proof;
+  proof.proofs = std::move(entries);
+  Crypto::generate_signature(hash, _keys.address.spendPublicKey, _keys.spendSecretKey, proof.signature);
+
+  _proof = PROOF_HEADER + Tools::Base58::encode(Common::toHex(CryptoNote::toBinaryArray(proof)));
+  return true;
+}
+
+QVector<ReserveProofCheckResult> ReserveProof::checkProofs(Node& _node, const QVector<ReserveProofRequest>& _requests,
+  Progress* _progress, size_t _threadCount) {
+  struct DecodedProof {
+    CryptoNote::AccountPublicAddress address;
+    CryptoNote::reserve_proof proof;
+    Crypto::Hash hash;
+  };
+
+  QVector<ReserveProofCheckResult> results(_requests.size(), ReserveProofCheckResult{false, 0, 0, QString()});
+  std::vector<DecodedProof> decoded(_requests.size());
+  std::set<Crypto::Hash> transactionHashes;
+  for (int i = 0; i < _requests.size(); ++i) {
+    const ReserveProofRequest& request = _requests[i];
+    if (!CurrencyAdapter::instance().validateAddress(request.address)) {
+      results[i].errorText = tr("Invalid address");
+      continue;
+    }
+
+    if (!decodeProof(request.proof, decoded[i].proof)) {
+      results[i].errorText = tr("Invalid proof format");
+      continue;
+    }
+
+    decoded[i].address = CurrencyAdapter::instance().internalAddress(request.address);
+    decoded[i].hash = prefixHash(request.message.toStdString(), decoded[i].address, decoded[i].proof.proofs);
+    if (!Crypto::check_signature(decoded[i].hash, decoded[i].address.spendPublicKey, decoded[i].proof.signature)) {
+      results[i].errorText = tr("Invalid signature");
+      continue;
+    }
+
+    results[i].valid = true;
+    for (const CryptoNote::reserve_proof_entry& entry : decoded[i].proof.proofs) {
+      transactionHashes.insert(entry.txid);
+    }
+  }
+
+  // One request to the node for all the proofs
+  // The request outlives a check that gave up waiting, so it owns what it writes to
+  std::shared_ptr<std::vector<CryptoNote::TransactionDetails>> transactionsHolder = std::make_shared<std::vector<CryptoNote::TransactionDetails>>();
+  const std::vector<CryptoNote::TransactionDetails>& transactions = *transactionsHolder;
+  if (!transactionHashes.empty()) {
+    std::shared_ptr<std::promise<std::error_code>> promise = std::make_shared<std::promise<std::error_code>>();
+    std::future<std::error_code> future = promise->get_future();
+    _node.getNode()->getTransactions(std::vector<Crypto::Hash>(transactionHashes.begin(), transactionHashes.end()), *transactionsHolder,
+      [promise, transactionsHolder](std::error_code _error) { promise->set_value(_error); });
+    if (future.wait_for(NODE_REQUEST_TIMEOUT) != std::future_status::ready || future.get()) {
+      for (ReserveProofCheckResult& result : results) {
+        if (result.valid) {
+          result.valid = false;
+          result.errorText = tr("Failed to fetch the transactions from the node");
+        }
+      }
+
+      return results;
+    }
+  }
+
+  std::map<Crypto::Hash, const CryptoNote::TransactionDetails*> transactionsByHash;
+  for (const CryptoNote::TransactionDetails& transaction : transactions) {
+    if (transaction.inBlockchain) {
+      transactionsByHash[transaction.hash] = &transaction;
+    }
+  }
+
+  std::vector<std::pair<int, size_t>> entries;
+  for (int i = 0; i < _requests.size(); ++i) {
+    if (results[i].valid) {
+      for (size_t j = 0; j < decoded[i].proof.proofs.size(); ++j) {
+        entries.emplace_back(i, j);
+      }
+    }
+  }
+
+  if (_progress != nullptr) {
+    _progress->total = entries.size();
+  }
+
+  // Generating a derivation with the scalar one gives 8 * shared secret, as the owner derived it
+  Crypto::SecretKey one = CryptoNote::NULL_SECRET_KEY;
+  one.data[0] = 1;
+
+  std::vector<quint64> amounts(entries.size(), 0);
+  std::vector<char> entryValid(entries.size(), 0);
+  parallelFor(entries.size(), [&](size_t k) {
+    const DecodedProof& proof = decoded[entries[k].first];
+    const CryptoNote::reserve_proof_entry& entry = proof.proof.proofs[entries[k].second];
+    auto it = transactionsByHash.find(entry.txid);
+    if (it == transactionsByHash.end() || entry.index_in_tx >= it->second->outputs.size()) {
+      return true;
+    }
+
+    const CryptoNote::TransactionOutput& output = it->second->outputs[entry.index_in_tx].output;
+    if (output.target.type() != typeid(CryptoNote::KeyOutput)) {
+      return true;
+    }
+
+    const Crypto::PublicKey& outputKey = boost::get<CryptoNote::KeyOutput>(output.target).key;
+    const Crypto::PublicKey* keys[] = { &outputKey };
+    if (!Crypto::check_tx_proof(proof.hash, proof.address.viewPublicKey, it->second->extra.publicKey, entry.shared_secret, entry.shared_secret_sig) ||
+        !Crypto::check_ring_signature(proof.hash, entry.key_image, keys, 1, &entry.key_image_sig)) {
+      return true;
+    }
+
+    entryValid[k] = 1;
+    Crypto::KeyDerivation derivation;
+    Crypto::PublicKey derivedKey;
+    if (Crypto::generate_key_derivation(entry.shared_secret, one, derivation) &&
+        Crypto::derive_public_key(derivation, entry.index_in_tx, proof.address.spendPublicKey, derivedKey) && derivedKey == outputKey) {
+      amounts[k] = output.amount;
+    }
+
+    return true;
+  }, _progress != nullptr ? &_progress->cancelled : nullptr, _progress != nullptr ? &_progress->done : nullptr, _threadCount);
+
+  for (size_t k = 0; k < entries.size(); ++k) {
+    ReserveProofCheckResult& result = results[entries[k].first];
+    if (isCancelled(_progress)) {
+      result.valid = false;
+      result.errorText = tr("Cancelled");
+    } else if (!entryValid[k]) {
+      result.valid = false;
+      result.errorText = tr("Invalid signature of an output");
+    }
+
+    result.total += amounts[k];
+  }
+
+  // A proof only shows a reserve as long as its outputs are unspent
+  std::vector<std::vector<std::pair<Crypto::KeyImage, uint64_t>>> provenOutputs(_requests.size());
+  for (size_t k = 0; k < entries.size(); ++k) {
+    if (amounts[k] > 0) {
+      provenOutputs[entries[k].first].emplace_back(decoded[entries[k].first].proof.proofs[entries[k].second].key_image, amounts[k]);
+    }
+  }
+
+  for (int i = 0; i < _requests.size(); ++i) {
+    if (!results[i].valid) {
+      continue;
+    }
+
+    const ReserveProofRequest& request = _requests[i];
+    uint64_t spent = 0;
+    if (!_node.getReserveProofSpent(request.address.toStdString(), request.message.toStdString(), request.proof.trimmed().toStdString(),
+        provenOutputs[i], spent)) {
+      results[i].valid = false;
+      results[i].errorText = tr("The node could not tell whether the outputs are spent");
+      continue;
+    }
+
+    results[i].spent = spent;
+  }
+
+  return results;
+}
+
+quint64 ReserveProof::generate(const CryptoNote::AccountKeys& _keys, const std::vector<CryptoNote::TransactionOutputInformation>& _outputs,
+  quint64 _reserve, const QString& _message) {
+  const std::string message = _message.toStdString();
+  startJob([this, _keys, _outputs, _reserve, message](quint64 _jobId) {
+    std::string proof;
+    QString errorText;
+    createProof(_keys, _outputs, _reserve, message, proof, errorText, &m_progress);
+    Q_EMIT proofGeneratedSignal(_jobId, QString::fromStdString(proof), errorText);
+  });
+
+  return m_jobId;
+}
+
+quint64 ReserveProof::verify(Node& _node, const QVector<ReserveProofRequest>& _requests) {
+  Node* node = &_node;
+  startJob([this, node, _requests](quint64 _jobId) {
+    QVector<ReserveProofCheckResult> results = checkProofs(*node, _requests, &m_progress);
+    Q_EMIT proofsCheckedSignal(_jobId, results);
+  });
+
+  return m_jobId;
+}
+
+void ReserveProof::cancel() {
+  m_progress.cancelled = true;
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+
+  m_progressTimer.stop();
+}
+
+bool ReserveProof::isRunning() const {
+  return m_running;
+}
+
+void ReserveProof::startJob(std::function<void(quint64)>&& _job) {
+  cancel();
+  m_progress.done = 0;
+  m_progress.total = 0;
+  m_progress.cancelled = false;
+  m_running = true;
+  const quint64 jobId = ++m_jobId;
+  m_thread = std::thread([this, jobId](std::function<void(quint64)> _job) {
+    _job(jobId);
+    m_running = false;
+  }, std::move(_job));
+
+  m_progressTimer.start();
+}
+
+void ReserveProof::updateProgress() {
+  Q_EMIT progressSignal(m_jobId, static_cast<int>(m_progress.done), static_cast<int>(m_progress.total));
+  if (!m_running) {
+    m_progressTimer.stop();
+  }
+}
+
+}
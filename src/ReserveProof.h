@@ -0,0 +1,90 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+#include "ITransfersContainer.h"
+
+namespace WalletGui {
+
+class Node;
+
+struct ReserveProofRequest {
+  QString address;
+  QString message;
+  QString proof;
+};
+
+struct ReserveProofCheckResult {
+  bool valid;
+  quint64 total;
+  // part of total the chain has spent since the proof was made
+  quint64 spent;
+  QString errorText;
+};
+
+// Creates and checks "ReserveProofV1" proofs, compatible with the ones of
+// WalletLegacy and the daemon's check_reserve_proof. The per output work is
+// spread over all cores; generate() and verify() run it off the GUI thread.
+class ReserveProof : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(ReserveProof)
+
+public:
+  struct Progress {
+    std::atomic<size_t> done;
+    std::atomic<size_t> total;
+    std::atomic<bool> cancelled;
+  };
+
+  explicit ReserveProof(QObject* _parent = nullptr);
+  ~ReserveProof();
+
+  // Fewest outputs covering _reserve, largest first
+  static std::vector<CryptoNote::TransactionOutputInformation> selectOutputs(std::vector<CryptoNote::TransactionOutputInformation> _outputs,
+    quint64 _reserve);
+  static bool createProof(const CryptoNote::AccountKeys& _keys, const std::vector<CryptoNote::TransactionOutputInformation>& _outputs,
+    quint64 _reserve, const std::string& _message, std::string& _proof, QString& _errorText, Progress* _progress = nullptr);
+  // Fetches all referenced transactions with a single node request, then asks the
+  // node which of the proven outputs are spent. _node is resolved by the caller on
+  // the GUI thread; a node that does not answer in time fails the check.
+  // _threadCount 0 uses all cores.
+  static QVector<ReserveProofCheckResult> checkProofs(Node& _node, const QVector<ReserveProofRequest>& _requests,
+    Progress* _progress = nullptr, size_t _threadCount = 0);
+
+  quint64 generate(const CryptoNote::AccountKeys& _keys, const std::vector<CryptoNote::TransactionOutputInformation>& _outputs,
+    quint64 _reserve, const QString& _message);
+  quint64 verify(Node& _node, const QVector<ReserveProofRequest>& _requests);
+  void cancel();
+  bool isRunning() const;
+
+private:
+  std::thread m_thread;
+  std::atomic<bool> m_running;
+  Progress m_progress;
+  quint64 m_jobId;
+  QTimer m_progressTimer;
+
+  void startJob(std::function<void(quint64)>&& _job);
+  void updateProgress();
+
+Q_SIGNALS:
+  void progressSignal(quint64 _jobId, int _done, int _total);
+  void proofGeneratedSignal(quint64 _jobId, const QString& _proof, const QString& _errorText);
+  void proofsCheckedSignal(quint64 _jobId, const QVector<WalletGui::ReserveProofCheckResult>& _results);
+};
+
+}
@@ -29,6 +29,8 @@ Q_DECL_CONSTEXPR char OPTION_CONNECTIONS[] = "connectionsCount";
 Q_DECL_CONSTEXPR char OPTION_RPCNODES[] = "remoteNodes";
 Q_DECL_CONSTEXPR char OPTION_DAEMON_PORT[] = "daemonPort";
 Q_DECL_CONSTEXPR char OPTION_REMOTE_NODE[] = "remoteNode";
+Q_DECL_CONSTEXPR char OPTION_NODE_RTT[] = "nodeRtt";
+Q_DECL_CONSTEXPR char OPTION_LAST_AUTO_EMBEDDED[] = "lastAutoConnectionEmbedded";
 const char OPTION_WALLET_THEME[] = "theme";
 
 const char OPTION_WALLET_OPTIMIZATION[] = "optimization";
@@ -197,6 +199,51 @@ QStringList Settings::getSeedNodes() const {
   return m_cmdLineParser->getSeedNodes();
 }
 
+QString Settings::getRecordNodeFile() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->getRecordNodeFile();
+}
+
+QString Settings::getReplayNodeFile() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->getReplayNodeFile();
+}
+
+QString Settings::getFailoverCheckFile() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->getFailoverCheckFile();
+}
+
+QString Settings::getBootstrapFile() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->getBootstrapFile();
+}
+
+quint32 Settings::getReplayLatency() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->getReplayLatency();
+}
+
+quint32 Settings::getReplayThroughput() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->getReplayThroughput();
+}
+
+bool Settings::isSyncBenchmark() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->hasSyncBenchmarkOption();
+}
+
+bool Settings::isMiningBenchmark() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->hasMiningBenchmarkOption();
+}
+
+bool Settings::isMiningSelfTest() const {
+  Q_ASSERT(m_cmdLineParser != nullptr);
+  return m_cmdLineParser->hasMiningSelfTestOption();
+}
+
 QDir Settings::getDataDir() const {
   Q_CHECK_PTR(m_cmdLineParser);
   return QDir(m_cmdLineParser->getDataDir());
@@ -313,6 +360,15 @@ NodeSetting Settings::getCurrentRemoteNode() const {
   return remotenode;
 }
 
+quint32 Settings::getNodeRtt(const NodeSetting& _node) const {
+  const QString key = QString("%1:%2").arg(_node.host).arg(_node.port);
+  return m_settings.value(OPTION_NODE_RTT).toObject().value(key).toVariant().toUInt();
+}
+
+bool Settings::isLastAutoConnectionEmbedded() const {
+  return m_settings.value(OPTION_LAST_AUTO_EMBEDDED).toBool();
+}
+
 quint16 Settings::getMiningThreads() const {
   if (m_settings.contains("miningThreads")) {
     return m_settings.value("miningThreads").toVariant().toInt();
@@ -321,10 +377,38 @@ quint16 Settings::getMiningThreads() const {
   }
 }
 
+quint32 Settings::getMiningHashWays() const {
+  return m_settings.contains("miningHashWays") ? m_settings.value("miningHashWays").toVariant().toUInt() : 1;
+}
+
+QTime Settings::getMiningStartTime() const {
+  return m_settings.contains("miningStartTime") ? QTime::fromString(m_settings.value("miningStartTime").toString(), Qt::ISODate) : QTime(0, 0);
+}
+
+QTime Settings::getMiningStopTime() const {
+  return m_settings.contains("miningStopTime") ? QTime::fromString(m_settings.value("miningStopTime").toString(), Qt::ISODate) : QTime(0, 0);
+}
+
 bool Settings::isMiningOnLaunchEnabled() const {
   return m_settings.contains("autostartMininig") ? m_settings.value("autostartMininig").toBool() : false;
 }
 
+bool Settings::isMiningThreadPinningEnabled() const {
+  return m_settings.contains("miningPinThreads") ? m_settings.value("miningPinThreads").toBool() : false;
+}
+
+bool Settings::isMiningSkipSmtEnabled() const {
+  return m_settings.contains("miningSkipSmt") ? m_settings.value("miningSkipSmt").toBool() : false;
+}
+
+bool Settings::isMiningGovernorEnabled() const {
+  return m_settings.contains("miningGovernor") ? m_settings.value("miningGovernor").toBool() : false;
+}
+
+bool Settings::isMiningScheduleEnabled() const {
+  return m_settings.contains("miningSchedule") ? m_settings.value("miningSchedule").toBool() : false;
+}
+
 bool Settings::isStartOnLoginEnabled() const {
   bool res = false;
 #ifdef Q_OS_MAC
@@ -596,6 +680,48 @@ void Settings::setMiningOnLaunchEnabled(bool _automining) {
   }
 }
 
+void Settings::setMiningThreadPinningEnabled(bool _enable) {
+  if (isMiningThreadPinningEnabled() != _enable) {
+    m_settings.insert("miningPinThreads", _enable);
+    saveSettings();
+  }
+}
+
+void Settings::setMiningSkipSmtEnabled(bool _enable) {
+  if (isMiningSkipSmtEnabled() != _enable) {
+    m_settings.insert("miningSkipSmt", _enable);
+    saveSettings();
+  }
+}
+
+void Settings::setMiningGovernorEnabled(bool _enable) {
+  if (isMiningGovernorEnabled() != _enable) {
+    m_settings.insert("miningGovernor", _enable);
+    saveSettings();
+  }
+}
+
+void Settings::setMiningScheduleEnabled(bool _enable) {
+  if (isMiningScheduleEnabled() != _enable) {
+    m_settings.insert("miningSchedule", _enable);
+    saveSettings();
+  }
+}
+
+void Settings::setMiningStartTime(const QTime& _startTime) {
+  if (getMiningStartTime() != _startTime) {
+    m_settings.insert("miningStartTime", _startTime.toString(Qt::ISODate));
+    saveSettings();
+  }
+}
+
+void Settings::setMiningStopTime(const QTime& _stopTime) {
+  if (getMiningStopTime() != _stopTime) {
+    m_settings.insert("miningStopTime", _stopTime.toString(Qt::ISODate));
+    saveSettings();
+  }
+}
+
 void Settings::setCurrentTheme(const QString& _theme) {
 }
 
@@ -687,6 +813,30 @@ void Settings::setCurrentRemoteNode(const NodeSetting &remoteNode) {
   saveSettings();
 }
 
+void Settings::setNodeRtts(const QVector<QPair<NodeSetting, quint32>>& _rtts) {
+  QJsonObject rtts = m_settings.value(OPTION_NODE_RTT).toObject();
+  bool changed = false;
+  for (const QPair<NodeSetting, quint32>& rtt : _rtts) {
+    const QString key = QString("%1:%2").arg(rtt.first.host).arg(rtt.first.port);
+    if (rtts.value(key).toVariant().toUInt() != rtt.second) {
+      rtts.insert(key, static_cast<qint64>(rtt.second));
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    m_settings.insert(OPTION_NODE_RTT, rtts);
+    saveSettings();
+  }
+}
+
+void Settings::setLastAutoConnectionEmbedded(bool _embedded) {
+  if (_embedded != isLastAutoConnectionEmbedded()) {
+    m_settings.insert(OPTION_LAST_AUTO_EMBEDDED, _embedded);
+    saveSettings();
+  }
+}
+
 void Settings::setRpcNodesList(const QVector<NodeSetting> &RpcNodesList) {
   if (!RpcNodesList.isEmpty()) {
     QJsonArray nodesList;
@@ -710,6 +860,13 @@ void Settings::setMiningThreads(const quint16& _threads) {
   saveSettings();
 }
 
+void Settings::setMiningHashWays(quint32 _ways) {
+  if (getMiningHashWays() != _ways) {
+    m_settings.insert("miningHashWays", static_cast<int>(_ways));
+    saveSettings();
+  }
+}
+
 #ifdef Q_OS_WIN
 void Settings::setMinimizeToTrayEnabled(bool _enable) {
   if (isMinimizeToTrayEnabled() != _enable) {
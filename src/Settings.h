@@ -51,6 +51,15 @@ public:
   QStringList getPeers() const;
   QStringList getPriorityNodes() const;
   QStringList getSeedNodes() const;
+  QString getRecordNodeFile() const;
+  QString getReplayNodeFile() const;
+  QString getFailoverCheckFile() const;
+  QString getBootstrapFile() const;
+  quint32 getReplayLatency() const;
+  quint32 getReplayThroughput() const;
+  bool isSyncBenchmark() const;
+  bool isMiningBenchmark() const;
+  bool isMiningSelfTest() const;
 
   QString getWalletFile() const;
   QString getWalletName() const;
@@ -62,7 +71,12 @@ public:
   QVector<NodeSetting> getRpcNodesList() const;
   quint16 getCurrentLocalDaemonPort() const;
   NodeSetting getCurrentRemoteNode() const;
+  quint32 getNodeRtt(const NodeSetting& _node) const;
+  bool isLastAutoConnectionEmbedded() const;
   quint16 getMiningThreads() const;
+  quint32 getMiningHashWays() const;
+  QTime getMiningStartTime() const;
+  QTime getMiningStopTime() const;
   QString getCurrentTheme() const;
 
   bool isOptimizationEnabled() const;
@@ -84,6 +98,10 @@ public:
   bool isEncrypted() const;
   bool isStartOnLoginEnabled() const;
   bool isMiningOnLaunchEnabled() const;
+  bool isMiningThreadPinningEnabled() const;
+  bool isMiningSkipSmtEnabled() const;
+  bool isMiningGovernorEnabled() const;
+  bool isMiningScheduleEnabled() const;
   bool isTrackingMode() const;
   bool skipFusionTransactions() const;
   bool hideEverythingOnLocked() const;
@@ -100,12 +118,22 @@ public:
   void setLanguage(const QString& _language);
   void setStartOnLoginEnabled(bool _enable);
   void setMiningOnLaunchEnabled(bool _enable);
+  void setMiningThreadPinningEnabled(bool _enable);
+  void setMiningSkipSmtEnabled(bool _enable);
+  void setMiningGovernorEnabled(bool _enable);
+  void setMiningScheduleEnabled(bool _enable);
+  void setMiningStartTime(const QTime& _startTime);
+  void setMiningStopTime(const QTime& _stopTime);
   void setConnection(const QString& _connection);
   void setConnectionsCount(const quint16& _count);
   void setCurrentLocalDaemonPort(const quint16& _daemonPort);
   void setCurrentRemoteNode(const NodeSetting &remoteNode);
   void setRpcNodesList(const QVector<NodeSetting> &RpcNodesList);
+  // All round trips of a probe, written to the file at once
+  void setNodeRtts(const QVector<QPair<NodeSetting, quint32>>& _rtts);
+  void setLastAutoConnectionEmbedded(bool _embedded);
   void setMiningThreads(const quint16& _threads);
+  void setMiningHashWays(quint32 _ways);
 #ifdef Q_OS_WIN
   void setMinimizeToTrayEnabled(bool _enable);
   void setCloseToTrayEnabled(bool _enable);
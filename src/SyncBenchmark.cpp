@@ -0,0 +1,116 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "SyncBenchmark.h"
+#include "LoggerAdapter.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+// The event loop is expected to wake up this often, any delay beyond is latency
+const int TICK_INTERVAL = 10;
+
+}
+
+SyncBenchmark::SyncBenchmark(QObject* _parent) : QObject(_parent), m_firstHeight(0), m_lastHeight(0), m_firstProgressTime(-1),
+  m_maxLatency(0), m_totalLatency(0), m_ticks(0), m_finished(false) {
+  m_tickTimer.setTimerType(Qt::PreciseTimer);
+  m_tickTimer.setInterval(TICK_INTERVAL);
+  connect(&m_tickTimer, &QTimer::timeout, this, &SyncBenchmark::tick);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationProgressUpdatedSignal, this, &SyncBenchmark::synchronizationProgressUpdated);
+  connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationCompletedSignal, this, &SyncBenchmark::synchronizationCompleted);
+}
+
+SyncBenchmark::~SyncBenchmark() {
+}
+
+void SyncBenchmark::start() {
+  m_clock.start();
+  m_tickClock.start();
+  m_tickTimer.start();
+}
+
+quint64 SyncBenchmark::peakResidentMemory() {
+#ifdef Q_OS_WIN
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return counters.PeakWorkingSetSize;
+  }
+
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+
+#ifdef Q_OS_MAC
+  return usage.ru_maxrss;
+#else
+  return static_cast<quint64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void SyncBenchmark::tick() {
+  const qint64 latency = std::max<qint64>(m_tickClock.restart() - TICK_INTERVAL, 0);
+  m_maxLatency = std::max(m_maxLatency, latency);
+  m_totalLatency += latency;
+  ++m_ticks;
+}
+
+void SyncBenchmark::synchronizationProgressUpdated(quint64 _current, quint64 _total) {
+  Q_UNUSED(_total);
+  if (m_firstProgressTime < 0) {
+    m_firstProgressTime = m_clock.elapsed();
+    m_firstHeight = _current;
+  }
+
+  m_lastHeight = std::max(m_lastHeight, _current);
+}
+
+void SyncBenchmark::synchronizationCompleted(int _error, const QString& _errorText) {
+  if (m_finished) {
+    return;
+  }
+
+  m_finished = true;
+  m_tickTimer.stop();
+  if (_error != 0) {
+    LoggerAdapter::instance().log(QString("Sync benchmark failed: %1").arg(_errorText).toStdString());
+  }
+
+  report();
+  QCoreApplication::quit();
+}
+
+void SyncBenchmark::report() {
+  const qint64 elapsed = m_clock.elapsed();
+  const qint64 syncTime = m_firstProgressTime < 0 ? elapsed : elapsed - m_firstProgressTime;
+  const quint64 blocks = m_lastHeight - m_firstHeight;
+  const double blocksPerSecond = syncTime > 0 ? blocks * 1000.0 / syncTime : 0;
+  const double meanLatency = m_ticks > 0 ? static_cast<double>(m_totalLatency) / m_ticks : 0;
+
+  const QString text = QString("Sync benchmark: %1 blocks in %2 s, %3 blocks/s, total %4 s, peak RSS %5 MiB, event loop latency mean %6 ms, max %7 ms").
+    arg(blocks).arg(syncTime / 1000.0, 0, 'f', 2).arg(blocksPerSecond, 0, 'f', 1).arg(elapsed / 1000.0, 0, 'f', 2).
+    arg(peakResidentMemory() / (1024.0 * 1024.0), 0, 'f', 1).arg(meanLatency, 0, 'f', 2).arg(m_maxLatency);
+  LoggerAdapter::instance().log(text.toStdString());
+  QTextStream(stdout) << text << endl;
+}
+
+}
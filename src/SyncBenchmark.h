@@ -0,0 +1,46 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+namespace WalletGui {
+
+// Measures a wallet sync from start to the first completed synchronization:
+// blocks per second, peak resident memory and GUI event loop latency. The
+// report goes to the log and stdout, then the application quits.
+class SyncBenchmark : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(SyncBenchmark)
+
+public:
+  explicit SyncBenchmark(QObject* _parent);
+  ~SyncBenchmark();
+
+  void start();
+
+  static quint64 peakResidentMemory();
+
+private:
+  QElapsedTimer m_clock;
+  QElapsedTimer m_tickClock;
+  QTimer m_tickTimer;
+  quint64 m_firstHeight;
+  quint64 m_lastHeight;
+  qint64 m_firstProgressTime;
+  qint64 m_maxLatency;
+  qint64 m_totalLatency;
+  quint64 m_ticks;
+  bool m_finished;
+
+  void tick();
+  void synchronizationProgressUpdated(quint64 _current, quint64 _total);
+  void synchronizationCompleted(int _error, const QString& _errorText);
+  void report();
+};
+
+}
@@ -12,6 +12,11 @@
 #include <QLocale>
 #include <QVector>
 #include <QDebug>
+#include <QHostAddress>
+#include <QTcpServer>
+
+#include <algorithm>
+#include <map>
 
 #include <boost/filesystem.hpp>
 
@@ -31,6 +36,9 @@
 #include "gui/VerifyMnemonicSeedDialog.h"
 #include "CurrencyAdapter.h"
 #include "LoggerAdapter.h"
+#include "MessageSigner.h"
+#include "ReserveProof.h"
+#include "WalletRpcService.h"
 
 extern "C"
 {
@@ -48,12 +56,17 @@ const quint32 MSECS_IN_MINUTE = 60 * 1000;
 const quint32 LAST_BLOCK_INFO_UPDATING_INTERVAL = 1 * MSECS_IN_MINUTE;
 const quint32 LAST_BLOCK_INFO_WARNING_INTERVAL = 1 * MSECS_IN_HOUR;
 
+const size_t DECOY_PREFETCH_MAX_AMOUNTS = 32;
+const quint32 RPC_SNAPSHOT_UPDATE_DELAY = 250;
+// Another program may take the probed backend port before wallet_rpc_server binds it
+const int RPC_BACKEND_BIND_ATTEMPTS = 5;
+
 WalletAdapter& WalletAdapter::instance() {
   static WalletAdapter inst;
   return inst;
 }
 
-WalletAdapter::WalletAdapter() : QObject(), m_wallet(nullptr), m_mutex(), m_isBackupInProgress(false),
+WalletAdapter::WalletAdapter() : QObject(), m_wallet(nullptr), m_wallet_rpc(nullptr), m_walletRpcService(nullptr), m_mutex(), m_isBackupInProgress(false),
   m_syncSpeed(0), m_syncPeriod(0), m_isSynchronized(false), m_newTransactionsNotificationTimer(),
   m_lastWalletTransactionId(std::numeric_limits<quint64>::max()),
   m_logger(LoggerAdapter::instance().getLoggerManager(), "WalletAdapter")
@@ -72,10 +85,41 @@ WalletAdapter::WalletAdapter() : QObject(), m_wallet(nullptr), m_mutex(), m_isBa
   connect(this, &WalletAdapter::walletSynchronizationCompletedSignal, this, [&]() {
     m_newTransactionsNotificationTimer.stop();
     notifyAboutLastTransaction();
+    prefetchDecoys();
   }, Qt::QueuedConnection);
+  connect(this, &WalletAdapter::walletActualBalanceUpdatedSignal, this, &WalletAdapter::prefetchDecoys, Qt::QueuedConnection);
 
   m_newTransactionsNotificationTimer.setInterval(500);
 
+  // Coalesce wallet updates into one snapshot update for the RPC readers,
+  // which rebuilds only the transactions that changed meanwhile
+  m_rpcSnapshotTimer.setSingleShot(true);
+  m_rpcSnapshotTimer.setInterval(RPC_SNAPSHOT_UPDATE_DELAY);
+  connect(&m_rpcSnapshotTimer, &QTimer::timeout, this, [this]() { updateRpcSnapshot(0); });
+  auto scheduleRpcSnapshot = [this]() {
+    if (m_walletRpcService != nullptr && !m_rpcSnapshotTimer.isActive()) {
+      m_rpcSnapshotTimer.start();
+    }
+  };
+  auto transactionChanged = [this, scheduleRpcSnapshot](CryptoNote::TransactionId _id) {
+    if (m_walletRpcService != nullptr) {
+      m_rpcChangedTransactions.insert(_id);
+      scheduleRpcSnapshot();
+    }
+  };
+  connect(this, &WalletAdapter::walletActualBalanceUpdatedSignal, this, scheduleRpcSnapshot, Qt::QueuedConnection);
+  connect(this, &WalletAdapter::walletPendingBalanceUpdatedSignal, this, scheduleRpcSnapshot, Qt::QueuedConnection);
+  connect(this, &WalletAdapter::walletTransactionCreatedSignal, this, transactionChanged, Qt::QueuedConnection);
+  connect(this, &WalletAdapter::walletTransactionUpdatedSignal, this, transactionChanged, Qt::QueuedConnection);
+  connect(this, &WalletAdapter::walletSynchronizationCompletedSignal, this, scheduleRpcSnapshot, Qt::QueuedConnection);
+  // transaction ids start over after a reset, nothing of the old snapshot is kept
+  connect(this, &WalletAdapter::reloadWalletTransactionsSignal, this, [this]() {
+    if (m_walletRpcService != nullptr && m_wallet != nullptr) {
+      m_rpcChangedTransactions.clear();
+      m_walletRpcService->publishSnapshot(WalletRpcService::makeSnapshot());
+    }
+  }, Qt::QueuedConnection);
+
   // init wallet rpc config
   bool no = false;
   std::string dummy = "";
@@ -278,11 +322,7 @@ void WalletAdapter::close() {
   Q_EMIT walletCloseCompletedSignal();
   QCoreApplication::processEvents();
 
-  if (m_wallet_rpc != nullptr) {
-    m_wallet_rpc->stop();
-    delete m_wallet_rpc;
-    m_wallet_rpc = nullptr;
-  }
+  stopWalletRpc();
 
   delete m_wallet;
   m_wallet = nullptr;
@@ -424,7 +464,7 @@ std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getLockedOu
 std::vector<CryptoNote::TransactionOutputInformation> WalletAdapter::getUnlockedOutputs() {
   Q_CHECK_PTR(m_wallet);
   try {
-    return m_wallet->getLockedOutputs();
+    return m_wallet->getUnlockedOutputs();
   } catch (std::system_error&) {
   }
   return {};
@@ -439,19 +479,20 @@ std::vector<CryptoNote::TransactionSpentOutputInformation> WalletAdapter::getSpe
   return {};
 }
 
-void WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
+CryptoNote::TransactionId WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
   Q_CHECK_PTR(m_wallet);
   try {
     lock();
     Q_EMIT walletStateChangedSignal(tr("Sending transaction"));
-    m_wallet->sendTransaction(_transfers, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0);
+    return m_wallet->sendTransaction(_transfers, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0);
   } catch (std::system_error&) {
     unlock();
   }
+  return CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID;
 }
 
 // Prerequisites: deduce fee from transfers, selected outs amount and tansfers amount + fee should match
-void WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
+CryptoNote::TransactionId WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
   Q_CHECK_PTR(m_wallet);
 
   // can validate here that transfer amount + fee = selected outs amounts
@@ -459,10 +500,11 @@ void WalletAdapter::sendTransaction(const std::vector<CryptoNote::WalletLegacyTr
   try {
     lock();
     Q_EMIT walletStateChangedSignal(tr("Sending transaction"));
-    m_wallet->sendTransaction(_transfers, _selectedOuts, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0);
+    return m_wallet->sendTransaction(_transfers, _selectedOuts, _fee, NodeAdapter::instance().convertPaymentId(_payment_id), _mixin, 0);
   } catch (std::system_error&) {
     unlock();
   }
+  return CryptoNote::WALLET_LEGACY_INVALID_TRANSACTION_ID;
 }
 
 QString WalletAdapter::prepareRawTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin) {
@@ -567,23 +609,103 @@ void WalletAdapter::initCompleted(std::error_code _error) {
 }
 
 void WalletAdapter::runWalletRpc() {
-  auto& dispatcher = NodeAdapter::instance().getDispatcher();
+  // wallet_rpc_server only listens on loopback, clients are served by WalletRpcService.
+  // It takes a port number, not a bound socket, so a free port is probed first and a
+  // port taken in between makes the bind fail, then another one is probed.
   const std::string walletFilename = Settings::instance().getWalletFile().toStdString();
-  m_wallet_rpc = new Tools::wallet_rpc_server(/*dispatcher,*/
-                                              LoggerAdapter::instance().getLoggerManager(),
-                                              *m_wallet,
-                                              *NodeAdapter::instance().getNode(),
-                                              CurrencyAdapter::instance().getCurrency(),
-                                              walletFilename);
-  if (!m_wallet_rpc->init(m_wrpcOptions))
-    m_logger(Logging::ERROR) << "Failed to initialize wallet rpc server";
-  bool enable_ssl;
-  std::string bind_address, bind_address_ssl, ssl_info;
-  m_wallet_rpc->getServerConf(bind_address, bind_address_ssl, enable_ssl);
-  if (enable_ssl) ssl_info += std::string(", SSL on address ") + bind_address_ssl;
-    m_logger(Logging::INFO) << "Starting wallet rpc server on address " << bind_address << ssl_info;
-
-  m_wallet_rpc->run();
+  uint16_t backendPort = 0;
+  for (int attempt = 1; ; ++attempt) {
+    if (attempt > RPC_BACKEND_BIND_ATTEMPTS) {
+      m_logger(Logging::ERROR) << "Failed to bind wallet rpc server to a loopback port";
+      return;
+    }
+
+    QTcpServer portProbe;
+    if (!portProbe.listen(QHostAddress::LocalHost, 0)) {
+      m_logger(Logging::ERROR) << "Failed to find a free port for wallet rpc server";
+      return;
+    }
+
+    backendPort = portProbe.serverPort();
+    portProbe.close();
+
+    boost::program_options::variables_map backendOptions = m_wrpcOptions;
+    backendOptions.erase("rpc-bind-ip");
+    backendOptions.erase("rpc-bind-port");
+    backendOptions.insert(std::make_pair("rpc-bind-ip", boost::program_options::variable_value(std::string("127.0.0.1"), false)));
+    backendOptions.insert(std::make_pair("rpc-bind-port", boost::program_options::variable_value(backendPort, false)));
+
+    m_wallet_rpc = new Tools::wallet_rpc_server(/*dispatcher,*/
+                                                LoggerAdapter::instance().getLoggerManager(),
+                                                *m_wallet,
+                                                *NodeAdapter::instance().getNode(),
+                                                CurrencyAdapter::instance().getCurrency(),
+                                                walletFilename);
+    if (!m_wallet_rpc->init(backendOptions)) {
+      m_logger(Logging::ERROR) << "Failed to initialize wallet rpc server";
+      delete m_wallet_rpc;
+      m_wallet_rpc = nullptr;
+      return;
+    }
+
+    try {
+      m_wallet_rpc->run();
+      break;
+    } catch (std::exception& e) {
+      m_logger(Logging::WARNING) << "Wallet rpc server could not bind port " << backendPort << ": " << e.what();
+      delete m_wallet_rpc;
+      m_wallet_rpc = nullptr;
+    }
+  }
+
+  m_walletRpcService = new WalletRpcService(Settings::instance().getWalletRpcBindIp(),
+                                            static_cast<quint16>(Settings::instance().getWalletRpcBindPort()),
+                                            backendPort,
+                                            Settings::instance().getWalletRpcUser(),
+                                            Settings::instance().getWalletRpcPassword());
+  m_rpcChangedTransactions.clear();
+  m_walletRpcService->publishSnapshot(WalletRpcService::makeSnapshot());
+  connect(m_walletRpcService, &WalletRpcService::snapshotRequestedSignal, this, &WalletAdapter::updateRpcSnapshot, Qt::QueuedConnection);
+  if (!m_walletRpcService->start()) {
+    m_logger(Logging::ERROR) << "Failed to start wallet rpc server on " << Settings::instance().getWalletRpcBindIp().toStdString() <<
+      ":" << Settings::instance().getWalletRpcBindPort();
+    stopWalletRpc();
+    return;
+  }
+
+  m_logger(Logging::INFO) << "Starting wallet rpc server on address " << Settings::instance().getWalletRpcBindIp().toStdString() <<
+    ":" << Settings::instance().getWalletRpcBindPort();
+}
+
+void WalletAdapter::stopWalletRpc() {
+  m_rpcSnapshotTimer.stop();
+  m_rpcChangedTransactions.clear();
+  if (m_walletRpcService != nullptr) {
+    m_walletRpcService->stop();
+    delete m_walletRpcService;
+    m_walletRpcService = nullptr;
+  }
+
+  if (m_wallet_rpc != nullptr) {
+    m_wallet_rpc->stop();
+    delete m_wallet_rpc;
+    m_wallet_rpc = nullptr;
+  }
+}
+
+void WalletAdapter::updateRpcSnapshot(quint64 _ticket) {
+  if (m_walletRpcService == nullptr) {
+    return;
+  }
+
+  // A write waiting for its snapshot is answered even without a wallet
+  std::shared_ptr<const WalletRpcSnapshot> snapshot = m_walletRpcService->snapshot();
+  if (m_wallet != nullptr) {
+    snapshot = WalletRpcService::updateSnapshot(snapshot, m_rpcChangedTransactions);
+    m_rpcChangedTransactions.clear();
+  }
+
+  m_walletRpcService->publishSnapshot(snapshot, _ticket);
 }
 
 void WalletAdapter::onWalletInitCompleted(int _error, const QString& _errorText) {
@@ -785,6 +907,33 @@ void WalletAdapter::transactionUpdated(CryptoNote::TransactionId _transactionId)
   Q_EMIT walletTransactionUpdatedSignal(_transactionId);
 }
 
+void WalletAdapter::prefetchDecoys() {
+  if (m_wallet == nullptr || !m_isSynchronized) {
+    return;
+  }
+
+  // Mixins for the outputs we are most likely to spend next
+  std::map<uint64_t, size_t> counts;
+  for (const CryptoNote::TransactionOutputInformation& output : getUnlockedOutputs()) {
+    ++counts[output.amount];
+  }
+
+  std::vector<std::pair<size_t, uint64_t>> byCount;
+  for (const auto& kv : counts) {
+    byCount.push_back(std::make_pair(kv.second, kv.first));
+  }
+
+  std::sort(byCount.rbegin(), byCount.rend());
+  std::vector<uint64_t> amounts;
+  for (size_t i = 0; i < byCount.size() && i < DECOY_PREFETCH_MAX_AMOUNTS; ++i) {
+    amounts.push_back(byCount[i].second);
+  }
+
+  if (!amounts.empty()) {
+    NodeAdapter::instance().prefetchRandomOuts(amounts);
+  }
+}
+
 void WalletAdapter::lock() {
   m_mutex.lock();
 }
@@ -929,7 +1078,15 @@ QString WalletAdapter::getReserveProof(const quint64 &_reserve, const QString &_
     } else {
       amount = _reserve;
     }
-    const std::string sig_str = m_wallet->getReserveProof(amount, (!_message.isEmpty() ? _message.toStdString() : ""));
+    CryptoNote::AccountKeys keys;
+    m_wallet->getAccountKeys(keys);
+    std::string sig_str;
+    QString errorText;
+    if (!ReserveProof::createProof(keys, getUnlockedOutputs(), amount, _message.toStdString(), sig_str, errorText)) {
+      QMessageBox::critical(nullptr, tr("Failed to get the reserve proof"), errorText, QMessageBox::Ok);
+      return QString();
+    }
+
     return QString::fromStdString(sig_str);
   } catch (std::system_error&) {
     QMessageBox::critical(nullptr, tr("Failed to get the reserve proof"), tr("Failed to get the reserve proof."), QMessageBox::Ok);
@@ -954,6 +1111,21 @@ bool WalletAdapter::verifyMessage(const QString &data, const CryptoNote::Account
   return m_wallet->verify_message(data.toStdString(), address, signature.toStdString());
 }
 
+QStringList WalletAdapter::signMessages(const QStringList& _messages) {
+  Q_CHECK_PTR(m_wallet);
+  if(Settings::instance().isTrackingMode()) {
+    QMessageBox::critical(nullptr, tr("Failed to sign message"), tr("This is tracking wallet. The message can be signed only by a full wallet."), QMessageBox::Ok);
+    return QStringList();
+  }
+
+  CryptoNote::AccountKeys keys;
+  if (!getAccountKeys(keys)) {
+    return QStringList();
+  }
+
+  return MessageSigner::signBatch(keys, _messages);
+}
+
 size_t WalletAdapter::getUnlockedOutputsCount() {
   Q_CHECK_PTR(m_wallet);
   try {
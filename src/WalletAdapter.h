@@ -11,6 +11,8 @@
 #include <QTime>
 #include <QTimer>
 #include <QPushButton>
+#include <QSet>
+#include <QStringList>
 
 #include <list>
 #include <vector>
@@ -25,6 +27,7 @@
 namespace WalletGui {
 
 class ITransfersContainer;
+class WalletRpcService;
 
 class WalletAdapter : public QObject, public CryptoNote::IWalletLegacyObserver {
   Q_OBJECT
@@ -63,8 +66,8 @@ public:
   std::vector<CryptoNote::TransactionOutputInformation> getUnlockedOutputs();
   std::vector<CryptoNote::TransactionSpentOutputInformation> getSpentOutputs();
 
-  void sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin);
-  void sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
+  CryptoNote::TransactionId sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin);
+  CryptoNote::TransactionId sendTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
 
   QString prepareRawTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, quint64 _fee, const QString& _payment_id, quint64 _mixin);
   QString prepareRawTransaction(const std::vector<CryptoNote::WalletLegacyTransfer>& _transfers, const std::list<CryptoNote::TransactionOutputInformation>& _selectedOuts, quint64 _fee, const QString& _payment_id, quint64 _mixin);
@@ -81,6 +84,7 @@ public:
 
   QString signMessage(const QString &data);
   bool verifyMessage(const QString &data, const CryptoNote::AccountPublicAddress &address, const QString &signature);
+  QStringList signMessages(const QStringList& _messages);
 
   void initCompleted(std::error_code _result) Q_DECL_OVERRIDE;
   void saveCompleted(std::error_code _result) Q_DECL_OVERRIDE;
@@ -103,6 +107,9 @@ private:
   std::fstream m_file;
   CryptoNote::IWalletLegacy* m_wallet;
   Tools::wallet_rpc_server* m_wallet_rpc;
+  WalletRpcService* m_walletRpcService;
+  QTimer m_rpcSnapshotTimer;
+  QSet<CryptoNote::TransactionId> m_rpcChangedTransactions;
   QMutex m_mutex;
   std::atomic<bool> m_isBackupInProgress;
   std::atomic<bool> m_isSynchronized;
@@ -132,6 +139,9 @@ private:
   void notifyAboutLastTransaction();
   QString walletErrorMessage(int _error_code);
   void runWalletRpc();
+  void stopWalletRpc();
+  void updateRpcSnapshot(quint64 _ticket);
+  void prefetchDecoys();
 
   static void renameFile(const QString& _old_name, const QString& _new_name);
   Q_SLOT void updateBlockStatusText();
@@ -0,0 +1,555 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRunnable>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Common/StringTools.h"
+#include "WalletRpcService.h"
+#include "MessageSigner.h"
+#include "NodeAdapter.h"
+#include "ReserveProof.h"
+#include "WalletAdapter.h"
+
+namespace WalletGui {
+
+namespace {
+
+const int RPC_WORKER_THREADS = 4;
+const int MAX_REQUEST_SIZE = 1024 * 1024;
+
+QJsonObject makeResult(const QJsonValue& _id, const QJsonObject& _result) {
+  QJsonObject response;
+  response.insert("jsonrpc", "2.0");
+  response.insert("id", _id);
+  response.insert("result", _result);
+  return response;
+}
+
+QJsonObject makeError(const QJsonValue& _id, int _code, const QString& _message) {
+  QJsonObject error;
+  error.insert("code", _code);
+  error.insert("message", _message);
+  QJsonObject response;
+  response.insert("jsonrpc", "2.0");
+  response.insert("id", _id);
+  response.insert("error", error);
+  return response;
+}
+
+class ReadRequestTask : public QRunnable {
+public:
+  ReadRequestTask(WalletRpcService* _service, quint64 _clientId, const QString& _method, const QJsonObject& _request,
+    std::shared_ptr<const WalletRpcSnapshot> _snapshot, qint64 _startedAt) :
+    m_service(_service), m_clientId(_clientId), m_method(_method), m_request(_request), m_snapshot(_snapshot), m_startedAt(_startedAt) {
+  }
+
+  void run() override {
+    QJsonObject response = WalletRpcService::executeReadRequest(*m_snapshot, m_request);
+    QByteArray body = QJsonDocument(response).toJson(QJsonDocument::Compact);
+    QMetaObject::invokeMethod(m_service, "readRequestCompleted", Qt::QueuedConnection, Q_ARG(quint64, m_clientId),
+      Q_ARG(QString, m_method), Q_ARG(QByteArray, body), Q_ARG(qint64, m_startedAt));
+  }
+
+private:
+  WalletRpcService* m_service;
+  quint64 m_clientId;
+  QString m_method;
+  QJsonObject m_request;
+  std::shared_ptr<const WalletRpcSnapshot> m_snapshot;
+  qint64 m_startedAt;
+};
+
+}
+
+WalletRpcService::WalletRpcService(const QString& _bindIp, quint16 _bindPort, quint16 _backendPort, const QString& _user, const QString& _password) :
+  QObject(), m_bindIp(_bindIp), m_bindPort(_bindPort), m_backendPort(_backendPort),
+  m_authorization(_user.isEmpty() ? QByteArray() : "Basic " + QString("%1:%2").arg(_user).arg(_password).toUtf8().toBase64()),
+  m_server(nullptr), m_backend(nullptr), m_nextClientId(0), m_writeInProgress(false), m_lastTicket(0), m_publishedTicket(0) {
+  m_workers.setMaxThreadCount(RPC_WORKER_THREADS);
+  m_clock.start();
+}
+
+WalletRpcService::~WalletRpcService() {
+  stop();
+}
+
+bool WalletRpcService::start() {
+  if (m_thread.isRunning()) {
+    return true;
+  }
+
+  m_thread.setObjectName("WalletRpcService");
+  moveToThread(&m_thread);
+  m_thread.start();
+
+  bool started = false;
+  QMetaObject::invokeMethod(this, "startListening", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, started));
+  if (!started) {
+    stop();
+  }
+
+  return started;
+}
+
+void WalletRpcService::stop() {
+  if (!m_thread.isRunning()) {
+    return;
+  }
+
+  QMetaObject::invokeMethod(this, "stopListening", Qt::BlockingQueuedConnection);
+  m_workers.waitForDone();
+  m_thread.quit();
+  m_thread.wait();
+}
+
+bool WalletRpcService::startListening() {
+  m_server = new QTcpServer(this);
+  m_backend = new QNetworkAccessManager(this);
+  connect(m_server, &QTcpServer::newConnection, this, &WalletRpcService::acceptConnection);
+  connect(m_backend, &QNetworkAccessManager::finished, this, &WalletRpcService::backendReplyFinished);
+  return m_server->listen(QHostAddress(m_bindIp), m_bindPort);
+}
+
+void WalletRpcService::stopListening() {
+  if (m_server != nullptr) {
+    m_server->close();
+  }
+
+  for (Client& client : m_clients) {
+    if (!client.socket.isNull()) {
+      client.socket->abort();
+      client.socket->deleteLater();
+    }
+  }
+
+  m_clients.clear();
+  m_writeQueue.clear();
+  m_heldResponses.clear();
+  delete m_backend;
+  m_backend = nullptr;
+  delete m_server;
+  m_server = nullptr;
+}
+
+std::shared_ptr<const WalletRpcSnapshot> WalletRpcService::makeSnapshot() {
+  return updateSnapshot(nullptr, QSet<CryptoNote::TransactionId>());
+}
+
+std::shared_ptr<const WalletRpcSnapshot> WalletRpcService::updateSnapshot(std::shared_ptr<const WalletRpcSnapshot> _previous,
+  const QSet<CryptoNote::TransactionId>& _changed) {
+  WalletAdapter& wallet = WalletAdapter::instance();
+  const quint64 transactionCount = wallet.getTransactionCount();
+  std::shared_ptr<WalletRpcSnapshot> snapshot = std::make_shared<WalletRpcSnapshot>();
+  QSet<CryptoNote::TransactionId> changed = _changed;
+  quint64 firstNew = 0;
+  if (_previous && _previous->transactionCount <= transactionCount) {
+    // the containers are implicitly shared, only the touched entries are copied
+    *snapshot = *_previous;
+    firstNew = _previous->transactionCount;
+  } else {
+    changed.clear();
+  }
+
+  snapshot->actualBalance = wallet.getActualBalance();
+  snapshot->pendingBalance = wallet.getPendingBalance();
+  snapshot->unmixableBalance = wallet.getUnmixableBalance();
+  snapshot->height = NodeAdapter::instance().getLastLocalBlockHeight();
+  snapshot->address = wallet.getAddress();
+  snapshot->node = NodeAdapter::instance().getCurrentNode();
+  snapshot->transactionCount = transactionCount;
+  for (CryptoNote::TransactionId id = firstNew; id < transactionCount; ++id) {
+    changed.insert(id);
+  }
+
+  for (CryptoNote::TransactionId id : changed) {
+    // an updated transaction may have moved to another payment id or been cancelled
+    const QString oldPaymentId = snapshot->transfers.value(id).value("paymentId").toString().toLower();
+    if (snapshot->transfers.remove(id) > 0 && !oldPaymentId.isEmpty()) {
+      auto payments = snapshot->payments.find(oldPaymentId);
+      if (payments != snapshot->payments.end()) {
+        payments->remove(id);
+        if (payments->isEmpty()) {
+          snapshot->payments.erase(payments);
+        }
+      }
+    }
+
+    CryptoNote::WalletLegacyTransaction transaction;
+    if (id >= transactionCount || !wallet.getTransaction(id, transaction) || transaction.state != CryptoNote::WalletLegacyTransactionState::Active ||
+        transaction.blockHeight == CryptoNote::WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT) {
+      continue;
+    }
+
+    QString address;
+    if (transaction.totalAmount < 0 && transaction.transferCount > 0) {
+      CryptoNote::WalletLegacyTransfer transfer;
+      CryptoNote::TransferId transferId = transaction.firstTransferId;
+      if (wallet.getTransfer(transferId, transfer)) {
+        address = QString::fromStdString(transfer.address);
+      }
+    }
+
+    const QString hash = QString::fromStdString(Common::podToHex(transaction.hash));
+    const QString paymentId = NodeAdapter::instance().extractPaymentId(transaction.extra);
+    const quint64 amount = static_cast<quint64>(std::abs(transaction.totalAmount));
+
+    QJsonObject transfer;
+    transfer.insert("time", static_cast<qint64>(transaction.timestamp));
+    transfer.insert("output", transaction.totalAmount < 0);
+    transfer.insert("transactionHash", hash);
+    transfer.insert("amount", static_cast<qint64>(amount));
+    transfer.insert("fee", static_cast<qint64>(transaction.fee));
+    transfer.insert("paymentId", paymentId);
+    transfer.insert("address", address);
+    transfer.insert("blockIndex", static_cast<qint64>(transaction.blockHeight));
+    transfer.insert("unlockTime", static_cast<qint64>(transaction.unlockTime));
+    snapshot->transfers.insert(id, transfer);
+
+    if (!paymentId.isEmpty() && transaction.totalAmount > 0) {
+      QJsonObject payment;
+      payment.insert("tx_hash", hash);
+      payment.insert("amount", static_cast<qint64>(amount));
+      payment.insert("block_height", static_cast<qint64>(transaction.blockHeight));
+      payment.insert("unlock_time", static_cast<qint64>(transaction.unlockTime));
+      snapshot->payments[paymentId.toLower()].insert(id, payment);
+    }
+  }
+
+  return snapshot;
+}
+
+std::shared_ptr<const WalletRpcSnapshot> WalletRpcService::snapshot() const {
+  QMutexLocker locker(&m_snapshotMutex);
+  return m_snapshot;
+}
+
+void WalletRpcService::publishSnapshot(std::shared_ptr<const WalletRpcSnapshot> _snapshot, quint64 _ticket) {
+  QMutexLocker locker(&m_snapshotMutex);
+  m_snapshot = _snapshot;
+  if (_ticket > m_publishedTicket) {
+    m_publishedTicket = _ticket;
+    QMetaObject::invokeMethod(this, "releaseHeldResponses", Qt::QueuedConnection);
+  }
+}
+
+QJsonObject WalletRpcService::statistics() const {
+  QMutexLocker locker(&m_statisticsMutex);
+  const double uptime = std::max<double>(m_clock.elapsed() / 1000.0, 1.0);
+  QJsonObject result;
+  for (auto it = m_statistics.constBegin(); it != m_statistics.constEnd(); ++it) {
+    const MethodStatistics& stat = it.value();
+    QJsonObject method;
+    method.insert("calls", static_cast<qint64>(stat.calls));
+    method.insert("errors", static_cast<qint64>(stat.errors));
+    method.insert("avg_latency_us", static_cast<qint64>(stat.calls > 0 ? stat.totalMicroseconds / stat.calls : 0));
+    method.insert("max_latency_us", static_cast<qint64>(stat.maxMicroseconds));
+    method.insert("calls_per_second", stat.calls / uptime);
+    result.insert(it.key(), method);
+  }
+
+  return result;
+}
+
+bool WalletRpcService::isReadOnlyMethod(const QString& _method) {
+  static const QSet<QString> methods = {"getbalance", "get_balance", "get_transfers", "get_payments", "get_height", "get_address",
+    "verify_messages", "check_reserve_proofs"};
+  return methods.contains(_method);
+}
+
+QJsonObject WalletRpcService::executeReadRequest(const WalletRpcSnapshot& _snapshot, const QJsonObject& _request) {
+  const QString method = _request.value("method").toString();
+  const QJsonValue id = _request.value("id");
+  QJsonObject result;
+  if (method == "getbalance" || method == "get_balance") {
+    result.insert("available_balance", static_cast<qint64>(_snapshot.actualBalance));
+    result.insert("locked_amount", static_cast<qint64>(_snapshot.pendingBalance));
+    result.insert("unmixable_balance", static_cast<qint64>(_snapshot.unmixableBalance));
+  } else if (method == "get_transfers") {
+    QJsonArray transfers;
+    for (QJsonObject transfer : _snapshot.transfers) {
+      const quint64 blockIndex = static_cast<quint64>(transfer.value("blockIndex").toDouble());
+      transfer.insert("confirmations", static_cast<qint64>(_snapshot.height >= blockIndex ? _snapshot.height - blockIndex : 0));
+      transfers.append(transfer);
+    }
+
+    result.insert("transfers", transfers);
+  } else if (method == "get_payments") {
+    QString paymentId = _request.value("params").toObject().value("payment_id").toString().toLower();
+    if (QByteArray::fromHex(paymentId.toLatin1()).size() != 32) {
+      return makeError(id, -1, "Payment ID has invald format");
+    }
+
+    QJsonArray payments;
+    for (const QJsonObject& payment : _snapshot.payments.value(paymentId)) {
+      payments.append(payment);
+    }
+
+    result.insert("payments", payments);
+  } else if (method == "get_height") {
+    result.insert("height", static_cast<qint64>(_snapshot.height));
+  } else if (method == "get_address") {
+    result.insert("address", _snapshot.address);
+  } else if (method == "verify_messages") {
+    QVector<SignedMessage> messages;
+    for (const QJsonValue& value : _request.value("params").toObject().value("messages").toArray()) {
+      QJsonObject item = value.toObject();
+      messages.append(SignedMessage{item.value("message").toString(), item.value("address").toString(), item.value("signature").toString()});
+    }
+
+    static const char* statuses[] = {"valid", "invalid_signature", "invalid_address", "invalid_format"};
+    QJsonArray results;
+    int validCount = 0;
+    // one thread per request, the worker pool already runs requests side by side
+    for (MessageCheckResult check : MessageSigner::verifyBatch(messages, 1)) {
+      QJsonObject item;
+      item.insert("valid", check == MessageCheckResult::VALID);
+      item.insert("status", statuses[static_cast<int>(check)]);
+      results.append(item);
+      validCount += check == MessageCheckResult::VALID ? 1 : 0;
+    }
+
+    result.insert("results", results);
+    result.insert("valid_count", validCount);
+  } else if (method == "check_reserve_proofs") {
+    if (_snapshot.node == nullptr) {
+      return makeError(id, -1, "Not connected to a node");
+    }
+
+    QVector<ReserveProofRequest> requests;
+    for (const QJsonValue& value : _request.value("params").toObject().value("proofs").toArray()) {
+      QJsonObject item = value.toObject();
+      requests.append(ReserveProofRequest{item.value("address").toString(), item.value("message").toString(), item.value("signature").toString()});
+    }
+
+    // one thread per request, the worker pool already runs requests side by side
+    QJsonArray results;
+    for (const ReserveProofCheckResult& check : ReserveProof::checkProofs(*_snapshot.node, requests, nullptr, 1)) {
+      QJsonObject item;
+      item.insert("good", check.valid);
+      item.insert("total", static_cast<qint64>(check.total));
+      item.insert("spent", static_cast<qint64>(check.spent));
+      if (!check.valid) {
+        item.insert("error", check.errorText);
+      }
+
+      results.append(item);
+    }
+
+    result.insert("results", results);
+  } else {
+    return makeError(id, -32601, "Method not found");
+  }
+
+  return makeResult(id, result);
+}
+
+void WalletRpcService::acceptConnection() {
+  while (m_server->hasPendingConnections()) {
+    QTcpSocket* socket = m_server->nextPendingConnection();
+    const quint64 clientId = ++m_nextClientId;
+    Client client;
+    client.socket = socket;
+    client.busy = false;
+    m_clients.insert(clientId, client);
+    connect(socket, &QTcpSocket::readyRead, this, [this, clientId]() { readClient(clientId); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, clientId, socket]() {
+      m_clients.remove(clientId);
+      socket->deleteLater();
+    });
+  }
+}
+
+void WalletRpcService::readClient(quint64 _clientId) {
+  auto it = m_clients.find(_clientId);
+  if (it == m_clients.end() || it->socket.isNull()) {
+    return;
+  }
+
+  it->buffer.append(it->socket->readAll());
+  if (it->buffer.size() > MAX_REQUEST_SIZE) {
+    writeResponse(_clientId, 413, QByteArray(), "text/plain");
+    it->socket->disconnectFromHost();
+    return;
+  }
+
+  // Requests of one connection are answered in order
+  if (it->busy) {
+    return;
+  }
+
+  HttpRequest request;
+  if (!parseHttpRequest(it->buffer, request)) {
+    return;
+  }
+
+  it->busy = true;
+  handleRequest(_clientId, request);
+}
+
+void WalletRpcService::handleRequest(quint64 _clientId, const HttpRequest& _request) {
+  const qint64 startedAt = now();
+  if (!m_authorization.isEmpty() && _request.headers.value("authorization") != m_authorization) {
+    writeResponse(_clientId, 401, QByteArray(), "text/plain");
+    recordCall("unauthorized", startedAt, true);
+    return;
+  }
+
+  QString rpcMethod = QString::fromLatin1(_request.path);
+  QJsonObject rpcRequest;
+  if (_request.path == "/json_rpc") {
+    rpcRequest = QJsonDocument::fromJson(_request.body).object();
+    rpcMethod = rpcRequest.value("method").toString();
+  }
+
+  if (rpcMethod == "get_rpc_stats") {
+    QJsonObject response = makeResult(rpcRequest.value("id"), statistics());
+    writeResponse(_clientId, 200, QJsonDocument(response).toJson(QJsonDocument::Compact), "application/json");
+    recordCall(rpcMethod, startedAt, false);
+    return;
+  }
+
+  std::shared_ptr<const WalletRpcSnapshot> snapshot;
+  {
+    QMutexLocker locker(&m_snapshotMutex);
+    snapshot = m_snapshot;
+  }
+
+  if (snapshot && isReadOnlyMethod(rpcMethod)) {
+    m_workers.start(new ReadRequestTask(this, _clientId, rpcMethod, rpcRequest, snapshot, startedAt));
+    return;
+  }
+
+  QueuedRequest queued;
+  queued.clientId = _clientId;
+  queued.rpcMethod = rpcMethod;
+  queued.request = _request;
+  queued.startedAt = startedAt;
+  m_writeQueue.enqueue(queued);
+  processWriteQueue();
+}
+
+void WalletRpcService::readRequestCompleted(quint64 _clientId, const QString& _method, const QByteArray& _response, qint64 _startedAt) {
+  writeResponse(_clientId, 200, _response, "application/json");
+  recordCall(_method, _startedAt, _response.contains("\"error\""));
+}
+
+void WalletRpcService::processWriteQueue() {
+  if (m_writeInProgress || m_writeQueue.isEmpty() || m_backend == nullptr) {
+    return;
+  }
+
+  const QueuedRequest& queued = m_writeQueue.head();
+  QNetworkRequest request(QUrl(QString("http://127.0.0.1:%1%2").arg(m_backendPort).arg(QString::fromLatin1(queued.request.path))));
+  request.setHeader(QNetworkRequest::ContentTypeHeader, queued.request.headers.value("content-type", "application/json"));
+  if (queued.request.headers.contains("authorization")) {
+    request.setRawHeader("Authorization", queued.request.headers.value("authorization"));
+  }
+
+  m_writeInProgress = true;
+  if (queued.request.method == "GET") {
+    m_backend->get(request);
+  } else {
+    m_backend->post(request, queued.request.body);
+  }
+}
+
+void WalletRpcService::backendReplyFinished(QNetworkReply* _reply) {
+  _reply->deleteLater();
+  if (m_writeQueue.isEmpty()) {
+    m_writeInProgress = false;
+    return;
+  }
+
+  QueuedRequest queued = m_writeQueue.dequeue();
+  int status = _reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  QByteArray body = _reply->readAll();
+  bool failed = _reply->error() != QNetworkReply::NoError && status == 0;
+  if (failed) {
+    status = 502;
+  }
+
+  QByteArray contentType = _reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+  // A read right after the write has to see its result, so the answer waits
+  // for the GUI thread to publish a snapshot taken after the write
+  HeldResponse held;
+  held.ticket = ++m_lastTicket;
+  held.clientId = queued.clientId;
+  held.rpcMethod = queued.rpcMethod;
+  held.status = status;
+  held.body = body;
+  held.contentType = contentType.isEmpty() ? QByteArray("application/json") : contentType;
+  held.startedAt = queued.startedAt;
+  held.failed = failed;
+  m_heldResponses.enqueue(held);
+  Q_EMIT snapshotRequestedSignal(held.ticket);
+}
+
+void WalletRpcService::releaseHeldResponses() {
+  quint64 publishedTicket;
+  {
+    QMutexLocker locker(&m_snapshotMutex);
+    publishedTicket = m_publishedTicket;
+  }
+
+  bool released = false;
+  while (!m_heldResponses.isEmpty() && m_heldResponses.head().ticket <= publishedTicket) {
+    HeldResponse held = m_heldResponses.dequeue();
+    writeResponse(held.clientId, held.status, held.body, held.contentType);
+    recordCall(held.rpcMethod, held.startedAt, held.failed || held.status != 200 || held.body.contains("\"error\""));
+    released = true;
+  }
+
+  // Writes stay one at a time, the next starts once the previous is visible
+  if (released && m_heldResponses.isEmpty()) {
+    m_writeInProgress = false;
+    processWriteQueue();
+  }
+}
+
+void WalletRpcService::writeResponse(quint64 _clientId, int _status, const QByteArray& _body, const QByteArray& _contentType) {
+  auto it = m_clients.find(_clientId);
+  if (it == m_clients.end() || it->socket.isNull()) {
+    return;
+  }
+
+  it->socket->write(makeHttpResponse(_status, _body, _contentType, _status == 401 ? "WWW-Authenticate: Basic realm=\"wallet\"\r\n" : ""));
+  it->busy = false;
+
+  // Continue with a pipelined request, if any
+  if (!it->buffer.isEmpty()) {
+    QTimer::singleShot(0, this, [this, _clientId]() { readClient(_clientId); });
+  }
+}
+
+void WalletRpcService::recordCall(const QString& _method, qint64 _startedAt, bool _error) {
+  const quint64 elapsed = static_cast<quint64>(std::max<qint64>(now() - _startedAt, 0));
+  QMutexLocker locker(&m_statisticsMutex);
+  MethodStatistics& stat = m_statistics[_method];
+  ++stat.calls;
+  if (_error) {
+    ++stat.errors;
+  }
+
+  stat.totalMicroseconds += elapsed;
+  stat.maxMicroseconds = std::max(stat.maxMicroseconds, elapsed);
+}
+
+qint64 WalletRpcService::now() const {
+  return m_clock.nsecsElapsed() / 1000;
+}
+
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+
+#include <memory>
+
+#include <IWalletLegacy.h>
+
+#include "HttpMessage.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTcpServer;
+class QTcpSocket;
+
+namespace WalletGui {
+
+class Node;
+
+// Wallet state the read-only RPC methods are answered from. Entries are kept
+// by transaction id, so an update only rebuilds the transactions that changed;
+// confirmations follow the height and are added when a request is answered.
+struct WalletRpcSnapshot {
+  quint64 actualBalance;
+  quint64 pendingBalance;
+  quint64 unmixableBalance;
+  quint64 height;
+  QString address;
+  // the node at the time of the snapshot, resolved on the GUI thread; null without one
+  Node* node;
+  // wallet transactions the entries cover
+  quint64 transactionCount;
+  QMap<CryptoNote::TransactionId, QJsonObject> transfers;
+  // by lower case payment id
+  QHash<QString, QMap<CryptoNote::TransactionId, QJsonObject>> payments;
+};
+
+// Front end of the wallet RPC server. It runs on its own thread: read-only
+// methods are served concurrently from the latest snapshot by a worker pool,
+// everything else is forwarded one request at a time to wallet_rpc_server
+// listening on a loopback port.
+class WalletRpcService : public QObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(WalletRpcService)
+
+public:
+  WalletRpcService(const QString& _bindIp, quint16 _bindPort, quint16 _backendPort, const QString& _user, const QString& _password);
+  ~WalletRpcService();
+
+  bool start();
+  void stop();
+
+  // Must be called from the GUI thread, they read the wallet directly. The
+  // update copies _previous and rebuilds only the _changed transactions and
+  // those added since, everything if the wallet has fewer than before.
+  static std::shared_ptr<const WalletRpcSnapshot> makeSnapshot();
+  static std::shared_ptr<const WalletRpcSnapshot> updateSnapshot(std::shared_ptr<const WalletRpcSnapshot> _previous,
+    const QSet<CryptoNote::TransactionId>& _changed);
+  std::shared_ptr<const WalletRpcSnapshot> snapshot() const;
+  // _ticket answers snapshotRequestedSignal, 0 for updates nobody waits for
+  void publishSnapshot(std::shared_ptr<const WalletRpcSnapshot> _snapshot, quint64 _ticket = 0);
+  QJsonObject statistics() const;
+
+  static bool isReadOnlyMethod(const QString& _method);
+  static QJsonObject executeReadRequest(const WalletRpcSnapshot& _snapshot, const QJsonObject& _request);
+
+  Q_INVOKABLE void readRequestCompleted(quint64 _clientId, const QString& _method, const QByteArray& _response, qint64 _startedAt);
+
+Q_SIGNALS:
+  // A write finished, its answer is held until a snapshot with its result is published
+  void snapshotRequestedSignal(quint64 _ticket);
+
+private:
+  struct Client {
+    QPointer<QTcpSocket> socket;
+    QByteArray buffer;
+    bool busy;
+  };
+
+  struct QueuedRequest {
+    quint64 clientId;
+    QString rpcMethod;
+    HttpRequest request;
+    qint64 startedAt;
+  };
+
+  struct HeldResponse {
+    quint64 ticket;
+    quint64 clientId;
+    QString rpcMethod;
+    int status;
+    QByteArray body;
+    QByteArray contentType;
+    qint64 startedAt;
+    bool failed;
+  };
+
+  struct MethodStatistics {
+    quint64 calls;
+    quint64 errors;
+    quint64 totalMicroseconds;
+    quint64 maxMicroseconds;
+  };
+
+  const QString m_bindIp;
+  const quint16 m_bindPort;
+  const quint16 m_backendPort;
+  const QByteArray m_authorization;
+
+  QThread m_thread;
+  QThreadPool m_workers;
+  QElapsedTimer m_clock;
+  QTcpServer* m_server;
+  QNetworkAccessManager* m_backend;
+  quint64 m_nextClientId;
+  QHash<quint64, Client> m_clients;
+  QQueue<QueuedRequest> m_writeQueue;
+  bool m_writeInProgress;
+  QQueue<HeldResponse> m_heldResponses;
+  quint64 m_lastTicket;
+  quint64 m_publishedTicket;
+
+  mutable QMutex m_snapshotMutex;
+  std::shared_ptr<const WalletRpcSnapshot> m_snapshot;
+
+  mutable QMutex m_statisticsMutex;
+  QHash<QString, MethodStatistics> m_statistics;
+
+  Q_INVOKABLE bool startListening();
+  Q_INVOKABLE void stopListening();
+  void acceptConnection();
+  void readClient(quint64 _clientId);
+  void handleRequest(quint64 _clientId, const HttpRequest& _request);
+  void processWriteQueue();
+  void backendReplyFinished(QNetworkReply* _reply);
+  Q_INVOKABLE void releaseHeldResponses();
+  void writeResponse(quint64 _clientId, int _status, const QByteArray& _body, const QByteArray& _contentType);
+  void recordCall(const QString& _method, qint64 _startedAt, bool _error);
+  qint64 now() const;
+};
+
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "CheckBalanceProofDialog.h"
+#include "ui_checkbalanceproofdialog.h"
+
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "CurrencyAdapter.h"
+#include "MainWindow.h"
+#include "NodeAdapter.h"
+
+namespace WalletGui {
+
+CheckBalanceProofDialog::CheckBalanceProofDialog(QWidget* _parent) : QDialog(_parent), m_checkJobId(0), m_ui(new Ui::CheckBalanceProofDialog) {
+  m_ui->setupUi(this);
+  connect(&m_reserveProof, &ReserveProof::progressSignal, this, &CheckBalanceProofDialog::proofProgress);
+  connect(&m_reserveProof, &ReserveProof::proofsCheckedSignal, this, &CheckBalanceProofDialog::proofsChecked, Qt::QueuedConnection);
+  m_ui->m_checkProgressBar->setVisible(false);
+}
+
+CheckBalanceProofDialog::~CheckBalanceProofDialog() {
+}
+
+void CheckBalanceProofDialog::checkProof() {
+  Node* node = NodeAdapter::instance().getCurrentNode();
+  if (node == nullptr) {
+    m_ui->m_resultLabel->setText(tr("Not connected to a node"));
+    return;
+  }
+
+  ReserveProofRequest request;
+  request.address = m_ui->m_addressEdit->text().trimmed();
+  request.message = m_ui->m_messageEdit->toPlainText();
+  request.proof = m_ui->m_proofEdit->toPlainText().trimmed();
+  if (request.address.isEmpty() || request.proof.isEmpty()) {
+    m_ui->m_resultLabel->setText(tr("Enter the address and the proof"));
+    return;
+  }
+
+  m_ui->m_resultLabel->setText(tr("Checking..."));
+  m_ui->m_checkButton->setEnabled(false);
+  m_ui->m_checkProgressBar->setValue(0);
+  m_ui->m_checkProgressBar->setVisible(true);
+  m_checkJobId = m_reserveProof.verify(*node, QVector<ReserveProofRequest>() << request);
+}
+
+void CheckBalanceProofDialog::loadProof() {
+  QString file = QFileDialog::getOpenFileName(&MainWindow::instance(), tr("Open proof"), QDir::homePath(), "TXT (*.txt)");
+  if (file.isEmpty()) {
+    return;
+  }
+
+  QFile f(file);
+  if (f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    m_ui->m_proofEdit->setPlainText(QTextStream(&f).readAll().trimmed());
+  }
+}
+
+void CheckBalanceProofDialog::proofProgress(quint64 _jobId, int _done, int _total) {
+  if (_jobId != m_checkJobId || _total == 0) {
+    return;
+  }
+
+  m_ui->m_checkProgressBar->setMaximum(_total);
+  m_ui->m_checkProgressBar->setValue(_done);
+}
+
+void CheckBalanceProofDialog::proofsChecked(quint64 _jobId, const QVector<WalletGui::ReserveProofCheckResult>& _results) {
+  if (_jobId != m_checkJobId || _results.isEmpty()) {
+    return;
+  }
+
+  m_ui->m_checkProgressBar->setVisible(false);
+  m_ui->m_checkButton->setEnabled(true);
+  const ReserveProofCheckResult& result = _results.first();
+  if (!result.valid) {
+    m_ui->m_resultLabel->setText(tr("The proof is invalid: %1").arg(result.errorText));
+    return;
+  }
+
+  const QString ticker = CurrencyAdapter::instance().getCurrencyTicker().toUpper();
+  m_ui->m_resultLabel->setText(tr("The proof is valid. Proven: %1 %3, spent since: %2 %3, unspent: <b>%4 %3</b>").
+    arg(CurrencyAdapter::instance().formatAmount(result.total)).
+    arg(CurrencyAdapter::instance().formatAmount(result.spent)).
+    arg(ticker).
+    arg(CurrencyAdapter::instance().formatAmount(result.total - std::min(result.spent, result.total))));
+}
+
+}
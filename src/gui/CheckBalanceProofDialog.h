@@ -0,0 +1,36 @@
+// Copyright (c) 2016-2022 The Karbowanec developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <QDialog>
+
+#include "ReserveProof.h"
+
+namespace Ui {
+class CheckBalanceProofDialog;
+}
+
+namespace WalletGui {
+
+class CheckBalanceProofDialog : public QDialog {
+  Q_OBJECT
+
+public:
+  CheckBalanceProofDialog(QWidget* _parent);
+  ~CheckBalanceProofDialog();
+
+private:
+  ReserveProof m_reserveProof;
+  quint64 m_checkJobId;
+
+  Q_SLOT void checkProof();
+  Q_SLOT void loadProof();
+  void proofProgress(quint64 _jobId, int _done, int _total);
+  void proofsChecked(quint64 _jobId, const QVector<WalletGui::ReserveProofCheckResult>& _results);
+
+  QScopedPointer<Ui::CheckBalanceProofDialog> m_ui;
+};
+
+}
@@ -85,6 +85,8 @@ void ConnectionSettingsDialog::initConnectionSettings() {
     m_ui->radioButton_3->setChecked(true);
   } else if (connection.compare("remote") == 0) {
     m_ui->radioButton_4->setChecked(true);
+  } else if (connection.compare("hybrid") == 0) {
+    m_ui->radioButton_5->setChecked(true);
   }
 
   quint16 localDaemonPort = Settings::instance().getCurrentLocalDaemonPort();
@@ -107,6 +109,8 @@ QString ConnectionSettingsDialog::getConnectionMode() const {
     connectionMode = "local";
   } else if(m_ui->radioButton_4->isChecked()) {
     connectionMode = "remote";
+  } else if(m_ui->radioButton_5->isChecked()) {
+    connectionMode = "hybrid";
   }
   return connectionMode;
 }
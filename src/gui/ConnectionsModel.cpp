@@ -10,11 +10,26 @@
 
 #include <QDateTime>
 
+#include <algorithm>
+#include <map>
+
 #include "Common/StringTools.h"
 #include "NodeAdapter.h"
 
 namespace WalletGui {
 
+namespace {
+
+const int CONNECTIONS_REFRESH_INTERVAL = 3000;
+
+bool isSameConnectionState(const CryptoNote::p2pConnection& _left, const CryptoNote::p2pConnection& _right) {
+  return _left.connection_state == _right.connection_state && _left.remote_blockchain_height == _right.remote_blockchain_height &&
+    _left.last_response_height == _right.last_response_height && _left.version == _right.version && _left.started == _right.started &&
+    _left.remote_ip == _right.remote_ip && _left.remote_port == _right.remote_port && _left.is_incoming == _right.is_incoming;
+}
+
+}
+
 inline QString getStateString(CryptoNote::p2pConnection::state s) {
   switch (s)  {
   case CryptoNote::p2pConnection::state_befor_handshake:
@@ -41,7 +56,11 @@ ConnectionsModel& ConnectionsModel::instance() {
   return inst;
 }
 
-ConnectionsModel::ConnectionsModel() : QAbstractItemModel() {
+ConnectionsModel::ConnectionsModel() : QAbstractItemModel(), m_requestInProgress(false), m_refreshPending(false) {
+  m_refreshTimer.setSingleShot(true);
+  connect(&m_refreshTimer, &QTimer::timeout, this, &ConnectionsModel::requestConnections);
+  connect(&NodeAdapter::instance(), &NodeAdapter::connectionsReceivedSignal, this, &ConnectionsModel::connectionsReceived, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::connectionsRequestFailedSignal, this, &ConnectionsModel::connectionsRequestFailed, Qt::QueuedConnection);
   connect(&NodeAdapter::instance(), &NodeAdapter::nodeInitCompletedSignal, this, &ConnectionsModel::refreshConnections, Qt::QueuedConnection);
   connect(&NodeAdapter::instance(), &NodeAdapter::peerCountUpdatedSignal, this, &ConnectionsModel::refreshConnections, Qt::QueuedConnection);
   connect(&NodeAdapter::instance(), &NodeAdapter::lastKnownBlockHeightUpdatedSignal, this, &ConnectionsModel::refreshConnections, Qt::QueuedConnection);
@@ -170,9 +189,82 @@ QVariant ConnectionsModel::headerData(int _section, Qt::Orientation _orientation
 }
 
 void ConnectionsModel::refreshConnections() {
-  m_connections = NodeAdapter::instance().getConnections();
-  beginInsertRows(QModelIndex(), m_connections.size(), m_connections.size());
-  endInsertRows();
+  // Peer count and height updates come in bursts, one request covers them all
+  if (m_requestInProgress) {
+    m_refreshPending = true;
+    return;
+  }
+
+  if (m_refreshTimer.isActive()) {
+    return;
+  }
+
+  const qint64 sinceLastRequest = m_lastRequest.isValid() ? m_lastRequest.elapsed() : CONNECTIONS_REFRESH_INTERVAL;
+  m_refreshTimer.start(std::max<qint64>(CONNECTIONS_REFRESH_INTERVAL - sinceLastRequest, 0));
+}
+
+void ConnectionsModel::requestConnections() {
+  if (!NodeAdapter::instance().hasNode()) {
+    return;
+  }
+
+  m_requestInProgress = true;
+  m_refreshPending = false;
+  m_lastRequest.start();
+  NodeAdapter::instance().requestConnections();
+}
+
+void ConnectionsModel::connectionsReceived(const std::vector<CryptoNote::p2pConnection>& _connections) {
+  m_requestInProgress = false;
+  std::map<boost::uuids::uuid, size_t> received;
+  for (size_t i = 0; i < _connections.size(); ++i) {
+    received.emplace(_connections[i].connection_id, i);
+  }
+
+  // Rows are updated in place, so views keep their sorting and selection
+  for (int row = static_cast<int>(m_connections.size()) - 1; row >= 0; --row) {
+    auto it = received.find(m_connections[row].connection_id);
+    if (it == received.end()) {
+      beginRemoveRows(QModelIndex(), row, row);
+      m_connections.erase(m_connections.begin() + row);
+      endRemoveRows();
+      continue;
+    }
+
+    const CryptoNote::p2pConnection& connection = _connections[it->second];
+    if (!isSameConnectionState(m_connections[row], connection)) {
+      m_connections[row] = connection;
+      Q_EMIT dataChanged(index(row, 0), index(row, columnCount() - 1));
+    }
+
+    received.erase(it);
+  }
+
+  if (!received.empty()) {
+    std::vector<size_t> added;
+    for (const auto& item : received) {
+      added.push_back(item.second);
+    }
+
+    std::sort(added.begin(), added.end());
+    beginInsertRows(QModelIndex(), m_connections.size(), m_connections.size() + added.size() - 1);
+    for (size_t i : added) {
+      m_connections.push_back(_connections[i]);
+    }
+
+    endInsertRows();
+  }
+
+  if (m_refreshPending) {
+    refreshConnections();
+  }
+}
+
+void ConnectionsModel::connectionsRequestFailed() {
+  m_requestInProgress = false;
+  if (m_refreshPending) {
+    refreshConnections();
+  }
 }
 
 }
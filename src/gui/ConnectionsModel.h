@@ -5,6 +5,8 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QElapsedTimer>
+#include <QTimer>
 
 #include <INode.h>
 
@@ -32,6 +34,7 @@ public:
   QModelIndex parent(const QModelIndex& _index) const Q_DECL_OVERRIDE;
   int rowCount(const QModelIndex& _parent = QModelIndex()) const Q_DECL_OVERRIDE;
 
+  // Asks the node for the connection list, at most once per refresh interval
   void refreshConnections();
 
 private:
@@ -39,6 +42,14 @@ private:
   ~ConnectionsModel();
 
   std::vector<CryptoNote::p2pConnection> m_connections;
+  QTimer m_refreshTimer;
+  QElapsedTimer m_lastRequest;
+  bool m_requestInProgress;
+  bool m_refreshPending;
+
+  void requestConnections();
+  void connectionsReceived(const std::vector<CryptoNote::p2pConnection>& _connections);
+  void connectionsRequestFailed();
 };
 
 }
@@ -8,6 +8,7 @@
 #include <QClipboard>
 #include <QFileDialog>
 #include <QBuffer>
+#include <QMessageBox>
 #include <QTextStream>
 
 #include "Common/Base58.h"
@@ -18,8 +19,10 @@
 
 namespace WalletGui {
 
-GetBalanceProofDialog::GetBalanceProofDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::GetBalanceProofDialog) {
+GetBalanceProofDialog::GetBalanceProofDialog(QWidget* _parent) : QDialog(_parent), m_proofJobId(0), m_ui(new Ui::GetBalanceProofDialog) {
   m_ui->setupUi(this);
+  connect(&m_reserveProof, &ReserveProof::progressSignal, this, &GetBalanceProofDialog::proofProgress);
+  connect(&m_reserveProof, &ReserveProof::proofGeneratedSignal, this, &GetBalanceProofDialog::proofGenerated, Qt::QueuedConnection);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletActualBalanceUpdatedSignal, this, &GetBalanceProofDialog::walletBalanceUpdated, Qt::QueuedConnection);
   m_ui->m_amountSpin->setSuffix(" " + CurrencyAdapter::instance().getCurrencyTicker().toUpper());
   m_amount = WalletAdapter::instance().getActualBalance(); 
@@ -56,14 +59,48 @@ void GetBalanceProofDialog::genProof() {
       m_ui->m_amountSpin->setValue(CurrencyAdapter::instance().formatAmount(m_amount).toDouble());
   }
   if (m_amount > 0) {
-    m_proof = WalletAdapter::instance().getReserveProof(m_amount, m_message);
-    m_ui->m_signatureEdit->setText(m_proof);
+    // A running generation is cancelled and restarted with the new amount and message
+    CryptoNote::AccountKeys keys;
+    WalletAdapter::instance().getAccountKeys(keys);
+    m_proof.clear();
+    m_ui->m_signatureEdit->setText("");
+    m_ui->m_copyProofButton->setEnabled(false);
+    m_ui->m_saveProofButton->setEnabled(false);
+    m_ui->m_proofProgressBar->setValue(0);
+    m_ui->m_proofProgressBar->setVisible(true);
+    m_proofJobId = m_reserveProof.generate(keys, WalletAdapter::instance().getUnlockedOutputs(), m_amount, m_message);
   } else {
     m_ui->m_amountSpin->setValue(0);
     m_ui->m_signatureEdit->setText("");
   }
 }
 
+void GetBalanceProofDialog::proofProgress(quint64 _jobId, int _done, int _total) {
+  if (_jobId != m_proofJobId || _total == 0) {
+    return;
+  }
+
+  m_ui->m_proofProgressBar->setMaximum(_total);
+  m_ui->m_proofProgressBar->setValue(_done);
+}
+
+void GetBalanceProofDialog::proofGenerated(quint64 _jobId, const QString& _proof, const QString& _errorText) {
+  if (_jobId != m_proofJobId) {
+    return;
+  }
+
+  m_ui->m_proofProgressBar->setVisible(false);
+  if (!_errorText.isEmpty()) {
+    QMessageBox::critical(this, tr("Failed to get the reserve proof"), _errorText, QMessageBox::Ok);
+    return;
+  }
+
+  m_proof = _proof;
+  m_ui->m_signatureEdit->setText(m_proof);
+  m_ui->m_copyProofButton->setEnabled(true);
+  m_ui->m_saveProofButton->setEnabled(true);
+}
+
 void GetBalanceProofDialog::copyProof() {
   QApplication::clipboard()->setText(m_proof);
 }
@@ -4,6 +4,8 @@
 
 #include <QDialog>
 
+#include "ReserveProof.h"
+
 namespace Ui {
 class GetBalanceProofDialog;
 }
@@ -22,10 +24,14 @@ private:
     quint64 m_amount;
     QString m_message;
     QString m_proof;
+    ReserveProof m_reserveProof;
+    quint64 m_proofJobId;
 
     Q_SLOT void genProof();
     Q_SLOT void copyProof();
     Q_SLOT void saveProof();
+    void proofProgress(quint64 _jobId, int _done, int _total);
+    void proofGenerated(quint64 _jobId, const QString& _proof, const QString& _errorText);
 
     void disableAll();
 
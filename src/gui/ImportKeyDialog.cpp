@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <QApplication>
+#include <QLocale>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardPaths>
@@ -15,6 +16,7 @@
 #include "CurrencyAdapter.h"
 
 #include "ImportKeyDialog.h"
+#include "NodeAdapter.h"
 
 #include "ui_importkeydialog.h"
 
@@ -22,6 +24,7 @@ namespace WalletGui {
 
 ImportKeyDialog::ImportKeyDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::ImportKeyDialog) {
   m_ui->setupUi(this);
+  connect(&NodeAdapter::instance(), &NodeAdapter::blockHeadersReceivedSignal, this, &ImportKeyDialog::blockHeadersReceived);
   m_ui->m_okButton->setEnabled(false);
 }
 
@@ -93,4 +96,23 @@ void ImportKeyDialog::onAccept() {
   accept();
 }
 
+void ImportKeyDialog::syncHeightChanged(int _height) {
+  showSyncHeightTime(NodeAdapter::instance().estimateBlockTime(_height));
+  // The estimate is replaced with the exact time once the node sent the header
+  NodeAdapter::instance().requestBlockHeader(_height);
+}
+
+void ImportKeyDialog::blockHeadersReceived(const QVector<CryptoNote::BlockHeaderInfo>& _headers) {
+  for (const CryptoNote::BlockHeaderInfo& header : _headers) {
+    if (header.index == getSyncHeight()) {
+      showSyncHeightTime(QDateTime::fromTime_t(header.timestamp, Qt::UTC));
+    }
+  }
+}
+
+void ImportKeyDialog::showSyncHeightTime(const QDateTime& _blockTime) {
+  m_ui->m_syncHeight->setToolTip(_blockTime.isValid() ?
+    tr("Block of about %1").arg(QLocale(QLocale::English).toString(_blockTime, "dd.MM.yyyy")) : QString());
+}
+
 }
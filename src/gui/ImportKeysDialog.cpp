@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <QApplication>
+#include <QLocale>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardPaths>
@@ -14,6 +15,7 @@
 #include "CurrencyAdapter.h"
 
 #include "ImportKeysDialog.h"
+#include "NodeAdapter.h"
 
 #include "ui_importkeysdialog.h"
 
@@ -21,6 +23,7 @@ namespace WalletGui {
 
 ImportKeysDialog::ImportKeysDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::ImportKeysDialog) {
   m_ui->setupUi(this);
+  connect(&NodeAdapter::instance(), &NodeAdapter::blockHeadersReceivedSignal, this, &ImportKeysDialog::blockHeadersReceived);
   m_ui->m_okButton->setEnabled(false);
 }
 
@@ -115,4 +118,23 @@ void ImportKeysDialog::onAccept() {
   accept();
 }
 
+void ImportKeysDialog::syncHeightChanged(int _height) {
+  showSyncHeightTime(NodeAdapter::instance().estimateBlockTime(_height));
+  // The estimate is replaced with the exact time once the node sent the header
+  NodeAdapter::instance().requestBlockHeader(_height);
+}
+
+void ImportKeysDialog::blockHeadersReceived(const QVector<CryptoNote::BlockHeaderInfo>& _headers) {
+  for (const CryptoNote::BlockHeaderInfo& header : _headers) {
+    if (header.index == getSyncHeight()) {
+      showSyncHeightTime(QDateTime::fromTime_t(header.timestamp, Qt::UTC));
+    }
+  }
+}
+
+void ImportKeysDialog::showSyncHeightTime(const QDateTime& _blockTime) {
+  m_ui->m_syncHeight->setToolTip(_blockTime.isValid() ?
+    tr("Block of about %1").arg(QLocale(QLocale::English).toString(_blockTime, "dd.MM.yyyy")) : QString());
+}
+
 }
@@ -8,9 +8,10 @@
 #include <QClipboard>
 #include <QDateTime>
 #include <QLocale>
+#include <QSortFilterProxyModel>
 #include <QTabWidget>
 
-#include "NodeAdapter.h"
+#include "NodeStats.h"
 #include "CryptoNoteWrapper.h"
 #include "CurrencyAdapter.h"
 #include "ConnectionsModel.h"
@@ -19,10 +20,14 @@
 
 namespace WalletGui {
 
-InfoDialog::InfoDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::InfoDialog), m_refreshTimerId(-1) {
+InfoDialog::InfoDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::InfoDialog) {
   m_ui->setupUi(this);
-  m_refreshTimerId = startTimer(1000);
-  m_ui->m_connectionsView->setModel(&ConnectionsModel::instance());
+  connect(&NodeStats::instance(), &NodeStats::statsUpdatedSignal, this, &InfoDialog::updateStats);
+  // Sorted by a proxy, so refreshes of the model do not reorder rows under the selection
+  QSortFilterProxyModel* sortedConnections = new QSortFilterProxyModel(this);
+  sortedConnections->setSourceModel(&ConnectionsModel::instance());
+  sortedConnections->setDynamicSortFilter(true);
+  m_ui->m_connectionsView->setModel(sortedConnections);
   m_ui->m_connectionsView->header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
   m_ui->m_connectionsView->setSortingEnabled(true);
   m_ui->m_connectionsView->sortByColumn(0, Qt::AscendingOrder);
@@ -43,11 +48,12 @@ InfoDialog::InfoDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::InfoDi
   m_contextMenu->addAction(QString(tr("Copy &Id")), this, SLOT(copyIdClicked()));
 
   ConnectionsModel::instance().refreshConnections();
+  NodeStats::instance().subscribe();
+  updateStats();
 }
 
 InfoDialog::~InfoDialog() {
-  killTimer(m_refreshTimerId);
-  m_refreshTimerId = -1;
+  NodeStats::instance().unsubscribe();
 }
 
 void InfoDialog::onCustomContextMenu(const QPoint &point) {
@@ -57,44 +63,21 @@ void InfoDialog::onCustomContextMenu(const QPoint &point) {
   m_contextMenu->exec(m_ui->m_connectionsView->mapToGlobal(point));
 }
 
-void InfoDialog::timerEvent(QTimerEvent* _event) {
-  if (_event->timerId() == m_refreshTimerId) {
-
-    quint64 Connections = NodeAdapter::instance().getPeerCount(); // NodeAdapter::instance().getConnectionsCount();
-    quint64 Outgoing =    NodeAdapter::instance().getOutgoingConnectionsCount();
-    quint64 Incoming =    NodeAdapter::instance().getIncomingConnectionsCount();
-    m_ui->m_connections->setText(QString(tr("%1 (Outgoing: %2, Incoming: %3)")).arg(Connections).arg(Outgoing).arg(Incoming));
-
-    quint64 whitePeerList = NodeAdapter::instance().getWhitePeerlistSize();
-    quint64 greyPeerList = NodeAdapter::instance().getGreyPeerlistSize();
-    m_ui->m_peerList->setText(QString(tr("White: %1, Grey: %2")).arg(whitePeerList).arg(greyPeerList));
-
-    quint64 lastKnownBlockHeight = NodeAdapter::instance().getLastKnownBlockHeight();
-    quint64 lastLocalBlockHeight = NodeAdapter::instance().getLastLocalBlockHeight();
-    m_ui->m_height->setText(QString(tr("Known: %1, Local: %2")).arg(lastKnownBlockHeight).arg(lastLocalBlockHeight));
-
-    const QDateTime blockTime = NodeAdapter::instance().getLastLocalBlockTimestamp();
-    m_ui->m_blockTime->setText(QString(tr("%1")).arg(QLocale(QLocale::English).toString(blockTime, "dd.MM.yyyy, HH:mm:ss UTC")));
-
-    quint64 difficulty = NodeAdapter::instance().getDifficulty();
-    m_ui->m_difficulty->setText(QString(tr("%1")).arg(difficulty));
-
-    quint64 txCount = NodeAdapter::instance().getTxCount();
-    m_ui->m_txCount->setText(QString(tr("%1")).arg(txCount));
-
-    quint64 txPoolSize = NodeAdapter::instance().getTxPoolSize();
-    m_ui->m_txPoolSize->setText(QString(tr("%1")).arg(txPoolSize));
-
-    quint64 altBlocks = NodeAdapter::instance().getAltBlocksCount();
-    m_ui->m_altBlocksCount->setText(QString(tr("%1")).arg(altBlocks));
-
-    quint64 coinsInCirculation = NodeAdapter::instance().getAlreadyGeneratedCoins();
-    m_ui->m_alreadyGeneratedCoins->setText(QString(tr("%1 %2")).arg(CurrencyAdapter::instance().formatAmount(coinsInCirculation)).arg(CurrencyAdapter::instance().getCurrencyTicker()));
-
+void InfoDialog::updateStats() {
+  const NodeStatsSnapshot& stats = NodeStats::instance().snapshot();
+  if (!stats.valid) {
     return;
   }
 
-  QDialog::timerEvent(_event);
+  m_ui->m_connections->setText(QString(tr("%1 (Outgoing: %2, Incoming: %3)")).arg(stats.peerCount).arg(stats.outgoingConnectionsCount).arg(stats.incomingConnectionsCount));
+  m_ui->m_peerList->setText(QString(tr("White: %1, Grey: %2")).arg(stats.whitePeerlistSize).arg(stats.greyPeerlistSize));
+  m_ui->m_height->setText(QString(tr("Known: %1, Local: %2")).arg(stats.lastKnownBlockHeight).arg(stats.lastLocalBlockHeight));
+  m_ui->m_blockTime->setText(QString(tr("%1")).arg(QLocale(QLocale::English).toString(stats.lastLocalBlockTimestamp, "dd.MM.yyyy, HH:mm:ss UTC")));
+  m_ui->m_difficulty->setText(QString(tr("%1")).arg(stats.difficulty));
+  m_ui->m_txCount->setText(QString(tr("%1")).arg(stats.txCount));
+  m_ui->m_txPoolSize->setText(QString(tr("%1")).arg(stats.txPoolSize));
+  m_ui->m_altBlocksCount->setText(QString(tr("%1")).arg(stats.altBlocksCount));
+  m_ui->m_alreadyGeneratedCoins->setText(QString(tr("%1 %2")).arg(CurrencyAdapter::instance().formatAmount(stats.alreadyGeneratedCoins)).arg(CurrencyAdapter::instance().getCurrencyTicker()));
 }
 
 void InfoDialog::copyAddressClicked() {
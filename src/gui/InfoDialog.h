@@ -29,13 +29,11 @@ public Q_SLOTS:
   void copyAddressClicked();
   void copyIdClicked();
 
-protected:
-  void timerEvent(QTimerEvent* _event) Q_DECL_OVERRIDE;
-
 private:
   QScopedPointer<Ui::InfoDialog> m_ui;
   QMenu* m_contextMenu;
-  int m_refreshTimerId;
+
+  void updateStats();
 };
 
 }
@@ -43,6 +43,7 @@
 #include "CurrencyAdapter.h"
 #include "ExitWidget.h"
 #include "GetBalanceProofDialog.h"
+#include "CheckBalanceProofDialog.h"
 #include "NewPasswordDialog.h"
 #include "NodeAdapter.h"
 #include "PasswordDialog.h"
@@ -123,6 +124,10 @@ void MainWindow::connectToSignals() {
     }
   });
   connect(&NodeAdapter::instance(), &NodeAdapter::peerCountUpdatedSignal, this, &MainWindow::peerCountUpdated, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::bootstrapImportProgressSignal, this, &MainWindow::bootstrapImportProgress, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::bootstrapImportFinishedSignal, this, &MainWindow::bootstrapImportFinished, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::bootstrapExportProgressSignal, this, &MainWindow::bootstrapExportProgress, Qt::QueuedConnection);
+  connect(&NodeAdapter::instance(), &NodeAdapter::bootstrapExportFinishedSignal, this, &MainWindow::bootstrapExportFinished, Qt::QueuedConnection);
   connect(m_ui->m_exitAction, &QAction::triggered, qApp, &QApplication::quit);
   connect(m_ui->m_sendFrame, &SendFrame::uriOpenSignal, this, &MainWindow::onUriOpenSignal, Qt::QueuedConnection);
   connect(m_ui->m_noWalletFrame, &NoWalletFrame::createWalletClickedSignal, this, &MainWindow::createWallet, Qt::QueuedConnection);
@@ -720,6 +725,11 @@ void MainWindow::getBalanceProof() {
   dlg.exec();
 }
 
+void MainWindow::checkBalanceProof() {
+  CheckBalanceProofDialog dlg(&MainWindow::instance());
+  dlg.exec();
+}
+
 void MainWindow::showStatusInfo() {
   InfoDialog dlg(this);
   dlg.exec();
@@ -760,6 +770,64 @@ void MainWindow::openLogFile() {
   }
 }
 
+void MainWindow::importBootstrap() {
+  if (NodeAdapter::instance().isBootstrapImportRunning()) {
+    QMessageBox::information(this, tr("Import blockchain"), tr("Blockchain import is already running."));
+    return;
+  }
+
+  QString filePath = QFileDialog::getOpenFileName(this, tr("Import blockchain"), QDir::homePath(), tr("Bootstrap files (*.bin *.dat);;All files (*)"));
+  if (filePath.isEmpty()) {
+    return;
+  }
+
+  if (!NodeAdapter::instance().importBootstrap(filePath)) {
+    QMessageBox::warning(this, tr("Import blockchain"), tr("Blockchain can only be imported into the builtin node."));
+  }
+}
+
+void MainWindow::bootstrapImportProgress(quint32 _current, quint32 _total) {
+  setStatusBarText(tr("Importing blockchain: %1 of %2 blocks").arg(_current).arg(_total));
+}
+
+void MainWindow::bootstrapImportFinished(bool _ok, const QString& _message) {
+  if (_ok) {
+    setStatusBarText(tr("Blockchain import finished"));
+  } else {
+    setStatusBarText(tr("Blockchain import failed"));
+    QMessageBox::warning(this, tr("Import blockchain"), _message);
+  }
+}
+
+void MainWindow::exportBootstrap() {
+  if (NodeAdapter::instance().isBootstrapExportRunning()) {
+    QMessageBox::information(this, tr("Export blockchain"), tr("Blockchain export is already running."));
+    return;
+  }
+
+  QString filePath = QFileDialog::getSaveFileName(this, tr("Export blockchain"), QDir::homePath(), tr("Bootstrap files (*.bin *.dat);;All files (*)"));
+  if (filePath.isEmpty()) {
+    return;
+  }
+
+  if (!NodeAdapter::instance().exportBootstrap(filePath)) {
+    QMessageBox::warning(this, tr("Export blockchain"), tr("Blockchain can only be exported from the builtin node."));
+  }
+}
+
+void MainWindow::bootstrapExportProgress(quint32 _current, quint32 _total) {
+  setStatusBarText(tr("Exporting blockchain: %1 of %2 blocks").arg(_current).arg(_total));
+}
+
+void MainWindow::bootstrapExportFinished(bool _ok, const QString& _message) {
+  if (_ok) {
+    setStatusBarText(tr("Blockchain export finished"));
+  } else {
+    setStatusBarText(tr("Blockchain export failed"));
+    QMessageBox::warning(this, tr("Export blockchain"), _message);
+  }
+}
+
 void MainWindow::showPrivateKeys() {
   if (!confirmWithPassword()) {
     return;
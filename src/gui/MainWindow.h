@@ -99,6 +99,10 @@ private:
   void peerCountUpdated(quint64 _peer_count);
   void walletSynchronizationInProgress(uint32_t _current, uint32_t _total);
   void walletSynchronized(int _error, const QString& _error_text);
+  void bootstrapImportProgress(quint32 _current, quint32 _total);
+  void bootstrapImportFinished(bool _ok, const QString& _message);
+  void bootstrapExportProgress(quint32 _current, quint32 _total);
+  void bootstrapExportFinished(bool _ok, const QString& _message);
   void walletOpened(bool _error, const QString& _error_text);
   void walletClosed();
   void updateWalletAddress(const QString& _address);
@@ -138,11 +142,14 @@ private:
   Q_SLOT void openRecent();
   Q_SLOT void showStatusInfo();
   Q_SLOT void openLogFile();
+  Q_SLOT void importBootstrap();
+  Q_SLOT void exportBootstrap();
   Q_SLOT void toggleHidden();
   Q_SLOT void showNormalIfMinimized(bool fToggleHidden = false);
   Q_SLOT void showMnemonicSeed();
   Q_SLOT void restoreFromMnemonicSeed();
   Q_SLOT void getBalanceProof();
+  Q_SLOT void checkBalanceProof();
   Q_SLOT void lockWalletWithPassword();
   Q_SLOT void openWalletRpcSettings();
 
@@ -4,6 +4,8 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+
 #include <QDebug>
 #include <QThread>
 #include <QUrl>
@@ -12,10 +14,12 @@
 #include <QDebug>
 
 #include "MiningFrame.h"
+#include "CpuTopology.h"
 #include "MainWindow.h"
 #include "Settings.h"
 #include "WalletAdapter.h"
 #include "NodeAdapter.h"
+#include "NodeStats.h"
 #include "CryptoNoteWrapper.h"
 #include "CurrencyAdapter.h"
 #include "Settings.h"
@@ -27,11 +31,15 @@
 namespace WalletGui {
 
 const quint32 HASHRATE_TIMER_INTERVAL = 1000;
-const quint32 MINER_ROUTINE_TIMER_INTERVAL = 60000;
+// Pool changes come in bursts, at most one template refresh per interval picks
+// them up; a new block refreshes at once
+const quint32 POOL_REFRESH_DELAY = 2000;
 
 MiningFrame::MiningFrame(QWidget* _parent) :
     QFrame(_parent), m_ui(new Ui::MiningFrame),
     m_miner(new Miner(this, LoggerAdapter::instance().getLoggerManager())),
+    m_benchmark(new MiningBenchmark),
+    m_governor(new MiningGovernor(&*m_miner, this)),
     m_soloHashRateTimerId(-1) {
   m_ui->setupUi(this);
   initCpuCoreList();
@@ -43,8 +51,7 @@ MiningFrame::MiningFrame(QWidget* _parent) :
   m_ui->m_startSolo->setEnabled(false);
   m_ui->m_stopSolo->setEnabled(false);
 
-  NodeType node = NodeAdapter::instance().getNodeType();
-  if (node != NodeType::IN_PROCESS) {
+  if (!canMine()) {
     m_ui->m_startSolo->setDisabled(true);
   }
 
@@ -82,11 +89,26 @@ MiningFrame::MiningFrame(QWidget* _parent) :
   connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationCompletedSignal, this, &MiningFrame::onSynchronizationCompleted, Qt::QueuedConnection);
   connect(&NodeAdapter::instance(), &NodeAdapter::localBlockchainUpdatedSignal, this, &MiningFrame::onBlockHeightUpdated, Qt::QueuedConnection);
   connect(&NodeAdapter::instance(), &NodeAdapter::poolChangedSignal, this, &MiningFrame::poolChanged,Qt::QueuedConnection);
+  connect(&NodeStats::instance(), &NodeStats::statsUpdatedSignal, this, &MiningFrame::updateDifficulty);
   connect(&*m_miner, &Miner::minerMessageSignal, this, &MiningFrame::updateMinerLog, Qt::QueuedConnection);
+  connect(&*m_benchmark, &MiningBenchmark::benchmarkProgressSignal, this, &MiningFrame::benchmarkProgress, Qt::QueuedConnection);
+  connect(&*m_benchmark, &MiningBenchmark::benchmarkFinishedSignal, this, &MiningFrame::benchmarkFinished, Qt::QueuedConnection);
+  connect(&*m_governor, &MiningGovernor::activeThreadsChangedSignal, this, &MiningFrame::governorChanged);
+
+  m_poolRefreshTimer.setSingleShot(true);
+  m_poolRefreshTimer.setInterval(POOL_REFRESH_DELAY);
+  connect(&m_poolRefreshTimer, &QTimer::timeout, this, [this]() {
+    if (m_miner->is_mining()) {
+      m_miner->on_block_chain_update();
+    }
+  });
 }
 
 MiningFrame::~MiningFrame() {
   stopSolo();
+  if (m_statsSubscribed) {
+    NodeStats::instance().unsubscribe();
+  }
 }
 
 void MiningFrame::addPoint(double x, double y)
@@ -114,22 +136,52 @@ void MiningFrame::plot()
 void MiningFrame::timerEvent(QTimerEvent* _event) {
   if (_event->timerId() == m_soloHashRateTimerId) {
     m_miner->merge_hr();
+    updateGovernorLabel();
     double hashRate = m_miner->get_speed();
     if (hashRate == 0) {
       return;
     }
     m_ui->m_soloLabel->setText(tr("Mining"));
     m_ui->m_hashratelcdNumber->display(hashRate);
+    double signCost = 0;
+    double powCost = 0;
+    m_miner->get_hash_cost(signCost, powCost);
+    m_ui->m_hashratelcdNumber->setToolTip(tr("Time per hash: signing %1 us, PoW %2 us").arg(signCost, 0, 'f', 1).arg(powCost, 0, 'f', 1));
+    uint64_t lastStale = 0;
+    uint64_t totalStale = 0;
+    uint32_t staleTemplates = 0;
+    m_miner->get_stale_stats(lastStale, totalStale, staleTemplates);
+    if (staleTemplates > 0) {
+      m_ui->m_hashratelcdNumber->setToolTip(m_ui->m_hashratelcdNumber->toolTip() + "\n" +
+        tr("Stale template: %1 ms after the last block, %2 thread-s over %3 block(s)").arg(lastStale).arg(totalStale / 1000.0, 0, 'f', 1).arg(staleTemplates));
+    }
+
+    updateThreadHashRates();
     addPoint(QDateTime::currentDateTime().toTime_t(), hashRate);
     plot();
 
     return;
   }
-  if (_event->timerId() == m_minerRoutineTimerId) {
-    m_miner->on_block_chain_update();
+  QFrame::timerEvent(_event);
+}
+
+void MiningFrame::showEvent(QShowEvent* _event) {
+  // the difficulty is only polled while it can be seen
+  if (!m_statsSubscribed) {
+    m_statsSubscribed = true;
+    NodeStats::instance().subscribe();
   }
 
-  QFrame::timerEvent(_event);
+  QFrame::showEvent(_event);
+}
+
+void MiningFrame::hideEvent(QHideEvent* _event) {
+  if (m_statsSubscribed) {
+    m_statsSubscribed = false;
+    NodeStats::instance().unsubscribe();
+  }
+
+  QFrame::hideEvent(_event);
 }
 
 void MiningFrame::initCpuCoreList() {
@@ -149,6 +201,74 @@ void MiningFrame::initCpuCoreList() {
   m_ui->m_cpuCoresSpin->setMinimum(1);
   m_ui->m_cpuDial->setMaximum(cpuCoreCount);
   m_ui->m_cpuDial->setMinimum(1);
+
+  const CpuTopology& topology = CpuTopology::instance();
+  m_ui->m_topologyLabel->setText(topology.describe());
+  m_ui->m_pinThreadsCheck->setChecked(topology.isAvailable() && Settings::instance().isMiningThreadPinningEnabled());
+  m_ui->m_pinThreadsCheck->setEnabled(topology.isAvailable());
+  m_ui->m_skipSmtCheck->setChecked(Settings::instance().isMiningSkipSmtEnabled());
+  m_ui->m_skipSmtCheck->setEnabled(m_ui->m_pinThreadsCheck->isChecked());
+
+  m_ui->m_governorCheck->setChecked(Settings::instance().isMiningGovernorEnabled());
+  m_ui->m_scheduleCheck->setChecked(Settings::instance().isMiningScheduleEnabled());
+  m_ui->m_scheduleCheck->setEnabled(m_ui->m_governorCheck->isChecked());
+  // setting one time saves both, read them first
+  const QTime startTime = Settings::instance().getMiningStartTime();
+  const QTime stopTime = Settings::instance().getMiningStopTime();
+  m_ui->m_scheduleStartTime->setTime(startTime);
+  m_ui->m_scheduleStopTime->setTime(stopTime);
+  m_ui->m_scheduleStartTime->setEnabled(m_ui->m_scheduleCheck->isEnabled() && m_ui->m_scheduleCheck->isChecked());
+  m_ui->m_scheduleStopTime->setEnabled(m_ui->m_scheduleStartTime->isEnabled());
+}
+
+void MiningFrame::applyThreadAffinity() {
+  std::vector<int> cpus;
+  if (m_ui->m_pinThreadsCheck->isChecked()) {
+    QVector<int> miningCpus = CpuTopology::instance().miningCpus(m_ui->m_skipSmtCheck->isChecked());
+    cpus.assign(miningCpus.begin(), miningCpus.end());
+  }
+
+  m_miner->set_thread_affinity(cpus);
+}
+
+void MiningFrame::updateThreadHashRates() {
+  std::vector<double> speeds = m_miner->get_thread_speeds();
+  if (speeds.empty()) {
+    m_ui->m_threadHashRatesLabel->clear();
+    return;
+  }
+
+  // a thread well below the others usually shares its core or sits on a slow one
+  std::vector<double> sorted(speeds);
+  std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+  const double median = sorted[sorted.size() / 2];
+  QStringList threads;
+  for (size_t i = 0; i < speeds.size(); ++i) {
+    QString rate = QString::number(speeds[i], 'f', 1);
+    if (speeds[i] < median * 0.75) {
+      rate = QString("<b>%1</b>").arg(rate);
+    }
+
+    threads.append(QString("#%1: %2").arg(i + 1).arg(rate));
+  }
+
+  m_ui->m_threadHashRatesLabel->setText(tr("Per thread, H/s: %1").arg(threads.join(", ")));
+}
+
+void MiningFrame::updateGovernorLabel() {
+  if (!m_solo_mining) {
+    m_ui->m_governorLabel->clear();
+    return;
+  }
+
+  QString text = tr("%1 of %2 thread(s) mining, duty cycle %3%").arg(m_governor->activeThreads()).arg(m_ui->m_cpuCoresSpin->value()).
+    arg(m_governor->dutyCycle() * 100, 0, 'f', 0);
+  const QString reason = m_governor->reason();
+  if (!reason.isEmpty()) {
+    text += QString(" (%1)").arg(reason);
+  }
+
+  m_ui->m_governorLabel->setText(text);
 }
 
 void MiningFrame::walletOpened() {
@@ -157,8 +277,7 @@ void MiningFrame::walletOpened() {
 
   m_wallet_closed = false;
 
-  quint64 difficulty = NodeAdapter::instance().getDifficulty();
-  m_ui->m_difficulty->setText(QString(tr("%1")).arg(difficulty));
+  updateDifficulty();
 }
 
 void MiningFrame::walletClosed() {
@@ -175,37 +294,48 @@ bool MiningFrame::isSoloRunning() const {
 }
 
 void MiningFrame::startSolo() {
-  quint64 difficulty = NodeAdapter::instance().getDifficulty();
-  m_ui->m_difficulty->setText(QString(tr("%1")).arg(difficulty));
+  if (m_benchmark->isRunning()) {
+    m_ui->m_startSolo->setChecked(false);
+    return;
+  }
 
+  updateDifficulty();
+
+  applyThreadAffinity();
+  m_miner->set_hash_ways(Settings::instance().getMiningHashWays());
   m_miner->start(m_ui->m_cpuCoresSpin->value());
+  m_solo_mining = true;
+  m_governor->start(m_ui->m_cpuCoresSpin->value());
   m_ui->m_soloLabel->setText(tr("Starting..."));
   m_soloHashRateTimerId = startTimer(HASHRATE_TIMER_INTERVAL);
-  m_minerRoutineTimerId = startTimer(MINER_ROUTINE_TIMER_INTERVAL);
   addPoint(QDateTime::currentDateTime().toTime_t(), 0);
   m_ui->m_startSolo->setChecked(true);
   m_ui->m_startSolo->setEnabled(false);
   m_ui->m_stopSolo->setEnabled(true);
-  m_ui->m_cpuCoresSpin->setEnabled(false);
-  m_ui->m_cpuDial->setEnabled(false);
-  m_solo_mining = true;
+  m_ui->m_pinThreadsCheck->setEnabled(false);
+  m_ui->m_skipSmtCheck->setEnabled(false);
+  m_ui->m_benchmarkButton->setEnabled(false);
 }
 
 void MiningFrame::stopSolo() {
   if(m_solo_mining) {
     killTimer(m_soloHashRateTimerId);
     m_soloHashRateTimerId = -1;
-    killTimer(m_minerRoutineTimerId);
-    m_minerRoutineTimerId = -1;
+    m_poolRefreshTimer.stop();
+    m_governor->stop();
     m_miner->stop();
+    updateMinerLog(tr("Mined %1% of the configured thread time").arg(m_governor->dutyCycle() * 100, 0, 'f', 1));
     addPoint(QDateTime::currentDateTime().toTime_t(), 0);
     m_ui->m_soloLabel->setText(tr("Stopped"));
     m_ui->m_hashratelcdNumber->display(0.0);
+    m_ui->m_threadHashRatesLabel->clear();
+    m_ui->m_governorLabel->clear();
     if (!m_wallet_closed) {
       m_ui->m_startSolo->setEnabled(true);
       m_ui->m_stopSolo->setEnabled(false);
-      m_ui->m_cpuCoresSpin->setEnabled(true);
-      m_ui->m_cpuDial->setEnabled(true);
+      m_ui->m_pinThreadsCheck->setEnabled(CpuTopology::instance().isAvailable());
+      m_ui->m_skipSmtCheck->setEnabled(m_ui->m_pinThreadsCheck->isChecked());
+      m_ui->m_benchmarkButton->setEnabled(true);
     }
     m_solo_mining = false;
     m_mining_was_stopped = true;
@@ -239,23 +369,48 @@ void MiningFrame::setMiningThreads() {
 }
 
 void MiningFrame::onBlockHeightUpdated() {
+  if (m_solo_mining && !canMine()) {
+    // the chain moved on to a block version a daemon's templates cannot be mined for
+    updateMinerLog(m_ui->m_startSolo->toolTip());
+    stopSolo();
+    m_ui->m_startSolo->setEnabled(false);
+    return;
+  }
+
   if (m_miner->is_mining()) {
-    m_miner->on_block_chain_update();
+    // the new template includes the pool as it is now
+    m_poolRefreshTimer.stop();
+    m_miner->on_new_block();
   }
+}
 
-  quint64 difficulty = NodeAdapter::instance().getDifficulty();
-  m_ui->m_difficulty->setText(QString(tr("%1")).arg(difficulty));
+void MiningFrame::updateDifficulty() {
+  const NodeStatsSnapshot& stats = NodeStats::instance().snapshot();
+  m_ui->m_difficulty->setText(QString(tr("%1")).arg(stats.difficulty));
 }
 
 void MiningFrame::onSynchronizationCompleted() {
-  NodeType node = NodeAdapter::instance().getNodeType();
-  if (node != NodeType::IN_PROCESS) {
+  if (!canMine()) {
     m_ui->m_startSolo->setEnabled(false);
     return;
   }
   enableSolo();
 }
 
+bool MiningFrame::canMine() {
+  // A daemon hands out templates and takes blocks over RPC, but from block
+  // version 5 on the PoW needs the whole chain, which only the builtin node has
+  NodeType node = NodeAdapter::instance().getNodeType();
+  if (node == NodeType::IN_PROCESS ||
+      (node == NodeType::RPC && NodeAdapter::instance().getCurrentBlockMajorVersion() < CryptoNote::BLOCK_MAJOR_VERSION_5)) {
+    m_ui->m_startSolo->setToolTip(QString());
+    return true;
+  }
+
+  m_ui->m_startSolo->setToolTip(tr("Mining this block version needs the blockchain, switch to the embedded node"));
+  return false;
+}
+
 void MiningFrame::updateBalance(quint64 _balance) {
   Q_UNUSED(_balance);
 }
@@ -277,13 +432,102 @@ void MiningFrame::updateMinerLog(const QString& _message) {
 void MiningFrame::coreDealTurned(int _cores) {
   QTimer::singleShot(600, [this, _cores]() {
     Settings::instance().setMiningThreads(_cores);
+    // the dial fires on every notch, only the value it settled on resizes the pool
+    if (m_miner->is_mining() && m_ui->m_cpuCoresSpin->value() == _cores) {
+      // the pool cannot grow beyond the threads it was started with, the
+      // spin box goes back to what is running and fires this again
+      if (!m_miner->set_threads_count(_cores)) {
+        m_ui->m_cpuCoresSpin->setValue(static_cast<int>(m_miner->get_threads_count()));
+        return;
+      }
+
+      m_governor->setMaxThreads(_cores);
+    }
   } );
 }
 
+void MiningFrame::pinThreadsToggled(bool _checked) {
+  Settings::instance().setMiningThreadPinningEnabled(_checked);
+  m_ui->m_skipSmtCheck->setEnabled(_checked);
+}
+
+void MiningFrame::skipSmtToggled(bool _checked) {
+  Settings::instance().setMiningSkipSmtEnabled(_checked);
+}
+
+void MiningFrame::governorToggled(bool _checked) {
+  m_governor->setEnabled(_checked);
+  m_ui->m_scheduleCheck->setEnabled(_checked);
+  m_ui->m_scheduleStartTime->setEnabled(_checked && m_ui->m_scheduleCheck->isChecked());
+  m_ui->m_scheduleStopTime->setEnabled(m_ui->m_scheduleStartTime->isEnabled());
+}
+
+void MiningFrame::scheduleToggled(bool _checked) {
+  // the governor reads the schedule on its next round
+  Settings::instance().setMiningScheduleEnabled(_checked);
+  m_ui->m_scheduleStartTime->setEnabled(_checked);
+  m_ui->m_scheduleStopTime->setEnabled(_checked);
+}
+
+void MiningFrame::scheduleTimeChanged() {
+  Settings::instance().setMiningStartTime(m_ui->m_scheduleStartTime->time());
+  Settings::instance().setMiningStopTime(m_ui->m_scheduleStopTime->time());
+}
+
+void MiningFrame::benchmarkClicked() {
+  if (m_benchmark->isRunning()) {
+    m_benchmark->cancel();
+    return;
+  }
+
+  if (m_solo_mining) {
+    return;
+  }
+
+  // the benchmark needs every core to itself
+  m_ui->m_startSolo->setEnabled(false);
+  m_ui->m_benchmarkButton->setText(tr("Cancel benchmark"));
+  updateMinerLog(tr("Benchmarking, mining is unavailable until it finishes"));
+  // nonce batches are only hashed for blocks the miner hashes itself
+  m_benchmark->start(NodeAdapter::instance().getCurrentBlockMajorVersion() < CryptoNote::BLOCK_MAJOR_VERSION_5);
+}
+
+void MiningFrame::benchmarkProgress(int _current, int _total, const QString& _message) {
+  updateMinerLog(QString("[%1/%2] %3").arg(_current).arg(_total).arg(_message));
+}
+
+void MiningFrame::benchmarkFinished(bool _completed) {
+  m_ui->m_benchmarkButton->setText(tr("Benchmark"));
+  m_ui->m_startSolo->setEnabled(m_sychronized && canMine());
+  const int best = m_benchmark->bestIndex();
+  if (!_completed || best < 0) {
+    updateMinerLog(tr("Benchmark cancelled"));
+    return;
+  }
+
+  const MiningBenchmarkResult& result = m_benchmark->results()[best];
+  m_benchmark->applyBest();
+  m_ui->m_cpuCoresSpin->setValue(result.threads);
+  m_ui->m_pinThreadsCheck->setChecked(result.pinned);
+  m_ui->m_skipSmtCheck->setChecked(result.skipSmt);
+  updateMinerLog(tr("Best: %1").arg(MiningBenchmark::describe(result)));
+}
+
 void MiningFrame::poolChanged() {
-  if (m_miner->is_mining()) {
-    m_miner->on_block_chain_update();
+  if (m_miner->is_mining() && !m_poolRefreshTimer.isActive()) {
+    m_poolRefreshTimer.start();
   }
 }
 
+void MiningFrame::governorChanged(quint32 _activeThreads, quint32 _maxThreads, const QString& _reason) {
+  QString formattedTime = QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss");
+  QString message = tr("%1 Mining with %2 of %3 thread(s)").arg(formattedTime).arg(_activeThreads).arg(_maxThreads);
+  if (!_reason.isEmpty()) {
+    message += QString(", %1").arg(_reason);
+  }
+
+  updateMinerLog(message);
+  updateGovernorLabel();
+}
+
 }
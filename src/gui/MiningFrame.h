@@ -7,8 +7,11 @@
 #pragma once
 
 #include <QFrame>
+#include <QTimer>
 #include "qcustomplot.h"
 #include "Miner.h"
+#include "MiningBenchmark.h"
+#include "MiningGovernor.h"
 #include <Logging/LoggerMessage.h>
 
 class QAbstractButton;
@@ -35,20 +38,29 @@ public:
 
 protected:
   void timerEvent(QTimerEvent* _event) Q_DECL_OVERRIDE;
+  void showEvent(QShowEvent* _event) Q_DECL_OVERRIDE;
+  void hideEvent(QHideEvent* _event) Q_DECL_OVERRIDE;
 
 private:
   QScopedPointer<Ui::MiningFrame> m_ui;
   int m_soloHashRateTimerId;
-  int m_minerRoutineTimerId;
+  QTimer m_poolRefreshTimer;
   QVector<double> m_hX, m_hY;
   std::unique_ptr<Miner> m_miner;
+  std::unique_ptr<MiningBenchmark> m_benchmark;
+  std::unique_ptr<MiningGovernor> m_governor;
   QString m_miner_log;
 
   void initCpuCoreList();
+  bool canMine();
+  void applyThreadAffinity();
+  void updateThreadHashRates();
+  void updateGovernorLabel();
   void startSolo();
   void stopSolo();
 
   bool m_wallet_closed = false;
+  bool m_statsSubscribed = false;
   bool m_solo_mining = false;
   bool m_sychronized = false;
   bool m_mining_was_stopped = false;
@@ -62,12 +74,22 @@ private:
   Q_SLOT void enableSolo();
   Q_SLOT void setMiningThreads();
   Q_SLOT void onBlockHeightUpdated();
+  Q_SLOT void updateDifficulty();
   Q_SLOT void onSynchronizationCompleted();
   Q_SLOT void updateBalance(quint64 _balance);
   Q_SLOT void updatePendingBalance(quint64 _balance);
   Q_SLOT void updateMinerLog(const QString& _message);
   Q_SLOT void coreDealTurned(int _cores);
+  Q_SLOT void pinThreadsToggled(bool _checked);
+  Q_SLOT void skipSmtToggled(bool _checked);
+  Q_SLOT void benchmarkClicked();
+  Q_SLOT void benchmarkProgress(int _current, int _total, const QString& _message);
+  Q_SLOT void benchmarkFinished(bool _completed);
   Q_SLOT void poolChanged();
+  Q_SLOT void governorToggled(bool _checked);
+  Q_SLOT void scheduleToggled(bool _checked);
+  Q_SLOT void scheduleTimeChanged();
+  Q_SLOT void governorChanged(quint32 _activeThreads, quint32 _maxThreads, const QString& _reason);
 };
 
 }
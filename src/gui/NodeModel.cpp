@@ -6,6 +6,7 @@
 #include <iostream>
 #include <QIcon>
 #include "NodeModel.h"
+#include "NodeAdapter.h"
 #include "Settings.h"
 #include "QUrl"
 
@@ -14,6 +15,8 @@ namespace WalletGui {
 NodeModel::NodeModel(QObject* parent) : QAbstractTableModel(parent),
                                         m_nodesCurrentIndex(0) {
   m_RpcNodesList = QVector<NodeSetting>(Settings::instance().getRpcNodesList());
+  m_scores = NodeAdapter::instance().getRemoteNodeScores();
+  connect(&NodeAdapter::instance(), &NodeAdapter::remoteNodeScoresUpdatedSignal, this, &NodeModel::updateScores);
 }
 
 NodeModel::~NodeModel() {
@@ -29,6 +32,13 @@ QVariant NodeModel::data(const QModelIndex &index, int role) const {
     if (index.column() == 1) value = QVariant(data.host);
     else if (index.column() == 2) value = QVariant(data.port);
     else if (index.column() == 3) value = QVariant(data.path);
+    else if (const RemoteNodeScore* score = findScore(data)) {
+      // Live scores of the remote node pool, lower score is better
+      if (index.column() == 4) value = score->online ? tr("%1 ms").arg(score->rtt) : tr("offline");
+      else if (index.column() == 5 && score->online) value = score->lag == 0 ? tr("synced") : tr("%1 blocks behind").arg(score->lag);
+      else if (index.column() == 6) value = tr("%1% errors").arg(qRound(score->errorRate * 100));
+      else if (index.column() == 7 && score->online) value = score->active ? tr("score %1, active").arg(qRound(score->score)) : tr("score %1").arg(qRound(score->score));
+    }
   } else if (role == Qt::DecorationRole && index.column() == 0) {
     QString encryptionIconPath = data.ssl ? ":icons/encrypted" : ":icons/decrypted";
     QPixmap encryptionIcon = QPixmap(encryptionIconPath).scaled(16, 16, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
@@ -46,7 +56,7 @@ int NodeModel::rowCount(const QModelIndex &parent) const {
 
 int NodeModel::columnCount(const QModelIndex &parent) const {
   Q_UNUSED(parent);
-  return 4;
+  return 8;
 }
 
 Qt::ItemFlags NodeModel::flags(const QModelIndex& _index) const {
@@ -89,5 +99,22 @@ NodeSetting NodeModel::getDataByIndex(const int &index) const {
   return m_RpcNodesList[index];
 }
 
+void NodeModel::updateScores() {
+  m_scores = NodeAdapter::instance().getRemoteNodeScores();
+  if (!m_RpcNodesList.isEmpty()) {
+    Q_EMIT dataChanged(index(0, 4), index(m_RpcNodesList.count() - 1, columnCount() - 1), QVector<int>() << Qt::DisplayRole);
+  }
+}
+
+const RemoteNodeScore* NodeModel::findScore(const NodeSetting& _node) const {
+  for (const RemoteNodeScore& score : m_scores) {
+    if (score.node.host == _node.host && score.node.port == _node.port) {
+      return &score;
+    }
+  }
+
+  return nullptr;
+}
+
 }
 
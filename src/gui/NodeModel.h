@@ -7,6 +7,7 @@
 
 #include <QAbstractListModel>
 #include "Settings.h"
+#include "RemoteNodePool.h"
 
 namespace WalletGui {
 
@@ -28,7 +29,11 @@ public:
 
 private:
   QVector<NodeSetting> m_RpcNodesList;
+  QVector<RemoteNodeScore> m_scores;
   int m_nodesCurrentIndex;
+
+  void updateScores();
+  const RemoteNodeScore* findScore(const NodeSetting& _node) const;
 };
 
 }
@@ -5,10 +5,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <QApplication>
+#include <QLocale>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardPaths>
 #include "RestoreFromMnemonicSeedDialog.h"
+#include "NodeAdapter.h"
 #include "Mnemonics/electrum-words.h"
 
 extern "C"
@@ -23,6 +25,7 @@ namespace WalletGui {
 
 RestoreFromMnemonicSeedDialog::RestoreFromMnemonicSeedDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::RestoreFromMnemonicSeedDialog) {
   m_ui->setupUi(this);
+  connect(&NodeAdapter::instance(), &NodeAdapter::blockHeadersReceivedSignal, this, &RestoreFromMnemonicSeedDialog::blockHeadersReceived);
   m_ui->m_okButton->setEnabled(false);
 }
 
@@ -99,4 +102,23 @@ void RestoreFromMnemonicSeedDialog::onAccept() {
   accept();
 }
 
+void RestoreFromMnemonicSeedDialog::syncHeightChanged(int _height) {
+  showSyncHeightTime(NodeAdapter::instance().estimateBlockTime(_height));
+  // The estimate is replaced with the exact time once the node sent the header
+  NodeAdapter::instance().requestBlockHeader(_height);
+}
+
+void RestoreFromMnemonicSeedDialog::blockHeadersReceived(const QVector<CryptoNote::BlockHeaderInfo>& _headers) {
+  for (const CryptoNote::BlockHeaderInfo& header : _headers) {
+    if (header.index == getSyncHeight()) {
+      showSyncHeightTime(QDateTime::fromTime_t(header.timestamp, Qt::UTC));
+    }
+  }
+}
+
+void RestoreFromMnemonicSeedDialog::showSyncHeightTime(const QDateTime& _blockTime) {
+  m_ui->m_syncHeight->setToolTip(_blockTime.isValid() ?
+    tr("Block of about %1").arg(QLocale(QLocale::English).toString(_blockTime, "dd.MM.yyyy")) : QString());
+}
+
 }
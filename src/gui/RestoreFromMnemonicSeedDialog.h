@@ -7,7 +7,9 @@
 #pragma once
 
 #include <QDialog>
+#include <QVector>
 #include <CryptoNote.h>
+#include <INode.h>
 
 namespace Ui {
 class RestoreFromMnemonicSeedDialog;
@@ -36,6 +38,9 @@ private:
   Q_SLOT void selectPathClicked();
   Q_SLOT void onTextChanged();
   Q_SLOT void onAccept();
+  Q_SLOT void syncHeightChanged(int _height);
+  void blockHeadersReceived(const QVector<CryptoNote::BlockHeaderInfo>& _headers);
+  void showSyncHeightTime(const QDateTime& _blockTime);
 };
 
 }
@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <QRegExpValidator>
+#include <QFileDialog>
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QUrlQuery>
@@ -12,10 +13,12 @@
 #include <QUrl>
 
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
+#include "BatchPayout.h"
 #include "AddressBookModel.h"
 #include "CurrencyAdapter.h"
 #include "MainWindow.h"
 #include "NodeAdapter.h"
+#include "NodeStats.h"
 #include "SendFrame.h"
 #include "TransferFrame.h"
 #include "WalletAdapter.h"
@@ -32,7 +35,7 @@
 namespace WalletGui {
 
 SendFrame::SendFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::SendFrame), m_glassFrame(new SendGlassFrame(nullptr)),
-    m_nodeFee(0), m_flatRateNodeFee(0), m_selectedOutputsAmount(0)
+    m_batchPayout(new BatchPayout(this)), m_batchProgress(nullptr), m_nodeFee(0), m_flatRateNodeFee(0), m_selectedOutputsAmount(0)
 {
   m_ui->setupUi(this);
   m_glassFrame->setObjectName("m_sendGlassFrame");
@@ -52,6 +55,8 @@ SendFrame::SendFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::SendFrame
     Qt::QueuedConnection);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletSynchronizationProgressUpdatedSignal,
     this, &SendFrame::walletSynchronizationInProgress, Qt::QueuedConnection);
+  connect(m_batchPayout, &BatchPayout::batchStatusChangedSignal, this, &SendFrame::batchStatusChanged);
+  connect(m_batchPayout, &BatchPayout::payoutFinishedSignal, this, &SendFrame::batchPayoutFinished);
 
   m_ui->m_feeSpin->setSuffix(" " + CurrencyAdapter::instance().getCurrencyTicker().toUpper());
   m_ui->m_donateSpin->setSuffix(" " + CurrencyAdapter::instance().getCurrencyTicker().toUpper());
@@ -87,6 +92,8 @@ SendFrame::SendFrame(QWidget* _parent) : QFrame(_parent), m_ui(new Ui::SendFrame
     m_ui->m_remote_label->setText(QString(tr("Node fee: %1 %2")).arg(CurrencyAdapter::instance().formatAmount(m_flatRateNodeFee).remove(QRegExp("0+$"))).arg(CurrencyAdapter::instance().getCurrencyTicker().toUpper()));
     m_ui->m_remote_label->show();
     amountValueChanged();
+    // the node pool may move to a node with another fee address, or none
+    connect(&NodeAdapter::instance(), &NodeAdapter::nodeFeeAddressChangedSignal, this, &SendFrame::nodeFeeAddressChanged, Qt::QueuedConnection);
   }
   m_ui->m_advancedWidget->hide();
 }
@@ -102,7 +109,7 @@ void SendFrame::walletSynchronized(int _error, const QString& _error_text) {
 }
 
 void SendFrame::walletSynchronizationInProgress(quint64 _current, quint64 _total) {
-  if (!NodeAdapter::instance().isOffline()) {
+  if (NodeStats::instance().snapshot().connectionsCount > 0) {
     m_glassFrame->install(this);
     m_glassFrame->updateSynchronizationState(_current, _total);
   }
@@ -147,7 +154,7 @@ void SendFrame::addRecipientClicked() {
 }
 
 double SendFrame::getMinimalFee() {
-  double fee = CurrencyAdapter::instance().formatAmount(NodeAdapter::instance().getMinimalFee()).toDouble();
+  double fee = CurrencyAdapter::instance().formatAmount(NodeStats::instance().snapshot().minimalFee).toDouble();
   return fee;
 }
 
@@ -320,7 +327,7 @@ void SendFrame::sendClicked() {
   }
 
   quint64 actualBalance = WalletAdapter::instance().getActualBalance();
-  if (actualBalance <= NodeAdapter::instance().getMinimalFee()) {
+  if (actualBalance <= NodeStats::instance().snapshot().minimalFee) {
     QCoreApplication::postEvent(
       &MainWindow::instance(),
       new ShowMessageEvent(tr("Insufficient balance."), QtCriticalMsg));
@@ -386,7 +393,7 @@ void SendFrame::sendClicked() {
   priorityValueChanged(m_ui->m_prioritySlider->value());
   quint64 fee = getFee();
 
-  if (fee < NodeAdapter::instance().getMinimalFee()) {
+  if (fee < NodeStats::instance().snapshot().minimalFee) {
     QCoreApplication::postEvent(&MainWindow::instance(), new ShowMessageEvent(tr("Incorrect fee value"), QtCriticalMsg));
     return;
   }
@@ -400,19 +407,7 @@ void SendFrame::sendClicked() {
     return;
   }
 
-  if (Settings::instance().isEncrypted()) {
-    PasswordDialog pass_dlg(false, this);
-    if (pass_dlg.exec() == QDialog::Accepted) {
-      QString password = pass_dlg.getPassword();
-      if (!WalletAdapter::instance().tryOpen(password)) {
-        QMessageBox::critical(nullptr, tr("Incorrect password"), tr("Wrong password."), QMessageBox::Ok);
-        return;
-      }
-    }
-    else {
-      return;
-    }
-  } else if (!WalletAdapter::instance().tryOpen("")) {
+  if (!confirmPassword()) {
     return;
   }
 
@@ -451,6 +446,145 @@ void SendFrame::sendClicked() {
   }
 }
 
+bool SendFrame::confirmPassword() {
+  if (Settings::instance().isEncrypted()) {
+    PasswordDialog pass_dlg(false, this);
+    if (pass_dlg.exec() == QDialog::Accepted) {
+      QString password = pass_dlg.getPassword();
+      if (!WalletAdapter::instance().tryOpen(password)) {
+        QMessageBox::critical(nullptr, tr("Incorrect password"), tr("Wrong password."), QMessageBox::Ok);
+        return false;
+      }
+    }
+    else {
+      return false;
+    }
+  } else if (!WalletAdapter::instance().tryOpen("")) {
+    return false;
+  }
+
+  return true;
+}
+
+void SendFrame::batchPayoutClicked() {
+  if (m_batchPayout->isRunning()) {
+    return;
+  }
+
+  if (!m_ui->m_paymentIdEdit->text().isEmpty() && !isValidPaymentId(m_ui->m_paymentIdEdit->text().toUtf8())) {
+    QCoreApplication::postEvent(&MainWindow::instance(), new ShowMessageEvent(tr("Invalid payment ID"), QtCriticalMsg));
+    return;
+  }
+
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Load recipients"), QDir::homePath(), tr("CSV files (*.csv);;All files (*)"));
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  QVector<PayoutRecipient> recipients;
+  QString errorText;
+  if (!BatchPayout::parseCsv(fileName, recipients, errorText)) {
+    QCoreApplication::postEvent(&MainWindow::instance(), new ShowMessageEvent(errorText, QtCriticalMsg));
+    return;
+  }
+
+  std::vector<CryptoNote::WalletLegacyTransfer> extraTransfers;
+  calculateNodeFee();
+  if (!m_nodeFeeAddress.isEmpty() && m_nodeFee > 0) {
+    CryptoNote::WalletLegacyTransfer walletTransfer;
+    walletTransfer.address = m_nodeFeeAddress.toStdString();
+    walletTransfer.amount = m_nodeFee;
+    extraTransfers.push_back(walletTransfer);
+  }
+
+  priorityValueChanged(m_ui->m_prioritySlider->value());
+  quint64 fee = getFee();
+  if (fee < NodeStats::instance().snapshot().minimalFee) {
+    QCoreApplication::postEvent(&MainWindow::instance(), new ShowMessageEvent(tr("Incorrect fee value"), QtCriticalMsg));
+    return;
+  }
+
+  bool prepared = m_batchPayout->prepare(recipients, extraTransfers, fee, m_ui->m_mixinSlider->value(), m_ui->m_paymentIdEdit->text(), errorText);
+  PayoutEstimate estimate = m_batchPayout->estimate();
+  QString summary = tr("Recipients: %1\nTransactions: %2\nTotal amount: %3 %5\nTotal fee: %4 %5").
+    arg(estimate.recipientCount).
+    arg(estimate.transactionCount).
+    arg(CurrencyAdapter::instance().formatAmount(estimate.totalAmount)).
+    arg(CurrencyAdapter::instance().formatAmount(estimate.totalFee + estimate.totalExtra)).
+    arg(CurrencyAdapter::instance().getCurrencyTicker().toUpper());
+
+  if (!prepared) {
+    QMessageBox::critical(this, tr("Batch payout"), errorText + "\n\n" + summary, QMessageBox::Ok);
+    return;
+  }
+
+  // "Don't relay" turns the payout into a dry run that only reports the estimate
+  if (m_ui->dontRelayCheckBox->isChecked()) {
+    QMessageBox::information(this, tr("Batch payout estimate"), summary, QMessageBox::Ok);
+    return;
+  }
+
+  if (QMessageBox::question(this, tr("Batch payout"), summary + "\n\n" + tr("Send these transactions?"),
+      QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes) {
+    return;
+  }
+
+  if (!confirmPassword()) {
+    return;
+  }
+
+  m_batchProgress = new QProgressDialog(tr("Sending batch payout..."), tr("Cancel"), 0, estimate.transactionCount, this);
+  m_batchProgress->setWindowTitle(tr("Batch payout"));
+  m_batchProgress->setAttribute(Qt::WA_DeleteOnClose);
+  m_batchProgress->setMinimumDuration(0);
+  connect(m_batchProgress, &QProgressDialog::canceled, m_batchPayout, &BatchPayout::cancel);
+  m_batchProgress->show();
+
+  m_ui->m_sendButton->setEnabled(false);
+  m_ui->m_batchPayoutButton->setEnabled(false);
+  m_batchPayout->start();
+}
+
+void SendFrame::batchStatusChanged(int _index, int _status, const QString& _text) {
+  if (m_batchProgress == nullptr) {
+    return;
+  }
+
+  m_batchProgress->setLabelText(_text);
+  if (_status != PayoutBatch::SENDING && _status != PayoutBatch::PENDING) {
+    m_batchProgress->setValue(_index + 1);
+  }
+}
+
+void SendFrame::batchPayoutFinished(int _sent, int _failed) {
+  if (m_batchProgress != nullptr) {
+    m_batchProgress->close();
+    m_batchProgress = nullptr;
+  }
+
+  m_ui->m_sendButton->setEnabled(true);
+  m_ui->m_batchPayoutButton->setEnabled(true);
+
+  QStringList errors;
+  const QVector<PayoutBatch>& batches = m_batchPayout->batches();
+  for (int i = 0; i < batches.size(); ++i) {
+    // who was not paid, by CSV label where there is one
+    if (batches[i].status == PayoutBatch::FAILED) {
+      errors.append(tr("Transaction %1 to %2: %3").arg(i + 1).arg(batches[i].recipients.join(", ")).arg(batches[i].errorText));
+    } else if (batches[i].status == PayoutBatch::CANCELLED) {
+      errors.append(tr("Transaction %1 to %2: cancelled").arg(i + 1).arg(batches[i].recipients.join(", ")));
+    }
+  }
+
+  if (_failed == 0) {
+    QMessageBox::information(this, tr("Batch payout"), tr("All %1 transactions have been sent.").arg(_sent), QMessageBox::Ok);
+    clearAllClicked();
+  } else {
+    QMessageBox::warning(this, tr("Batch payout"), tr("Sent %1 of %2 transactions.").arg(_sent).arg(_sent + _failed) +
+      (errors.isEmpty() ? QString() : "\n\n" + errors.join("\n")), QMessageBox::Ok);
+  }
+}
+
 void SendFrame::mixinValueChanged(int _value) {
   m_ui->m_mixinLabel->setText(QString::number(_value));
 }
@@ -499,7 +633,12 @@ quint64 SendFrame::getFee() {
 }
 
 void SendFrame::sendTransactionCompleted(CryptoNote::TransactionId _id, bool _error, const QString& _errorText) {
-  Q_UNUSED(_id);
+  // The queued completion of a batch can arrive after the payout finished,
+  // batchPayoutFinished() has reported it already
+  if (m_batchPayout->isRunning() || m_batchPayout->isPayoutTransaction(_id)) {
+    return;
+  }
+
   if (_error) {
     QCoreApplication::postEvent(
       &MainWindow::instance(),
@@ -573,7 +712,7 @@ bool SendFrame::confirmZeroMixin() {
 
 void SendFrame::sendAllClicked() {
   quint64 actualBalance = WalletAdapter::instance().getActualBalance();
-  if (actualBalance < NodeAdapter::instance().getMinimalFee()) {
+  if (actualBalance < NodeStats::instance().snapshot().minimalFee) {
     QCoreApplication::postEvent(
       &MainWindow::instance(),
       new ShowMessageEvent(tr("Insufficient balance."), QtCriticalMsg));
@@ -601,11 +740,17 @@ void SendFrame::sendAllClicked() {
   }
 }
 
+void SendFrame::nodeFeeAddressChanged() {
+  m_nodeFeeAddress = NodeAdapter::instance().getNodeFeeAddress();
+  m_ui->m_remote_label->setVisible(!m_nodeFeeAddress.isEmpty());
+  amountValueChanged();
+}
+
 void SendFrame::calculateNodeFee() {
   m_nodeFee = 0;
   if(!m_nodeFeeAddress.isEmpty()) {
     if (m_flatRateNodeFee == 0) {
-      m_nodeFee = NodeAdapter::instance().getMinimalFee();
+      m_nodeFee = NodeStats::instance().snapshot().minimalFee;
     } else {
       m_nodeFee = m_flatRateNodeFee;
     }
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <QFrame>
+#include <QProgressDialog>
 
 #include <IWallet.h>
 #include <IWalletLegacy.h>
@@ -19,6 +20,7 @@ namespace Ui {
 namespace WalletGui {
 
 class TransferFrame;
+class BatchPayout;
 
 class SendFrame : public QFrame {
   Q_OBJECT
@@ -36,6 +38,8 @@ private:
   QScopedPointer<Ui::SendFrame> m_ui;
   QList<TransferFrame*> m_transfers;
   SendGlassFrame* m_glassFrame;
+  BatchPayout* m_batchPayout;
+  QProgressDialog* m_batchProgress;
 
   QString m_nodeFeeAddress;
   quint64 m_nodeFee = 0;
@@ -55,11 +59,16 @@ private:
   double getMinimalFee();
   quint64 getFee();
   void calculateNodeFee();
+  void nodeFeeAddressChanged();
   void recalculateAmountsSendOutputs();
   void reset();
   bool confirmZeroMixin();
+  bool confirmPassword();
+  void batchStatusChanged(int _index, int _status, const QString& _text);
+  void batchPayoutFinished(int _sent, int _failed);
 
   Q_SLOT void addRecipientClicked();
+  Q_SLOT void batchPayoutClicked();
   Q_SLOT void clearAllClicked();
   Q_SLOT void mixinValueChanged(int _value);
   Q_SLOT void priorityValueChanged(int _value);
@@ -5,8 +5,10 @@
 #include "SignMessageDialog.h"
 #include "ui_signmessagedialog.h"
 
+#include <QApplication>
 #include <QClipboard>
 #include <QFileDialog>
+#include <QMessageBox>
 #include <QTextStream>
 #include <QTabWidget>
 
@@ -15,10 +17,16 @@
 #include "MainWindow.h"
 #include <boost/utility/value_init.hpp>
 
+#include <algorithm>
+
 namespace WalletGui {
 
-SignMessageDialog::SignMessageDialog(QWidget* _parent) : QDialog(_parent), m_ui(new Ui::SignMessageDialog) {
+SignMessageDialog::SignMessageDialog(QWidget* _parent) : QDialog(_parent), m_jobId(0), m_ui(new Ui::SignMessageDialog) {
   m_ui->setupUi(this);
+  connect(&m_job, &MessageSignerJob::progressSignal, this, &SignMessageDialog::batchProgress);
+  connect(&m_job, &MessageSignerJob::batchVerifiedSignal, this, &SignMessageDialog::batchVerified, Qt::QueuedConnection);
+  connect(&m_job, &MessageSignerJob::benchmarkFinishedSignal, this, &SignMessageDialog::benchmarkFinished, Qt::QueuedConnection);
+  setBatchRunning(false);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletInitCompletedSignal, this, &SignMessageDialog::walletOpened, Qt::QueuedConnection);
   connect(&WalletAdapter::instance(), &WalletAdapter::walletCloseCompletedSignal, this, &SignMessageDialog::walletClosed, Qt::QueuedConnection);
   m_ui->m_verificationResult->setText("");
@@ -38,7 +46,17 @@ void SignMessageDialog::verify() {
 }
 
 void SignMessageDialog::changeTitle(int _variant) {
-  this->setWindowTitle(_variant == 0 ? tr("Sign message") : tr("Verify signed message"));
+  switch (_variant) {
+  case 0:
+    this->setWindowTitle(tr("Sign message"));
+    break;
+  case 1:
+    this->setWindowTitle(tr("Verify signed message"));
+    break;
+  default:
+    this->setWindowTitle(tr("Sign and verify messages in batch"));
+    break;
+  }
 }
 
 void SignMessageDialog::walletOpened() {
@@ -78,4 +96,143 @@ void SignMessageDialog::verifyMessage() {
   }
 }
 
+void SignMessageDialog::verifyBatch() {
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Load signed messages"), QDir::homePath(), tr("Text files (*.txt *.csv);;All files (*)"));
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  QVector<SignedMessage> messages;
+  QString errorText;
+  if (!MessageSigner::loadBatch(fileName, messages, errorText)) {
+    QMessageBox::critical(this, tr("Failed to load signed messages"), errorText, QMessageBox::Ok);
+    return;
+  }
+
+  m_batchMessages = messages;
+  m_ui->m_batchView->clear();
+  m_ui->m_batchSummaryLabel->setText(tr("Verifying %1 signatures...").arg(messages.size()));
+  setBatchRunning(true);
+  m_jobId = m_job.verify(messages);
+}
+
+void SignMessageDialog::batchVerified(quint64 _jobId, const QVector<WalletGui::MessageCheckResult>& _results, qint64 _elapsed, bool _cancelled) {
+  if (_jobId != m_jobId) {
+    return;
+  }
+
+  setBatchRunning(false);
+  if (_cancelled) {
+    m_ui->m_batchSummaryLabel->setText(tr("Verification cancelled"));
+    return;
+  }
+
+  QList<QTreeWidgetItem*> items;
+  int validCount = 0;
+  for (int i = 0; i < m_batchMessages.size(); ++i) {
+    QTreeWidgetItem* item = new QTreeWidgetItem(QStringList() << m_batchMessages[i].message << m_batchMessages[i].address <<
+      MessageSigner::resultText(_results[i]));
+    item->setForeground(2, _results[i] == MessageCheckResult::VALID ? Qt::darkGreen : Qt::red);
+    items.append(item);
+    validCount += _results[i] == MessageCheckResult::VALID ? 1 : 0;
+  }
+
+  m_ui->m_batchView->addTopLevelItems(items);
+  m_ui->m_batchSummaryLabel->setText(tr("%1 of %2 signatures are valid, verified in %3 ms").arg(validCount).arg(m_batchMessages.size()).arg(_elapsed));
+}
+
+void SignMessageDialog::signBatch() {
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Load messages to sign"), QDir::homePath(), tr("Text files (*.txt);;All files (*)"));
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    QMessageBox::critical(this, tr("Failed to sign messages"), tr("Cannot open file %1").arg(fileName), QMessageBox::Ok);
+    return;
+  }
+
+  QStringList messages;
+  QTextStream input(&file);
+  input.setCodec("UTF-8");
+  while (!input.atEnd()) {
+    QString line = input.readLine();
+    if (!line.trimmed().isEmpty()) {
+      messages.append(line);
+    }
+  }
+
+  file.close();
+  QStringList signatures = WalletAdapter::instance().signMessages(messages);
+  if (signatures.size() != messages.size()) {
+    return;
+  }
+
+  QString saveFileName = QFileDialog::getSaveFileName(this, tr("Save signed messages"), QDir::homePath(), tr("Text files (*.txt)"));
+  if (saveFileName.isEmpty()) {
+    return;
+  }
+
+  QFile output(saveFileName);
+  if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+    QMessageBox::critical(this, tr("Failed to sign messages"), tr("Cannot write file %1").arg(saveFileName), QMessageBox::Ok);
+    return;
+  }
+
+  const QString address = WalletAdapter::instance().getAddress();
+  QTextStream outputStream(&output);
+  outputStream.setCodec("UTF-8");
+  for (int i = 0; i < messages.size(); ++i) {
+    outputStream << messages[i] << '\t' << address << '\t' << signatures[i] << '\n';
+  }
+
+  m_ui->m_batchSummaryLabel->setText(tr("%1 messages signed").arg(messages.size()));
+}
+
+void SignMessageDialog::benchmark() {
+  const size_t SIGNATURE_COUNT = 20000;
+  m_ui->m_batchSummaryLabel->setText(tr("Running the benchmark..."));
+  setBatchRunning(true);
+  m_jobId = m_job.benchmark(SIGNATURE_COUNT);
+}
+
+void SignMessageDialog::benchmarkFinished(quint64 _jobId, const WalletGui::SignatureBenchmark& _result, bool _cancelled) {
+  if (_jobId != m_jobId) {
+    return;
+  }
+
+  setBatchRunning(false);
+  if (_cancelled) {
+    m_ui->m_batchSummaryLabel->setText(tr("Benchmark cancelled"));
+    return;
+  }
+
+  m_ui->m_batchSummaryLabel->setText(tr("Verification: %1 signatures/s on one core, %2 signatures/s on %3 threads (%4 per thread)").
+    arg(_result.singleThreadRate, 0, 'f', 0).arg(_result.allThreadsRate, 0, 'f', 0).arg(_result.threadCount).
+    arg(_result.allThreadsRate / _result.threadCount, 0, 'f', 0));
+}
+
+void SignMessageDialog::cancelBatch() {
+  m_job.cancel();
+}
+
+void SignMessageDialog::setBatchRunning(bool _running) {
+  m_ui->m_verifyBatchButton->setEnabled(!_running);
+  m_ui->m_signBatchButton->setEnabled(!_running);
+  m_ui->m_benchmarkButton->setEnabled(!_running);
+  m_ui->m_cancelBatchButton->setVisible(_running);
+  m_ui->m_batchProgressBar->setVisible(_running);
+  m_ui->m_batchProgressBar->setValue(0);
+}
+
+void SignMessageDialog::batchProgress(quint64 _jobId, int _done, int _total) {
+  if (_jobId != m_jobId || _total == 0) {
+    return;
+  }
+
+  m_ui->m_batchProgressBar->setMaximum(_total);
+  m_ui->m_batchProgressBar->setValue(_done);
+}
+
 }
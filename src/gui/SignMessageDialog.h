@@ -4,6 +4,8 @@
 
 #include <QDialog>
 
+#include "MessageSigner.h"
+
 namespace Ui {
 class SignMessageDialog;
 }
@@ -23,10 +25,21 @@ public:
 
 private:
     QString m_address;
+    MessageSignerJob m_job;
+    quint64 m_jobId;
+    QVector<SignedMessage> m_batchMessages;
 
     Q_SLOT void messageChanged();
     Q_SLOT void verifyMessage();
     Q_SLOT void changeTitle(int _variant);
+    Q_SLOT void verifyBatch();
+    Q_SLOT void signBatch();
+    Q_SLOT void benchmark();
+    Q_SLOT void cancelBatch();
+    void setBatchRunning(bool _running);
+    void batchProgress(quint64 _jobId, int _done, int _total);
+    void batchVerified(quint64 _jobId, const QVector<WalletGui::MessageCheckResult>& _results, qint64 _elapsed, bool _cancelled);
+    void benchmarkFinished(quint64 _jobId, const WalletGui::SignatureBenchmark& _result, bool _cancelled);
 
     QScopedPointer<Ui::SignMessageDialog> m_ui;
 };
@@ -444,9 +444,11 @@ QVariant TransactionsModel::getUserRole(const QModelIndex& _index, int _role, Cr
   case ROLE_FEE:
     return static_cast<quint64>(_transaction.fee);
 
-  case ROLE_NUMBER_OF_CONFIRMATIONS:
-    return (_transaction.blockHeight == CryptoNote::WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT ? 0 :
-      NodeAdapter::instance().getLastKnownBlockHeight() - _transaction.blockHeight + 1);
+  case ROLE_NUMBER_OF_CONFIRMATIONS: {
+    const quint64 topHeight = NodeAdapter::instance().getConfirmationHeight();
+    return (_transaction.blockHeight == CryptoNote::WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT || topHeight < _transaction.blockHeight ? 0 :
+      topHeight - _transaction.blockHeight + 1);
+  }
 
   case ROLE_COLUMN:
     return headerData(_index.column(), Qt::Horizontal, ROLE_COLUMN);
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QEventLoop>
 #include <QLocale>
 #include <QTranslator>
 #include <QLockFile>
@@ -14,13 +15,20 @@
 #include <QStyleFactory>
 #include <QSettings>
 #include <QTextCodec>
+#include <QTextStream>
 
 #include "CommandLineParser.h"
 #include "CurrencyAdapter.h"
+#include "FailoverCheck.h"
 #include "LoggerAdapter.h"
+#include "MessageSigner.h"
+#include "InterleavedHash.h"
+#include "MiningBenchmark.h"
 #include "NodeAdapter.h"
+#include "ReserveProof.h"
 #include "Settings.h"
 #include "SignalHandler.h"
+#include "SyncBenchmark.h"
 #include "WalletAdapter.h"
 #include "gui/MainWindow.h"
 #include "Update.h"
@@ -137,6 +145,55 @@ int main(int argc, char* argv[]) {
   SignalHandler::instance().init();
   QObject::connect(&SignalHandler::instance(), &SignalHandler::quitSignal, &app, &QApplication::quit);
 
+  // For provisioning: measure, keep the best setting for the mining tab and leave
+  if (Settings::instance().isMiningBenchmark()) {
+    MiningBenchmark benchmark;
+    QEventLoop waitLoop;
+    QObject::connect(&benchmark, &MiningBenchmark::benchmarkProgressSignal, [](int _current, int _total, const QString& _message) {
+      QTextStream(stdout) << QString("[%1/%2] %3").arg(_current).arg(_total).arg(_message) << endl;
+    });
+    QObject::connect(&benchmark, &MiningBenchmark::benchmarkFinishedSignal, &waitLoop, &QEventLoop::quit);
+    QObject::connect(&SignalHandler::instance(), &SignalHandler::quitSignal, [&benchmark]() { benchmark.cancel(); });
+    // no node runs yet to tell the block version, nonce batches are measured
+    // anyway and only used for blocks before version 5
+    benchmark.start(true);
+    waitLoop.exec();
+
+    const int best = benchmark.bestIndex();
+    if (best < 0 || !benchmark.applyBest()) {
+      QTextStream(stdout) << "Mining benchmark: no result" << endl;
+      return 1;
+    }
+
+    const QString text = QString("Mining benchmark: best %1").arg(MiningBenchmark::describe(benchmark.results()[best]));
+    LoggerAdapter::instance().log(text.toStdString());
+    QTextStream(stdout) << text << endl;
+    return 0;
+  }
+
+  // The interleaved hash against the library's scalar hash, every way count
+  if (Settings::instance().isMiningSelfTest()) {
+    if (!InterleavedHash::isAvailable()) {
+      QTextStream(stdout) << "Mining self test: interleaved hashing needs AES-NI on x86-64, skipped" << endl;
+      return 0;
+    }
+
+    bool passed = true;
+    for (quint32 ways = 1; ways <= InterleavedHash::MAX_WAYS; ++ways) {
+      const bool matched = InterleavedHash::testWays(ways);
+      passed = passed && matched;
+      QTextStream(stdout) << QString("Mining self test: %1 way(s) %2 the library hash").arg(ways).arg(matched ? "match" : "DO NOT match") << endl;
+    }
+
+    return passed ? 0 : 1;
+  }
+
+  // A self-check of the remote node pool, no wallet or node is started
+  const QString failoverCheckFile = Settings::instance().getFailoverCheckFile();
+  if (!failoverCheckFile.isEmpty()) {
+    return FailoverCheck::run(failoverCheckFile) ? 0 : 1;
+  }
+
   if (splash == nullptr) {
     splash = new QSplashScreen(QPixmap(":images/splash"), Qt::X11BypassWindowManagerHint);
   }
@@ -157,6 +214,17 @@ int main(int argc, char* argv[]) {
   qRegisterMetaType<CryptoNote::TransactionId>("CryptoNote::TransactionId");
   qRegisterMetaType<QList<CryptoNote::TransactionOutputInformation>>("QList<CryptoNote::TransactionOutputInformation>");
   qRegisterMetaType<quintptr>("quintptr");
+  qRegisterMetaType<QVector<WalletGui::ReserveProofCheckResult>>("QVector<WalletGui::ReserveProofCheckResult>");
+  qRegisterMetaType<QVector<WalletGui::MessageCheckResult>>("QVector<WalletGui::MessageCheckResult>");
+  qRegisterMetaType<WalletGui::SignatureBenchmark>("WalletGui::SignatureBenchmark");
+  qRegisterMetaType<std::vector<CryptoNote::p2pConnection>>("std::vector<CryptoNote::p2pConnection>");
+
+  // Started before the node to include node startup in the measured time
+  if (Settings::instance().isSyncBenchmark()) {
+    SyncBenchmark* benchmark = new SyncBenchmark(&app);
+    benchmark->start();
+  }
+
   if (!NodeAdapter::instance().init()) {
     return 0;
   }